@@ -1,3 +1,8 @@
+#ifndef _WIN32
+// mmap, madvise and mremap for the page allocator tests
+#define _GNU_SOURCE
+#endif
+
 #include "../../xstd.h"
 #include "xstd_tests.h"
 
@@ -21,6 +26,12 @@ int main(void)
     io_println("\n[Testing list]:");
     _xstd_list_tests(dbgAlloc);
 
+    io_println("\n[Testing slotmap]:");
+    _xstd_slotmap_tests(dbgAlloc);
+
+    io_println("\n[Testing hashmap]:");
+    _xstd_hashmap_tests(dbgAlloc);
+
     io_println("\n[Testing utf8]:");
     _xstd_utf8_tests(dbgAlloc);
 
@@ -30,6 +41,9 @@ int main(void)
     io_println("\n[Testing file]:");
     _xstd_file_tests(dbgAlloc);
 
+    io_println("\n[Testing alloc]:");
+    _xstd_alloc_tests(dbgAlloc);
+
     io_println("\n[Passed all tests]");
 
     io_print("Active allocations after test: ");
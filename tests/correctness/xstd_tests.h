@@ -10,6 +10,25 @@
 #include "../../xstd/xstd_math.h"
 #include "../../xstd/xstd_writer.h"
 #include "../../xstd/xstd_mem.h"
+#include "../../xstd/xstd_alloc_arena.h"
+#include "../../xstd/xstd_alloc_slab.h"
+#include "../../xstd/xstd_alloc_atomic_arena.h"
+#include "../../xstd/xstd_alloc_magazine.h"
+#include "../../xstd/xstd_alloc_budget.h"
+#include "../../xstd/xstd_alloc_buffer.h"
+#include "../../xstd/xstd_hash.h"
+#include "../../xstd/xstd_hashmap.h"
+#include "../../xstd/xstd_hashmap_flat.h"
+#include "../../xstd/xstd_hashmap_u64.h"
+#include "../../xstd/xstd_list.h"
+#include "../../xstd/xstd_slotmap.h"
+#include "../../xstd/xstd_alloc_debug.h"
+#include "../../xstd/xstd_alloc_debug_profile.h"
+#include "../../xstd/xstd_alloc_debug_sharded.h"
+#if !_X_PLAT_WIN
+#include "../../xstd/xstd_alloc_posix.h"
+#include "../../xstd/xstd_alloc_arena_vm.h"
+#endif
 
 /*
 // FOR DEBUGGING
@@ -58,6 +77,38 @@ static void _xstd_print_strlist(void *itemPtr, u64 index)
     io_println(*(HeapStr *)itemPtr);
 }*/
 
+// Fills new blocks with garbage so reads of memory the caller never initialized show up
+static void *_xstd_dirty_alloc_alloc(Allocator *a, u64 s)
+{
+    Allocator *backing = (Allocator *)a->_internalState;
+    u8 *block = (u8 *)backing->alloc(backing, s);
+    for (u64 i = 0; block && i < s; ++i)
+        block[i] = 0xAB;
+    return block;
+}
+
+static void *_xstd_dirty_alloc_realloc(Allocator *a, void *b, u64 s)
+{
+    Allocator *backing = (Allocator *)a->_internalState;
+    return backing->realloc(backing, b, s);
+}
+
+static void _xstd_dirty_alloc_free(Allocator *a, void *b)
+{
+    Allocator *backing = (Allocator *)a->_internalState;
+    backing->free(backing, b);
+}
+
+static Allocator _xstd_dirty_alloc(Allocator *backing)
+{
+    return (Allocator){
+        ._internalState = backing,
+        .alloc = _xstd_dirty_alloc_alloc,
+        .realloc = _xstd_dirty_alloc_realloc,
+        .free = _xstd_dirty_alloc_free,
+    };
+}
+
 static void _xstd_foreach_test(void *itemPtr, u64 index, void* userArg)
 {
     (void)userArg;
@@ -66,6 +117,18 @@ static void _xstd_foreach_test(void *itemPtr, u64 index, void* userArg)
     itemStr[0] = ' ';
 }
 
+static void _xstd_hashmap_sum(Buffer key, void *value, void *userArg)
+{
+    (void)key;
+    *(u64 *)userArg += *(u64 *)value;
+}
+
+static void _xstd_u64_hashmap_sum(u64 key, void *value, void *userArg)
+{
+    (void)key;
+    *(u64 *)userArg += *(u64 *)value;
+}
+
 static void _xstd_file_tests(Allocator alloc)
 {
     io_println("file_create");
@@ -1932,6 +1995,444 @@ static void _xstd_list_tests(Allocator alloc)
     }
 }
 
+static void _xstd_slotmap_tests(Allocator alloc)
+{
+    io_println("slotmap");
+    {
+        ResSlotMap res = SlotMapInitT(u64, &alloc);
+        assert_res_ok((Res*)&res, "slotmap_init res.err.code != ERR_OK");
+        SlotMap map = res.value;
+
+        SlotHandle handles[40];
+        for (u64 i = 0; i < 40; ++i)
+        {
+            u64 value = i * 10;
+            assert_ok(slotmap_insert(&map, &value, &handles[i]), "slotmap_insert err.code != ERR_OK");
+        }
+        assert_true(slotmap_size(&map) == 40 && handles[0] != SLOTMAP_NULL_HANDLE, "slotmap_insert size != 40");
+
+        u64 out = 0;
+        SlotMapGetT(u64, &map, handles[39], &out);
+        assert_true(out == 390, "slotmap_get after growth != 390");
+
+        assert_ok(slotmap_remove(&map, handles[5]), "slotmap_remove err.code != ERR_OK");
+        assert_true(!slotmap_contains(&map, handles[5]), "slotmap_remove handle not stale");
+        assert_true(slotmap_getref(&map, handles[5]) == NULL, "slotmap_getref stale handle != NULL");
+        assert_true(slotmap_remove(&map, handles[5]).code == ERR_INVALID_PARAMETER, "slotmap_remove stale handle accepted");
+        assert_true(*(u64 *)slotmap_getref(&map, handles[39]) == 390, "slotmap_remove moved item lost");
+
+        // Handle of the next generation of a free slot
+        SlotHandle forged = handles[5] + ((u64)1 << 32);
+        assert_true(!slotmap_contains(&map, forged) && slotmap_getref(&map, forged) == NULL, "slotmap free slot accepted");
+        assert_true(slotmap_remove(&map, forged).code == ERR_INVALID_PARAMETER, "slotmap_remove free slot accepted");
+
+        u64 reused = 7;
+        SlotHandle newHandle = SLOTMAP_NULL_HANDLE;
+        assert_ok(slotmap_insert(&map, &reused, &newHandle), "slotmap_insert reuse err.code != ERR_OK");
+        assert_true((u32)newHandle == (u32)handles[5] && newHandle != handles[5], "slotmap_insert slot not reused with new generation");
+        assert_true(slotmap_get(&map, handles[5], &out).code != ERR_OK, "slotmap_get stale handle after reuse");
+
+        u64 *items = (u64 *)slotmap_data(&map);
+        u64 sum = 0;
+        for (u64 i = 0; i < slotmap_size(&map); ++i)
+        {
+            sum += items[i];
+            assert_true(*(u64 *)slotmap_getref(&map, slotmap_handle_at(&map, i)) == items[i], "slotmap_handle_at mismatch");
+        }
+        assert_true(sum == 7800 - 50 + 7, "slotmap_data sum mismatch");
+
+        slotmap_clear(&map);
+        assert_true(slotmap_size(&map) == 0 && !slotmap_contains(&map, handles[0]), "slotmap_clear left items");
+        slotmap_deinit(&map);
+    }
+}
+
+static void _xstd_hashmap_tests(Allocator alloc)
+{
+    io_println("hash");
+    {
+        assert_true(hash_fnv1a64(NULL, 0) == 0xcbf29ce484222325ULL, "hash_fnv1a64 empty mismatch");
+        assert_true(hash_fnv1a64("a", 1) == 0xaf63dc4c8601ec8cULL, "hash_fnv1a64 \"a\" mismatch");
+        assert_true(hash_bytes(HASH_ALGO_FNV1A, "a", 1, 1234) == 0xaf63dc4c8601ec8cULL, "hash_bytes fnv uses seed");
+
+        i8 data[100];
+        for (u64 i = 0; i < sizeof(data); ++i)
+            data[i] = (i8)(i * 7);
+
+        Bool stable = true, distinct = true;
+        for (u64 len = 0; len <= sizeof(data); ++len)
+        {
+            u64 h = hash_wy(data, len, 42);
+            stable = stable && h == hash_bytes(HASH_ALGO_WY, data, len, 42);
+            distinct = distinct && h != hash_wy(data, len, 43);
+            if (len > 0)
+                distinct = distinct && h != hash_wy(data, len - 1, 42);
+        }
+        assert_true(stable, "hash_wy not deterministic");
+        assert_true(distinct, "hash_wy collision across seeds or lengths");
+        assert_true(hash_random_seed() != hash_random_seed(), "hash_random_seed repeated");
+
+        DebugAllocatorState dbgState;
+        ResAllocator dbgRes = debug_allocator(&dbgState, 16, &alloc);
+        assert_res_ok((Res*)&dbgRes, "hash dbgRes.err.code != ERR_OK");
+        Allocator dbg = dbgRes.value;
+
+        ResHashMap res = hashmap_init_hashed(&dbg, sizeof(u64), 100, HASH_ALGO_FNV1A, 0);
+        assert_res_ok((Res*)&res, "hashmap_init_hashed res.err.code != ERR_OK");
+        HashMap map = res.value;
+        assert_true(dbgState.activeUserBytes == 128 * sizeof(void *), "hashmap_init_hashed bucket count not rounded to 128");
+        u64 value = 3;
+        assert_ok(hashmap_set_str(&map, "fnv", &value), "hashmap_init_hashed set err.code != ERR_OK");
+        assert_ok(hashmap_get_str(&map, "fnv", &value), "hashmap_init_hashed get err.code != ERR_OK");
+        hashmap_deinit(&map);
+        debug_allocator_deinit(&dbgState);
+    }
+    io_println("hashmap");
+    {
+        ResHashMap res = HashMapInitT(u64, &alloc);
+        assert_res_ok((Res*)&res, "hashmap_init res.err.code != ERR_OK");
+        HashMap map = res.value;
+
+        for (u64 i = 0; i < 100; ++i)
+        {
+            Buffer key = {.bytes = (i8 *)&i, .size = sizeof(i)};
+            assert_ok(hashmap_set(&map, key, &i), "hashmap_set err.code != ERR_OK");
+        }
+        u64 value = 1000;
+        assert_ok(hashmap_set_str(&map, "", &value), "hashmap_set_str empty key err.code != ERR_OK");
+        value = 50;
+        assert_ok(hashmap_set_str(&map, "", &value), "hashmap_set_str overwrite err.code != ERR_OK");
+        assert_true(hashmap_size(&map) == 101, "hashmap_set size != 101");
+
+        u64 out = 0;
+        assert_ok(hashmap_get_str(&map, "", &out), "hashmap_get_str err.code != ERR_OK");
+        assert_true(out == 50, "hashmap_get_str overwritten value != 50");
+
+        for (u64 i = 0; i < 100; i += 2)
+        {
+            Buffer key = {.bytes = (i8 *)&i, .size = sizeof(i)};
+            assert_ok(hashmap_remove(&map, key), "hashmap_remove err.code != ERR_OK");
+        }
+
+        u64 sum = 0;
+        hashmap_for_each(&map, _xstd_hashmap_sum, &sum);
+        assert_true(sum == 2500 + 50, "hashmap_for_each sum != 2550");
+
+        hashmap_deinit(&map);
+    }
+    io_println("hashmap_incremental_rehash");
+    {
+        DebugAllocatorState dbgState;
+        ResAllocator dbgRes = debug_allocator(&dbgState, 16, &alloc);
+        assert_res_ok((Res*)&dbgRes, "hashmap_incremental_rehash dbgRes.err.code != ERR_OK");
+        Allocator dbg = dbgRes.value;
+
+        // The new bucket array is only zeroed as old buckets migrate
+        Allocator dirty = _xstd_dirty_alloc(&dbg);
+        ResHashMap res = HashMapInitT(u64, &dirty);
+        assert_res_ok((Res*)&res, "hashmap_init res.err.code != ERR_OK");
+        HashMap map = res.value;
+        hashmap_set_incremental_rehash(&map, true);
+
+        Bool sawMigration = false, lookupsOk = true;
+        for (u64 i = 0; i < 3000; ++i)
+        {
+            Buffer key = {.bytes = (i8 *)&i, .size = sizeof(i)};
+            assert_ok(hashmap_set(&map, key, &i), "hashmap_set incremental err.code != ERR_OK");
+            // One allocation per entry, a pending rehash keeps a second bucket array
+            sawMigration = sawMigration || dbgState.activeAllocCount == hashmap_size(&map) + 2;
+
+            // Keys still waiting in the old table must stay reachable
+            u64 probe = i / 2, out = 0;
+            Buffer probeKey = {.bytes = (i8 *)&probe, .size = sizeof(probe)};
+            lookupsOk = lookupsOk && hashmap_get(&map, probeKey, &out).code == ERR_OK && out == probe;
+        }
+        assert_true(sawMigration, "hashmap incremental rehash never kept an old table");
+        assert_true(lookupsOk, "hashmap_get lost a key during incremental rehash");
+
+        while (dbgState.activeAllocCount != hashmap_size(&map) + 2)
+        {
+            u64 i = hashmap_size(&map);
+            Buffer key = {.bytes = (i8 *)&i, .size = sizeof(i)};
+            assert_ok(hashmap_set(&map, key, &i), "hashmap_set incremental err.code != ERR_OK");
+        }
+        u64 count = hashmap_size(&map);
+        for (u64 i = 0; i < count; i += 2)
+        {
+            Buffer key = {.bytes = (i8 *)&i, .size = sizeof(i)};
+            assert_ok(hashmap_remove(&map, key), "hashmap_remove during rehash err.code != ERR_OK");
+        }
+
+        u64 sum = 0, expected = 0;
+        for (u64 i = 1; i < count; i += 2)
+            expected += i;
+        hashmap_for_each(&map, _xstd_hashmap_sum, &sum);
+        assert_true(sum == expected, "hashmap_for_each during rehash sum mismatch");
+
+        hashmap_set_incremental_rehash(&map, false);
+        assert_true(dbgState.activeAllocCount == hashmap_size(&map) + 1, "hashmap_set_incremental_rehash(false) left old table");
+        assert_true(hashmap_size(&map) == count / 2, "hashmap size after removals mismatch");
+
+        hashmap_deinit(&map);
+        debug_allocator_deinit(&dbgState);
+    }
+    io_println("hashmap_iter");
+    {
+        DebugAllocatorState dbgState;
+        ResAllocator dbgRes = debug_allocator(&dbgState, 16, &alloc);
+        assert_res_ok((Res*)&dbgRes, "hashmap_iter dbgRes.err.code != ERR_OK");
+        Allocator dbg = dbgRes.value;
+
+        ResHashMap res = HashMapInitT(u64, &dbg);
+        assert_res_ok((Res*)&res, "hashmap_init res.err.code != ERR_OK");
+        HashMap map = res.value;
+        assert_ok(hashmap_set_insertion_ordered(&map, true), "hashmap_set_insertion_ordered err.code != ERR_OK");
+
+        // Insert 199, 198, ..., 0 then remove multiples of 3, repeatedly to exercise hole compaction
+        for (u64 round = 0; round < 6; ++round)
+        {
+            for (u64 n = 0; n < 200; ++n)
+            {
+                u64 i = 199 - n;
+                Buffer key = {.bytes = (i8 *)&i, .size = sizeof(i)};
+                assert_ok(hashmap_set(&map, key, &i), "hashmap_set ordered err.code != ERR_OK");
+            }
+            for (u64 i = 0; i < 200; i += 3)
+            {
+                Buffer key = {.bytes = (i8 *)&i, .size = sizeof(i)};
+                assert_ok(hashmap_remove(&map, key), "hashmap_remove ordered err.code != ERR_OK");
+            }
+        }
+
+        u64 remaining = 0;
+        Bool noRemoved = true;
+        HashMapIter compacted = hashmap_iter(&map);
+        void *compactedValue;
+        while (hashmap_iter_next(&map, &compacted, NULL, &compactedValue))
+        {
+            noRemoved = noRemoved && *(u64 *)compactedValue % 3 != 0;
+            remaining += 1;
+        }
+        assert_true(noRemoved && remaining == 133, "hashmap_iter_next after compaction mismatch");
+
+        // Each batch of new keys replaces the previous one, the order array
+        // fills with holes and must be squeezed instead of doubling again
+        u64 steadyBytes = 0;
+        for (u64 round = 0; round < 40; ++round)
+        {
+            for (u64 n = 0; n < 100; ++n)
+            {
+                u64 i = 1000 + round * 100 + n;
+                Buffer key = {.bytes = (i8 *)&i, .size = sizeof(i)};
+                assert_ok(hashmap_set(&map, key, &i), "hashmap_set ordered batch err.code != ERR_OK");
+            }
+            for (u64 n = 0; round > 0 && n < 100; ++n)
+            {
+                u64 i = 1000 + (round - 1) * 100 + n;
+                Buffer key = {.bytes = (i8 *)&i, .size = sizeof(i)};
+                assert_ok(hashmap_remove(&map, key), "hashmap_remove ordered batch err.code != ERR_OK");
+            }
+            if (round == 20)
+                steadyBytes = dbgState.activeUserBytes;
+        }
+        assert_true(dbgState.activeUserBytes == steadyBytes, "hashmap ordered holes not compacted");
+
+        assert_true(hashmap_set_insertion_ordered(&map, false).code == ERR_OK, "hashmap_set_insertion_ordered disable failed");
+        assert_true(hashmap_set_insertion_ordered(&map, true).code == ERR_INVALID_PARAMETER, "hashmap_set_insertion_ordered accepted a non-empty map");
+        hashmap_deinit(&map);
+
+        res = HashMapInitT(u64, &dbg);
+        assert_res_ok((Res*)&res, "hashmap_init res.err.code != ERR_OK");
+        map = res.value;
+        assert_ok(hashmap_set_insertion_ordered(&map, true), "hashmap_set_insertion_ordered err.code != ERR_OK");
+        for (u64 n = 0; n < 200; ++n)
+        {
+            u64 i = 199 - n;
+            Buffer key = {.bytes = (i8 *)&i, .size = sizeof(i)};
+            assert_ok(hashmap_set(&map, key, &i), "hashmap_set ordered err.code != ERR_OK");
+        }
+
+        // Removing the entry just returned is allowed in ordered mode
+        HashMapIter it = hashmap_iter(&map);
+        Buffer key;
+        void *value;
+        u64 expected = 199, visited = 0;
+        Bool ordered = true;
+        while (hashmap_iter_next(&map, &it, &key, &value))
+        {
+            u64 v = *(u64 *)value;
+            ordered = ordered && v == expected && key.size == sizeof(u64) && *(u64 *)key.bytes == v;
+            expected -= 1;
+            visited += 1;
+            if (v % 2 == 0)
+                assert_ok(hashmap_remove(&map, key), "hashmap_remove while iterating err.code != ERR_OK");
+            if (v == 50)
+                break;
+        }
+        assert_true(ordered && visited == 150, "hashmap_iter_next insertion order mismatch");
+        assert_true(hashmap_size(&map) == 125, "hashmap_iter_next removals size != 125");
+
+        it = hashmap_iter(&map);
+        expected = 199;
+        ordered = true;
+        while (hashmap_iter_next(&map, &it, NULL, &value))
+        {
+            u64 v = *(u64 *)value;
+            ordered = ordered && v == expected;
+            expected -= (expected > 50) ? 2 : 1;
+        }
+        assert_true(ordered && expected == (u64)-1, "hashmap_iter_next order after removals mismatch");
+        hashmap_deinit(&map);
+
+        res = HashMapInitT(u64, &dbg);
+        assert_res_ok((Res*)&res, "hashmap_init res.err.code != ERR_OK");
+        map = res.value;
+        hashmap_set_incremental_rehash(&map, true);
+        for (u64 i = 0; i < 1000; ++i)
+        {
+            Buffer k = {.bytes = (i8 *)&i, .size = sizeof(i)};
+            assert_ok(hashmap_set(&map, k, &i), "hashmap_set err.code != ERR_OK");
+        }
+        assert_true(dbgState.activeAllocCount == hashmap_size(&map) + 2, "hashmap_iter test expects a pending rehash");
+
+        u64 sum = 0;
+        it = hashmap_iter(&map);
+        while (hashmap_iter_next(&map, &it, NULL, &value))
+            sum += *(u64 *)value;
+        assert_true(sum == 999 * 1000 / 2, "hashmap_iter_next bucket walk sum mismatch");
+        hashmap_deinit(&map);
+        debug_allocator_deinit(&dbgState);
+    }
+    io_println("hashmap_flat");
+    {
+        ResFlatHashMap res = FlatHashMapInitT(u64, &alloc);
+        assert_res_ok((Res*)&res, "flat_hashmap_init res.err.code != ERR_OK");
+        FlatHashMap map = res.value;
+
+        for (u64 i = 0; i < 1000; ++i)
+        {
+            Buffer key = {.bytes = (i8 *)&i, .size = sizeof(i)};
+            assert_ok(flat_hashmap_set(&map, key, &i), "flat_hashmap_set err.code != ERR_OK");
+        }
+        assert_true(flat_hashmap_size(&map) == 1000, "flat_hashmap_set size != 1000");
+
+        for (u64 i = 0; i < 1000; i += 2)
+        {
+            Buffer key = {.bytes = (i8 *)&i, .size = sizeof(i)};
+            assert_ok(flat_hashmap_remove(&map, key), "flat_hashmap_remove err.code != ERR_OK");
+        }
+        assert_true(flat_hashmap_size(&map) == 500, "flat_hashmap_remove size != 500");
+
+        Bool lookupsOk = true;
+        for (u64 i = 0; i < 1000; ++i)
+        {
+            Buffer key = {.bytes = (i8 *)&i, .size = sizeof(i)};
+            u64 out = 0;
+            Error err = flat_hashmap_get(&map, key, &out);
+            if (i % 2 == 0)
+                lookupsOk = lookupsOk && err.code == ERR_RANGE_ERROR;
+            else
+                lookupsOk = lookupsOk && err.code == ERR_OK && out == i;
+        }
+        assert_true(lookupsOk, "flat_hashmap_get mismatch after removals");
+
+        u64 value = 7;
+        FlatHashMapSetStrT(u64, &map, "", &value);
+        value = 8;
+        FlatHashMapSetStrT(u64, &map, "", &value);
+        u64 out = 0;
+        FlatHashMapGetStrT(u64, &map, "", &out);
+        assert_true(out == 8 && flat_hashmap_size(&map) == 501, "flat_hashmap_set overwrite failed");
+        assert_ok(flat_hashmap_remove_str(&map, ""), "flat_hashmap_remove_str err.code != ERR_OK");
+        assert_true(flat_hashmap_remove_str(&map, "").code == ERR_RANGE_ERROR, "flat_hashmap_remove_str removed twice");
+
+        u64 sum = 0;
+        flat_hashmap_for_each(&map, _xstd_hashmap_sum, &sum);
+        assert_true(sum == 250000, "flat_hashmap_for_each sum != 250000");
+
+        flat_hashmap_deinit(&map);
+    }
+    io_println("hashmap_flat_inline_keys");
+    {
+        DebugAllocatorState dbgState;
+        ResAllocator dbgRes = debug_allocator(&dbgState, 16, &alloc);
+        assert_res_ok((Res*)&dbgRes, "hashmap_flat_inline_keys dbgRes.err.code != ERR_OK");
+        Allocator dbg = dbgRes.value;
+
+        FlatHashMap map = FlatHashMapInitT(u64, &dbg).value;
+
+        // Keys of 1 to 40 bytes, the 24 longer than 16 bytes need their own allocation
+        i8 keyBytes[40];
+        for (u64 i = 0; i < sizeof(keyBytes); ++i)
+            keyBytes[i] = (i8)('a' + i % 26);
+        for (u64 len = 1; len <= 40; ++len)
+            assert_ok(flat_hashmap_set(&map, (Buffer){.bytes = keyBytes, .size = len}, &len), "hashmap_flat_inline_keys set err.code != ERR_OK");
+        assert_true(dbgState.activeAllocCount == 1 + 24, "hashmap_flat_inline_keys short keys allocated");
+
+        Bool lookupsOk = true;
+        for (u64 len = 1; len <= 40; ++len)
+        {
+            u64 out = 0;
+            lookupsOk = lookupsOk && flat_hashmap_get(&map, (Buffer){.bytes = keyBytes, .size = len}, &out).code == ERR_OK && out == len;
+        }
+        assert_true(lookupsOk, "hashmap_flat_inline_keys get mismatch");
+
+        u64 sum = 0;
+        flat_hashmap_for_each(&map, _xstd_hashmap_sum, &sum);
+        assert_true(sum == 820, "hashmap_flat_inline_keys for_each sum != 820");
+
+        for (u64 len = 1; len <= 40; len += 2)
+            assert_ok(flat_hashmap_remove(&map, (Buffer){.bytes = keyBytes, .size = len}), "hashmap_flat_inline_keys remove err.code != ERR_OK");
+        assert_true(dbgState.activeAllocCount == 1 + 12, "hashmap_flat_inline_keys remove leaked keys");
+
+        flat_hashmap_deinit(&map);
+        assert_true(dbgState.activeAllocCount == 0, "hashmap_flat_inline_keys deinit leaked keys");
+        debug_allocator_deinit(&dbgState);
+    }
+    io_println("hashmap_u64");
+    {
+        ResU64HashMap res = U64HashMapInitT(u64, &alloc);
+        assert_res_ok((Res*)&res, "u64_hashmap_init res.err.code != ERR_OK");
+        U64HashMap map = res.value;
+
+        for (u64 i = 0; i < 1000; ++i)
+        {
+            u64 value = i * 3;
+            assert_ok(u64_hashmap_set(&map, i << 4, &value), "u64_hashmap_set err.code != ERR_OK");
+        }
+        for (u64 i = 0; i < 1000; i += 2)
+            assert_ok(u64_hashmap_remove(&map, i << 4), "u64_hashmap_remove err.code != ERR_OK");
+        assert_true(u64_hashmap_size(&map) == 500, "u64_hashmap_remove size != 500");
+
+        Bool lookupsOk = true;
+        for (u64 i = 0; i < 1000; ++i)
+        {
+            u64 out = 0;
+            Error err = u64_hashmap_get(&map, i << 4, &out);
+            if (i % 2 == 0)
+                lookupsOk = lookupsOk && err.code == ERR_RANGE_ERROR && !u64_hashmap_getref(&map, i << 4);
+            else
+                lookupsOk = lookupsOk && err.code == ERR_OK && out == i * 3;
+        }
+        assert_true(lookupsOk, "u64_hashmap_get mismatch after removals");
+
+        u64 anchor = 0, value = 77;
+        U64HashMapSetT(u64, &map, 0, &value);
+        assert_ok(u64_hashmap_set_ptr(&map, &anchor, &value), "u64_hashmap_set_ptr err.code != ERR_OK");
+        u64 out = 0;
+        assert_ok(u64_hashmap_get_ptr(&map, &anchor, &out), "u64_hashmap_get_ptr err.code != ERR_OK");
+        assert_true(out == 77 && *(u64 *)u64_hashmap_getref(&map, 0) == 77, "u64_hashmap pointer/zero key value != 77");
+        assert_ok(u64_hashmap_remove_ptr(&map, &anchor), "u64_hashmap_remove_ptr err.code != ERR_OK");
+        assert_ok(u64_hashmap_remove(&map, 0), "u64_hashmap_remove zero key err.code != ERR_OK");
+
+        u64 sum = 0;
+        u64_hashmap_for_each(&map, _xstd_u64_hashmap_sum, &sum);
+        assert_true(sum == 750000, "u64_hashmap_for_each sum != 750000");
+
+        u64_hashmap_deinit(&map);
+    }
+}
+
 static void _xstd_math_tests(Allocator alloc)
 {
     (void)alloc;
@@ -2338,3 +2839,784 @@ static void _xstd_mem_tests(void)
             assert_true(buff[i] == expected[i], "mem_copy same buffer altered data");
     }
 }
+
+static void _xstd_alloc_tests(Allocator alloc)
+{
+    Allocator badAlloc = _xstd_bad_alloc();
+
+    io_println("arena_allocator_chained");
+    {
+        ResAllocator res = arena_allocator_chained(&alloc, 256);
+        assert_res_ok((Res*)&res, "arena_allocator_chained res.err.code != ERR_OK");
+
+        Allocator arena = res.value;
+        ArenaAllocatorState *state = (ArenaAllocatorState *)arena._internalState;
+
+        u64 *first = (u64 *)arena.alloc(&arena, sizeof(u64));
+        assert_true(first != NULL, "arena_allocator_chained first == NULL");
+        *first = 42;
+
+        for (u64 i = 0; i < 64; ++i)
+        {
+            u8 *block = (u8 *)arena.alloc(&arena, 100);
+            assert_true(block != NULL, "arena_allocator_chained block == NULL");
+            block[99] = (u8)i;
+        }
+        assert_true(state->lastBlock != NULL, "arena_allocator_chained did not chain");
+        assert_true(*first == 42, "arena_allocator_chained first block overwritten");
+
+        u8 *large = (u8 *)arena.alloc(&arena, 1 << 16);
+        assert_true(large != NULL, "arena_allocator_chained large == NULL");
+        large[(1 << 16) - 1] = 1;
+
+        arena_allocator_clear(&arena);
+        assert_true(state->lastBlock == NULL, "arena_allocator_clear lastBlock != NULL");
+        assert_true(arena.alloc(&arena, 16) != NULL, "arena_allocator_clear alloc == NULL");
+
+        arena_allocator_deinit(&arena);
+
+        ResAllocator res2 = arena_allocator_chained(&badAlloc, 256);
+        assert_true(res2.err.code != ERR_OK, "arena_allocator_chained res2.err.code == ERR_OK");
+    }
+    io_println("arena_mark");
+    {
+        ResAllocator res = arena_allocator_chained(&alloc, 256);
+        assert_res_ok((Res*)&res, "arena_mark res.err.code != ERR_OK");
+
+        Allocator arena = res.value;
+        ArenaAllocatorState *state = (ArenaAllocatorState *)arena._internalState;
+
+        u64 *kept = (u64 *)arena.alloc(&arena, sizeof(u64));
+        *kept = 7;
+
+        ArenaMark outer = arena_mark(&arena);
+        void *outerPtr = arena.alloc(&arena, 32);
+
+        ArenaMark inner = arena_mark(&arena);
+        for (u64 i = 0; i < 32; ++i)
+            assert_true(arena.alloc(&arena, 64) != NULL, "arena_mark inner alloc == NULL");
+        assert_true(state->lastBlock != NULL, "arena_mark did not chain");
+
+        io_println("arena_rewind");
+
+        arena_rewind(&arena, inner);
+        assert_true(state->lastBlock == NULL, "arena_rewind lastBlock != NULL");
+        assert_true(arena.alloc(&arena, 8) == (i8 *)outerPtr + 32, "arena_rewind did not reuse memory");
+
+        arena_rewind(&arena, outer);
+        assert_true(arena.alloc(&arena, 32) == outerPtr, "arena_rewind outer did not reuse memory");
+        assert_true(*kept == 7, "arena_rewind overwrote kept allocation");
+
+        arena_allocator_deinit(&arena);
+    }
+    io_println("arena_realloc");
+    {
+        u8 bytes[1024];
+        Allocator arena = arena_allocator((Buffer){.bytes = (i8 *)bytes, .size = sizeof(bytes)}, false).value;
+        ArenaAllocatorState *state = (ArenaAllocatorState *)arena._internalState;
+
+        u8 *top = (u8 *)arena.alloc(&arena, 100);
+        for (u32 i = 0; i < 100; ++i)
+            top[i] = (u8)i;
+        u64 used = state->offset;
+
+        assert_true(arena.realloc(&arena, top, 300) == top && state->offset == used + 200, "arena_realloc top not grown in place");
+        assert_true(arena.realloc(&arena, top, 50) == top && state->offset == used - 50, "arena_realloc top not shrunk in place");
+
+        u8 *next = (u8 *)arena.alloc(&arena, 16);
+        assert_true(next == top + 64, "arena_realloc shrink did not return space");
+
+        u8 *moved = (u8 *)arena.realloc(&arena, top, 200);
+        assert_true(moved != top && moved != NULL && moved[49] == 49, "arena_realloc did not copy older block");
+
+        ArenaMark mark = arena_mark(&arena);
+        arena.free(&arena, arena.alloc(&arena, 32));
+        assert_true(state->offset == _arena_offset_to_aligned(mark.offset), "arena free of top block did not return space");
+        assert_true(arena.alloc(&arena, 8) != NULL, "arena alloc after free == NULL");
+        arena_rewind(&arena, mark);
+        assert_true(arena.realloc(&arena, moved, 250) == moved, "arena_rewind did not restore last allocation");
+
+        arena.free(&arena, next);
+        assert_true(state->offset == mark.offset + 50, "arena free of older block changed offset");
+        assert_true(arena.realloc(&arena, NULL, 8) != NULL, "arena_realloc NULL block did not allocate");
+
+        // The top block from before a mark must not grow across it
+        arena_allocator_clear(&arena);
+        u8 *pinned = (u8 *)arena.alloc(&arena, 16);
+        for (u32 i = 0; i < 16; ++i)
+            pinned[i] = (u8)i;
+        mark = arena_mark(&arena);
+        u8 *grown = (u8 *)arena.realloc(&arena, pinned, 64);
+        assert_true(grown != pinned && grown != NULL && grown[15] == 15, "arena_realloc grew a block across a mark");
+        arena_rewind(&arena, mark);
+
+        u8 *after = (u8 *)arena.alloc(&arena, 32);
+        for (u32 i = 0; i < 32; ++i)
+            after[i] = 0xFF;
+        assert_true(after >= pinned + 16 && pinned[15] == 15, "arena alloc after rewind overlaps the pre-mark block");
+    }
+    io_println("slab_allocator");
+    {
+        SlabAllocatorState state;
+        ResAllocator res = slab_allocator(&state, &alloc);
+        assert_res_ok((Res*)&res, "slab_allocator res.err.code != ERR_OK");
+
+        Allocator slab = res.value;
+
+        u64 *a = (u64 *)slab.alloc(&slab, sizeof(u64));
+        u64 *b = (u64 *)slab.alloc(&slab, sizeof(u64));
+        assert_true(a && b && a != b, "slab_allocator small alloc failed");
+        assert_true(((uPtr)a & 15) == 0, "slab_allocator block not 16-aligned");
+
+        slab.free(&slab, a);
+        u64 *c = (u64 *)slab.alloc(&slab, 12);
+        assert_true(c == a, "slab_allocator freed slot not reused");
+
+        u8 *large = (u8 *)slab.alloc(&slab, 1000);
+        assert_true(large != NULL, "slab_allocator large alloc failed");
+        assert_true(state.largeAllocCount == 1, "slab_allocator largeAllocCount != 1");
+
+        *b = 99;
+        u64 *moved = (u64 *)slab.realloc(&slab, b, 100);
+        assert_true(moved && *moved == 99, "slab_allocator realloc lost data");
+
+        large = (u8 *)slab.realloc(&slab, large, 4000);
+        assert_true(large != NULL, "slab_allocator large realloc failed");
+        slab.free(&slab, large);
+        assert_true(state.largeAllocCount == 0, "slab_allocator largeAllocCount != 0");
+
+        ResHashMap mapRes = HashMapInitT(u64, &slab);
+        assert_res_ok((Res*)&mapRes, "slab_allocator hashmap_init failed");
+        HashMap map = mapRes.value;
+
+        for (u64 i = 0; i < 200; ++i)
+        {
+            i8 key[2] = {(i8)(i & 0xFF), 0};
+            Buffer keyBuff = {.bytes = key, .size = 1};
+            assert_ok(hashmap_set(&map, keyBuff, &i), "slab_allocator hashmap_set failed");
+        }
+        assert_true(hashmap_size(&map) == 200, "slab_allocator hashmap size != 200");
+
+        hashmap_deinit(&map);
+        slab_allocator_deinit(&slab);
+        assert_true(state.pageCount == 0, "slab_allocator_deinit pageCount != 0");
+    }
+    io_println("buffer_allocator_tlsf");
+    {
+        u64 buffSize = 1 << 16;
+        i8 *bytes = (i8 *)alloc.alloc(&alloc, buffSize);
+        assert_true(bytes != NULL, "buffer_allocator_tlsf bytes == NULL");
+
+        ResAllocator res = buffer_allocator_tlsf((Buffer){.bytes = bytes, .size = buffSize});
+        assert_res_ok((Res*)&res, "buffer_allocator_tlsf res.err.code != ERR_OK");
+
+        Allocator tlsf = res.value;
+        TlsfBufferAllocatorState *state = (TlsfBufferAllocatorState *)tlsf._internalState;
+        u64 initialBitmap = state->flBitmap;
+
+        u8 *ptrs[64];
+        for (u64 i = 0; i < 64; ++i)
+        {
+            ptrs[i] = (u8 *)tlsf.alloc(&tlsf, 8 + i * 13);
+            assert_true(ptrs[i] != NULL, "buffer_allocator_tlsf alloc == NULL");
+            assert_true(((uPtr)ptrs[i] & 15) == 0, "buffer_allocator_tlsf block not 16-aligned");
+            for (u64 j = 0; j < 8 + i * 13; ++j)
+                ptrs[i][j] = (u8)i;
+        }
+
+        for (u64 i = 0; i < 64; i += 2)
+        {
+            tlsf.free(&tlsf, ptrs[i]);
+            ptrs[i] = NULL;
+        }
+
+        ptrs[1] = (u8 *)tlsf.realloc(&tlsf, ptrs[1], 500);
+        assert_true(ptrs[1] != NULL, "buffer_allocator_tlsf realloc == NULL");
+        for (u64 j = 0; j < 8 + 13; ++j)
+            assert_true(ptrs[1][j] == 1, "buffer_allocator_tlsf realloc lost data");
+
+        for (u64 i = 1; i < 64; i += 2)
+        {
+            for (u64 j = 0; j < 8 + 13; ++j)
+                assert_true(ptrs[i][j] == (u8)i, "buffer_allocator_tlsf data corrupted");
+            tlsf.free(&tlsf, ptrs[i]);
+        }
+
+        assert_true(state->flBitmap == initialBitmap, "buffer_allocator_tlsf did not coalesce");
+        assert_true(tlsf.alloc(&tlsf, buffSize) == NULL, "buffer_allocator_tlsf oversized alloc != NULL");
+
+        ResAllocator res2 = buffer_allocator_tlsf((Buffer){.bytes = bytes, .size = 64});
+        assert_true(res2.err.code != ERR_OK, "buffer_allocator_tlsf res2.err.code == ERR_OK");
+
+        alloc.free(&alloc, bytes);
+    }
+    io_println("alloc_aligned");
+    {
+        u64 buffSize = 1 << 16;
+        i8 *bytes = (i8 *)alloc.alloc(&alloc, buffSize);
+        assert_true(bytes != NULL, "alloc_aligned bytes == NULL");
+
+        SlabAllocatorState slabState;
+        ResAllocator slabRes = slab_allocator(&slabState, &alloc);
+        ResAllocator arenaRes = arena_allocator_chained(&alloc, 512);
+        ResAllocator buffRes = buffer_allocator((Buffer){.bytes = bytes, .size = buffSize / 2});
+        ResAllocator tlsfRes = buffer_allocator_tlsf((Buffer){.bytes = bytes + buffSize / 2, .size = buffSize / 2});
+        assert_res_ok((Res*)&slabRes, "alloc_aligned slabRes.err.code != ERR_OK");
+        assert_res_ok((Res*)&arenaRes, "alloc_aligned arenaRes.err.code != ERR_OK");
+        assert_res_ok((Res*)&buffRes, "alloc_aligned buffRes.err.code != ERR_OK");
+        assert_res_ok((Res*)&tlsfRes, "alloc_aligned tlsfRes.err.code != ERR_OK");
+
+        Allocator allocators[5] = {alloc, slabRes.value, arenaRes.value, buffRes.value, tlsfRes.value};
+        u64 alignments[4] = {8, 64, 256, 4096};
+
+        for (u64 i = 0; i < 5; ++i)
+        {
+            Allocator *a = &allocators[i];
+            for (u64 j = 0; j < 4; ++j)
+            {
+                u8 *small = (u8 *)a->alloc(a, 24);
+                u8 *block = (u8 *)a->alloc_aligned(a, 100, alignments[j]);
+                assert_true(small != NULL && block != NULL, "alloc_aligned block == NULL");
+                assert_true(((uPtr)block & (alignments[j] - 1)) == 0, "alloc_aligned block misaligned");
+
+                for (u64 k = 0; k < 100; ++k)
+                    block[k] = (u8)k;
+
+                a->free_aligned(a, block);
+                a->free(a, small);
+            }
+        }
+
+        assert_true(allocators[0].alloc_aligned(&allocators[0], 16, 24) == NULL, "alloc_aligned non pow2 != NULL");
+
+        arena_allocator_deinit(&arenaRes.value);
+        slab_allocator_deinit(&slabRes.value);
+        alloc.free(&alloc, bytes);
+    }
+    io_println("allocator_alloc_aligned");
+    {
+        // Allocator written before the aligned hooks existed
+        Allocator legacy = alloc;
+        legacy.alloc_aligned = NULL;
+        legacy.free_aligned = NULL;
+
+        u8 *block = (u8 *)allocator_alloc_aligned(&legacy, 100, 256);
+        assert_true(block != NULL && ((uPtr)block & 255) == 0, "allocator_alloc_aligned fallback misaligned");
+        allocator_free_aligned(&legacy, block);
+
+        DebugAllocatorState dbgState;
+        ResAllocator dbgRes = debug_allocator(&dbgState, 16, &legacy);
+        assert_res_ok((Res*)&dbgRes, "allocator_alloc_aligned dbgRes.err.code != ERR_OK");
+        Allocator dbg = dbgRes.value;
+
+        block = (u8 *)allocator_alloc_aligned(&dbg, 100, 64);
+        assert_true(block != NULL && ((uPtr)block & 63) == 0, "allocator_alloc_aligned debug over legacy misaligned");
+        assert_true(dbgState.activeAllocCount == 1, "allocator_alloc_aligned debug activeAllocCount != 1");
+        allocator_free_aligned(&dbg, block);
+        assert_true(dbgState.activeAllocCount == 0, "allocator_free_aligned debug left block tracked");
+        debug_allocator_deinit(&dbgState);
+
+        SlabAllocatorState slabState;
+        ResAllocator slabRes = slab_allocator(&slabState, &legacy);
+        assert_res_ok((Res*)&slabRes, "allocator_alloc_aligned slabRes.err.code != ERR_OK");
+        Allocator slab = slabRes.value;
+        block = (u8 *)allocator_alloc_aligned(&slab, 100, 4096);
+        assert_true(block != NULL && ((uPtr)block & 4095) == 0, "allocator_alloc_aligned slab over legacy misaligned");
+        allocator_free_aligned(&slab, block);
+        slab_allocator_deinit(&slab);
+    }
+    io_println("allocator_usable_size");
+    {
+        SlabAllocatorState slabState;
+        ResAllocator slabRes = slab_allocator(&slabState, &alloc);
+        assert_res_ok((Res*)&slabRes, "allocator_usable_size slabRes.err.code != ERR_OK");
+        Allocator slab = slabRes.value;
+
+        void *block = slab.alloc(&slab, 20);
+        assert_true(allocator_usable_size(&slab, block, 20) == 32, "allocator_usable_size slab != 32");
+        assert_true(allocator_usable_size(&badAlloc, block, 20) == 20, "allocator_usable_size fallback != 20");
+        allocator_free_sized(&slab, block, 20);
+
+        ResList listRes = list_init(&slab, sizeof(u8), 8);
+        assert_res_ok((Res*)&listRes, "allocator_usable_size list_init failed");
+        List l = listRes.value;
+        void *data = l._data;
+
+        for (u8 i = 0; i < 16; ++i)
+            list_push(&l, &i);
+        assert_true(l._data == data, "allocator_usable_size list reallocated despite slack");
+        assert_true(l._allocCnt == 16, "allocator_usable_size list allocCnt != 16");
+
+        list_deinit(&l);
+        slab_allocator_deinit(&slab);
+    }
+    io_println("allocator_free_sized");
+    {
+        DebugAllocatorState dbgState;
+        ResAllocator dbgRes = debug_allocator(&dbgState, 16, &alloc);
+        assert_res_ok((Res*)&dbgRes, "allocator_free_sized dbgRes.err.code != ERR_OK");
+        Allocator dbg = dbgRes.value;
+
+        void *a = dbg.alloc(&dbg, 40);
+        void *b = dbg.alloc(&dbg, 40);
+        assert_true(allocator_usable_size(&dbg, a, 40) == 40, "allocator_free_sized debug usable != 40");
+
+        allocator_free_sized(&dbg, a, 40);
+        assert_true(dbgState.sizedFreeMismatches == 0, "allocator_free_sized mismatch on right size");
+        allocator_free_sized(&dbg, b, 12);
+        assert_true(dbgState.sizedFreeMismatches == 1, "allocator_free_sized wrong size not detected");
+        assert_true(dbgState.activeAllocCount == 0, "allocator_free_sized activeAllocCount != 0");
+
+        debug_allocator_deinit(&dbgState);
+    }
+    io_println("debug_allocator_sampled");
+    {
+        DebugAllocatorState dbgState;
+        ResAllocator dbgRes = debug_allocator_sampled(&dbgState, &alloc, 4096);
+        assert_res_ok((Res*)&dbgRes, "debug_allocator_sampled res.err.code != ERR_OK");
+        Allocator dbg = dbgRes.value;
+
+        void *blocks[256];
+        for (u32 i = 0; i < 256; ++i)
+            blocks[i] = dbg.alloc(&dbg, 1024);
+
+        assert_true(dbgState.totalMallocCalls == 256, "debug_allocator_sampled totalMallocCalls != 256");
+        assert_true(dbgState.totalAllocBytes == 256 * 1024, "debug_allocator_sampled totalAllocBytes != 256KiB");
+        assert_true(dbgState.activeAllocCount > 0 && dbgState.activeAllocCount < 256, "debug_allocator_sampled did not sample");
+        assert_true(dbgState.estimatedActiveBytes > 0, "debug_allocator_sampled estimatedActiveBytes == 0");
+
+        blocks[0] = dbg.realloc(&dbg, blocks[0], 2048);
+        for (u32 i = 0; i < 256; ++i)
+            dbg.free(&dbg, blocks[i]);
+
+        assert_true(dbgState.activeAllocCount == 0, "debug_allocator_sampled activeAllocCount != 0");
+        assert_true(dbgState.estimatedActiveBytes == 0, "debug_allocator_sampled estimatedActiveBytes != 0");
+        assert_true(dbgState.untrackedFrees == 0, "debug_allocator_sampled counted unsampled frees");
+        assert_true(dbgState.estimatedPeakBytes > 0, "debug_allocator_sampled estimatedPeakBytes == 0");
+
+        debug_allocator_deinit(&dbgState);
+    }
+    io_println("debug_allocator_track_sites");
+    {
+        DebugAllocatorState dbgState;
+        ResAllocator dbgRes = debug_allocator(&dbgState, 16, &alloc);
+        assert_res_ok((Res*)&dbgRes, "debug_allocator_track_sites dbgRes.err.code != ERR_OK");
+        Allocator dbg = dbgRes.value;
+
+        assert_ok(debug_allocator_track_sites(&dbgState, 4), "debug_allocator_track_sites err.code != ERR_OK");
+
+        void *small[8];
+        for (u32 i = 0; i < 8; ++i)
+            small[i] = dbg.alloc(&dbg, 16);
+        void *large = dbg.alloc(&dbg, 1000);
+
+        assert_true(dbgState.siteCount == 2, "debug_allocator_track_sites siteCount != 2");
+        assert_true(dbgState.sites[0].liveCount == 8 && dbgState.sites[0].liveBytes == 128, "debug_allocator_track_sites loop site counters");
+        assert_true(dbgState.sites[1].liveBytes == 1000, "debug_allocator_track_sites large site counters");
+
+        for (u32 i = 0; i < 8; ++i)
+            dbg.free(&dbg, small[i]);
+        assert_true(dbgState.sites[0].liveBytes == 0 && dbgState.sites[0].peakEstimate == 128, "debug_allocator_track_sites free not attributed");
+
+        ConstStr filePath = "xstd_heap_profile_test.tmp";
+        ResFile createRes = file_create(filePath);
+        assert_res_ok((Res*)&createRes, "debug_allocator_write_profile file_create err");
+        File file = createRes.value;
+        assert_ok(debug_allocator_write_profile(&dbgState, &file), "debug_allocator_write_profile err.code != ERR_OK");
+        assert_ok(debug_allocator_write_pprof(&dbgState, &file), "debug_allocator_write_pprof err.code != ERR_OK");
+        file_close(&file);
+
+        ResFile readRes = file_open(filePath, EnumFileOpenMode.READ);
+        assert_res_ok((Res*)&readRes, "debug_allocator_write_profile file_open err");
+        ResOwnedStr contentRes = file_readall_str(&alloc, &readRes.value);
+        assert_res_ok((Res*)&contentRes, "debug_allocator_write_profile readall err");
+        assert_true(string_starts_with(contentRes.value, "# xstd heap profile, exact\n"), "debug_allocator_write_profile header");
+        assert_true(string_find(contentRes.value, "\n1000 1000 1 1000 1 0x") > 0, "debug_allocator_write_profile large site not first");
+        assert_true(string_find(contentRes.value, "heap profile: 1: 1000 [9: 1128] @ heap_v2/1\n") > 0, "debug_allocator_write_pprof header");
+        alloc.free(&alloc, contentRes.value);
+        file_close(&readRes.value);
+
+        dbg.free(&dbg, large);
+        debug_allocator_deinit(&dbgState);
+        assert_true(dbgState.activeOverheadBytes == 0, "debug_allocator_deinit overhead != 0");
+    }
+    io_println("atomic_arena_allocator");
+    {
+        u8 bytes[4096];
+        AtomicArenaState state;
+        Buffer buff = {.bytes = (i8 *)bytes, .size = sizeof(bytes)};
+
+        ResAllocator res = atomic_arena_allocator(&state, buff, 1024);
+        assert_res_ok((Res*)&res, "atomic_arena_allocator res.err.code != ERR_OK");
+        Allocator shared = res.value;
+
+        AtomicArenaWorker worker;
+        ResAllocator workerRes = atomic_arena_worker(&worker, &state);
+        assert_res_ok((Res*)&workerRes, "atomic_arena_worker res.err.code != ERR_OK");
+        Allocator w = workerRes.value;
+
+        u64 *first = (u64 *)shared.alloc(&shared, sizeof(u64));
+        assert_true(first != NULL && ((uPtr)first & 15) == 0, "atomic_arena_allocator first misaligned");
+        *first = 42;
+
+        u8 *small = (u8 *)w.alloc(&w, 24);
+        assert_true(small != NULL, "atomic_arena_worker small == NULL");
+        assert_true(atomic_arena_used(&state) == 32 + 1024, "atomic_arena_worker did not take a sub-chunk");
+
+        u8 *grown = (u8 *)w.realloc(&w, small, 200);
+        assert_true(grown == small, "atomic_arena_worker last block not grown in place");
+        grown[199] = 1;
+
+        u8 *other = (u8 *)w.alloc(&w, 16);
+        u8 *moved = (u8 *)w.realloc(&w, grown, 400);
+        assert_true(moved != grown && moved != NULL && moved[199] == 1, "atomic_arena_worker realloc did not copy");
+        assert_true(other != NULL && *first == 42, "atomic_arena_worker overwrote shared block");
+
+        u8 *fromNull = (u8 *)w.realloc(&w, NULL, 24);
+        assert_true(fromNull != NULL && allocator_usable_size(&w, fromNull, 0) == 24, "atomic_arena_worker realloc NULL block did not allocate");
+        fromNull = (u8 *)shared.realloc(&shared, NULL, 24);
+        assert_true(fromNull != NULL && allocator_usable_size(&shared, fromNull, 0) == 24, "atomic_arena_allocator realloc NULL block did not allocate");
+
+        u64 used = atomic_arena_used(&state);
+        assert_true(shared.alloc(&shared, 3100) == NULL, "atomic_arena_allocator over capacity != NULL");
+        assert_true(atomic_arena_used(&state) == used, "atomic_arena_allocator failed bump moved the offset");
+        assert_true(shared.alloc(&shared, 16) != NULL, "atomic_arena_allocator alloc after failed bump == NULL");
+        assert_true(atomic_arena_used(&state) == used + 32, "atomic_arena_allocator alloc after failed bump used");
+
+        atomic_arena_reset(&state);
+        assert_true(atomic_arena_used(&state) == 0, "atomic_arena_reset used != 0");
+        assert_true(w.alloc(&w, 16) != NULL, "atomic_arena_worker alloc after reset == NULL");
+        assert_true(atomic_arena_used(&state) == 1024, "atomic_arena_worker kept stale sub-chunk");
+
+        // Aligned blocks carry a header of their own, usable size stays inside the block
+        u8 *aligned = (u8 *)shared.alloc_aligned(&shared, 100, 64);
+        u64 usable = allocator_usable_size(&shared, aligned, 100);
+        assert_true(aligned != NULL && ((uPtr)aligned & 63) == 0, "atomic_arena_allocator aligned misaligned");
+        assert_true(usable >= 100 && (i8 *)aligned + usable <= state.buffer + atomic_arena_used(&state), "atomic_arena_allocator aligned usable size past the block");
+        aligned = (u8 *)w.alloc_aligned(&w, 100, 256);
+        usable = allocator_usable_size(&w, aligned, 100);
+        assert_true(aligned != NULL && ((uPtr)aligned & 255) == 0, "atomic_arena_worker aligned misaligned");
+        assert_true(usable >= 100 && (i8 *)aligned + usable <= state.buffer + atomic_arena_used(&state), "atomic_arena_worker aligned usable size past the block");
+
+        // Region smaller than the default 64KiB sub-chunk, workers bump each block
+        res = atomic_arena_allocator(&state, buff, 0);
+        assert_res_ok((Res*)&res, "atomic_arena_allocator res.err.code != ERR_OK");
+        workerRes = atomic_arena_worker(&worker, &state);
+        assert_res_ok((Res*)&workerRes, "atomic_arena_worker res.err.code != ERR_OK");
+        w = workerRes.value;
+
+        assert_true(w.alloc(&w, 32) != NULL && atomic_arena_used(&state) == 48, "atomic_arena_worker alloc without room for a sub-chunk");
+        while (w.alloc(&w, 32) != NULL)
+            ;
+        assert_true(state.capacity - atomic_arena_used(&state) < 48, "atomic_arena_worker left the end of the arena unused");
+    }
+    io_println("magazine_allocator");
+    {
+        DebugAllocatorState dbgState;
+        ResAllocator dbgRes = debug_allocator(&dbgState, 64, &alloc);
+        assert_res_ok((Res*)&dbgRes, "magazine_allocator dbgRes.err.code != ERR_OK");
+        Allocator dbg = dbgRes.value;
+
+        MagazineAllocatorState state;
+        ResAllocator res = magazine_allocator(&state, &dbg);
+        assert_res_ok((Res*)&res, "magazine_allocator res.err.code != ERR_OK");
+        Allocator mag = res.value;
+
+        u8 *first = (u8 *)mag.alloc(&mag, 40);
+        assert_true(first != NULL && state.misses == 1, "magazine_allocator first alloc did not refill");
+        assert_true(dbgState.activeAllocCount == _X_MAGAZINE_BATCH, "magazine_allocator refill not batched");
+        assert_true(allocator_usable_size(&mag, first, 40) == 48, "magazine_allocator usable != 48");
+
+        mag.free(&mag, first);
+        u8 *again = (u8 *)mag.alloc(&mag, 33);
+        assert_true(again == first && state.hits == 1, "magazine_allocator freed block not reused");
+
+        void *blocks[64];
+        for (u32 i = 0; i < 64; ++i)
+            blocks[i] = mag.alloc(&mag, 40);
+        for (u32 i = 0; i < 64; ++i)
+            mag.free(&mag, blocks[i]);
+        assert_true(state.magazines[_magazine_class_index(40)].count <= _X_MAGAZINE_CAPACITY, "magazine_allocator magazine overflow");
+
+        u8 *large = (u8 *)mag.alloc(&mag, 4096);
+        assert_true(large != NULL, "magazine_allocator large == NULL");
+        large = (u8 *)mag.realloc(&mag, large, 8192);
+        large[8191] = 1;
+        mag.free(&mag, large);
+
+        u8 *aligned = (u8 *)mag.alloc_aligned(&mag, 100, 64);
+        assert_true(aligned != NULL && ((uPtr)aligned & 63) == 0, "magazine_allocator aligned misaligned");
+        mag.free_aligned(&mag, aligned);
+
+        mag.free(&mag, again);
+        magazine_allocator_flush(&mag);
+        assert_true(dbgState.activeAllocCount == 0, "magazine_allocator_flush left blocks cached");
+
+        debug_allocator_deinit(&dbgState);
+    }
+    io_println("debug_allocator_sharded");
+    {
+        ShardedDebugAllocatorState state;
+        ResAllocator res = debug_allocator_sharded(&state, 256, &alloc);
+        assert_res_ok((Res*)&res, "debug_allocator_sharded res.err.code != ERR_OK");
+        Allocator dbg = res.value;
+
+        void *blocks[64];
+        for (u32 i = 0; i < 64; ++i)
+            blocks[i] = dbg.alloc(&dbg, 8 + i);
+
+        u32 usedShards = 0;
+        for (u32 i = 0; i < _X_DEBUG_SHARD_COUNT; ++i)
+            usedShards += state.shards[i].state.activeAllocCount > 0 ? 1u : 0u;
+        assert_true(usedShards > 1, "debug_allocator_sharded all blocks in one shard");
+        assert_true(allocator_usable_size(&dbg, blocks[3], 0) == 11, "debug_allocator_sharded usable_size != 11");
+
+        blocks[0] = dbg.realloc(&dbg, blocks[0], 4000);
+        assert_true(blocks[0] != NULL, "debug_allocator_sharded realloc == NULL");
+
+        DebugAllocatorState stats = debug_allocator_sharded_stats(&state);
+        assert_true(stats.activeAllocCount == 64, "debug_allocator_sharded_stats activeAllocCount != 64");
+        assert_true(stats.totalMallocCalls == 65, "debug_allocator_sharded_stats totalMallocCalls != 65");
+        assert_true(stats.activeUserBytes == 63 * 8 + (63 * 64) / 2 + 4000, "debug_allocator_sharded_stats activeUserBytes");
+
+        for (u32 i = 1; i < 64; ++i)
+            allocator_free_sized(&dbg, blocks[i], 8 + i);
+        dbg.free(&dbg, blocks[0]);
+
+        stats = debug_allocator_sharded_stats(&state);
+        assert_true(stats.activeAllocCount == 0 && stats.activeUserBytes == 0, "debug_allocator_sharded leaks after free");
+        assert_true(stats.sizedFreeMismatches == 0, "debug_allocator_sharded sized free mismatch");
+        assert_true(stats.untrackedFrees == 0 && stats.untrackedReallocs == 0, "debug_allocator_sharded untracked blocks");
+
+        debug_allocator_sharded_deinit(&state);
+    }
+    io_println("budget_allocator");
+    {
+        BudgetAllocatorState rootState, jsonState, ioState;
+        ResAllocator rootRes = budget_allocator(&rootState, "root", &alloc, 0);
+        assert_res_ok((Res*)&rootRes, "budget_allocator root res.err.code != ERR_OK");
+        Allocator root = rootRes.value;
+        Allocator json = budget_allocator_child(&jsonState, "json", &rootState, 256).value;
+        Allocator io = budget_allocator_child(&ioState, "io", &rootState, 0).value;
+        assert_true(jsonState.parent == &rootState && jsonState.targetAllocator == &alloc, "budget_allocator child not nested");
+
+        void *own = root.alloc(&root, 8);
+        assert_true(own != NULL && rootState.liveBytes == 8 && jsonState.liveBytes == 0, "budget_allocator root alloc not charged");
+        root.free(&root, own);
+
+        u8 *a = (u8 *)json.alloc(&json, 200);
+        assert_true(a != NULL, "budget_allocator alloc under budget failed");
+        assert_true(json.alloc(&json, 100) == NULL && jsonState.failedAllocs == 1, "budget_allocator budget not enforced");
+        assert_true(jsonState.liveBytes == 200 && rootState.liveBytes == 200, "budget_allocator failed alloc not rolled back");
+
+        void *aligned = io.alloc_aligned(&io, 100, 64);
+        assert_true(aligned != NULL && ((uPtr)aligned & 63) == 0, "budget_allocator aligned misaligned");
+        assert_true(rootState.liveBytes == 300, "budget_allocator root does not include children");
+
+        a[199] = 7;
+        assert_true(json.realloc(&json, a, 300) == NULL, "budget_allocator realloc over budget");
+        a = (u8 *)json.realloc(&json, a, 250);
+        assert_true(a != NULL && a[199] == 7 && jsonState.liveBytes == 250, "budget_allocator realloc not charged");
+        a = (u8 *)json.realloc(&json, a, 50);
+        assert_true(a != NULL && jsonState.liveBytes == 50 && jsonState.peakBytes == 250, "budget_allocator shrink not uncharged");
+
+        BudgetAllocatorSnapshot nodes[4];
+        u32 count = budget_allocator_snapshot(&rootState, nodes, 4);
+        assert_true(count == 3 && nodes[0].depth == 0 && nodes[1].depth == 1 && nodes[2].depth == 1, "budget_allocator_snapshot tree shape");
+        assert_true(nodes[0].liveBytes == 150 && nodes[0].peakBytes == 350, "budget_allocator_snapshot root counters");
+        assert_true(budget_allocator_snapshot(&jsonState, nodes, 1) == 1, "budget_allocator_snapshot left the subtree");
+
+        json.free(&json, a);
+        io.free_aligned(&io, aligned);
+        assert_true(rootState.liveBytes == 0 && jsonState.liveBytes == 0 && ioState.liveBytes == 0, "budget_allocator leak after free");
+
+        // Unlimited leaf under a capped node, the refused charge must not reach the leaf's peak
+        BudgetAllocatorState capState, leafState;
+        ResAllocator capRes = budget_allocator_child(&capState, "cap", &rootState, 64);
+        assert_res_ok((Res*)&capRes, "budget_allocator_child res.err.code != ERR_OK");
+        Allocator leaf = budget_allocator_child(&leafState, "leaf", &capState, 0).value;
+        assert_true(leaf.alloc(&leaf, 100) == NULL && leafState.failedAllocs == 1, "budget_allocator ancestor budget not enforced");
+        assert_true(leafState.peakBytes == 0 && leafState.liveBytes == 0, "budget_allocator peak recorded for a refused charge");
+
+        BudgetAllocatorState notBudget = {0};
+        ResAllocator badRes = budget_allocator_child(&leafState, "bad", &notBudget, 0);
+        assert_true(badRes.err.code != ERR_OK, "budget_allocator_child accepted an uninitialized parent");
+    }
+    io_println("allocator_alloc_batch");
+    {
+        void *ptrs[40];
+
+        assert_true(allocator_alloc_batch(default_allocator(), 24, 40, ptrs), "allocator_alloc_batch default failed");
+        for (u32 i = 0; i < 40; ++i)
+        {
+            for (u32 j = 0; j < 24; ++j)
+                ((u8 *)ptrs[i])[j] = (u8)i;
+        }
+        assert_true(((u8 *)ptrs[39])[23] == 39, "allocator_alloc_batch default blocks overlap");
+        allocator_free_batch(default_allocator(), ptrs, 40);
+
+        u8 bytes[1024];
+        Allocator arena = arena_allocator((Buffer){.bytes = (i8 *)bytes, .size = sizeof(bytes)}, false).value;
+        assert_true(allocator_alloc_batch(&arena, 20, 8, ptrs), "allocator_alloc_batch arena failed");
+        for (u32 i = 1; i < 8; ++i)
+            assert_true((i8 *)ptrs[i] - (i8 *)ptrs[i - 1] == 32 && ((uPtr)ptrs[i] & 15) == 0, "allocator_alloc_batch arena stride");
+        assert_true(!allocator_alloc_batch(&arena, 100, 100, ptrs), "allocator_alloc_batch arena overflow not rejected");
+        arena_allocator_deinit(&arena);
+
+        SlabAllocatorState slabState;
+        Allocator slab = slab_allocator(&slabState, &alloc).value;
+        void *first = slab.alloc(&slab, 40);
+        slab.free(&slab, first);
+        assert_true(allocator_alloc_batch(&slab, 40, 40, ptrs), "allocator_alloc_batch slab failed");
+        assert_true(ptrs[0] == first && allocator_usable_size(&slab, ptrs[39], 40) == 48, "allocator_alloc_batch slab free list not reused");
+        allocator_free_batch(&slab, ptrs, 40);
+        assert_true(allocator_alloc_batch(&slab, 1000, 2, ptrs) && slabState.largeAllocCount == 2, "allocator_alloc_batch slab large");
+        allocator_free_batch(&slab, ptrs, 2);
+        assert_true(slabState.largeAllocCount == 0, "allocator_free_batch slab large");
+        slab_allocator_deinit(&slab);
+
+        Allocator bad = _xstd_bad_alloc();
+        ptrs[0] = NULL;
+        assert_true(!allocator_alloc_batch(&bad, 8, 4, ptrs), "allocator_alloc_batch fallback did not fail");
+        assert_true(allocator_alloc_batch(&alloc, 8, 0, ptrs), "allocator_alloc_batch empty batch failed");
+    }
+#if !_X_PLAT_WIN
+    io_println("posix_allocator");
+    {
+        Allocator *posix = &_posix_allocator;
+        u64 page = (u64)sysconf(_SC_PAGESIZE);
+
+        posix_allocator_release_cache();
+        posix_allocator_set_cache_limits(64 * page, 4 * page);
+        PosixAllocatorStats before = posix_allocator_stats();
+
+        u8 *a = (u8 *)posix->alloc(posix, 3 * page - 64);
+        u8 *b = (u8 *)posix->alloc(posix, page);
+        assert_true(a && b, "posix_allocator alloc == NULL");
+        a[3 * page - 65] = 1;
+        b[page - 1] = 1;
+
+        PosixAllocatorStats stats = posix_allocator_stats();
+        assert_true(stats.cacheMisses == before.cacheMisses + 2 && stats.mmapCalls == before.mmapCalls + 2, "posix_allocator miss counters");
+        assert_true(stats.cacheHits == before.cacheHits && stats.cachedBytes == 0, "posix_allocator hit counters");
+
+        posix->free(posix, a);
+        stats = posix_allocator_stats();
+        assert_true(stats.cachedBytes == 3 * page && stats.residentCachedBytes == 3 * page, "posix_allocator free not cached");
+        assert_true(stats.trimCount == before.trimCount, "posix_allocator trimmed below the high-water mark");
+
+        u8 *c = (u8 *)posix->alloc(posix, 3 * page - 100);
+        stats = posix_allocator_stats();
+        assert_true(c == a && stats.cacheHits == before.cacheHits + 1 && stats.cachedBytes == 0, "posix_allocator cached run not reused");
+        assert_true(stats.mmapCalls == before.mmapCalls + 2, "posix_allocator cache hit mapped memory");
+
+        posix->free(posix, c);
+        u8 *d = (u8 *)posix->alloc(posix, 5 * page);
+        stats = posix_allocator_stats();
+        assert_true(d != c && stats.cacheMisses == before.cacheMisses + 3 && stats.cachedBytes == 3 * page, "posix_allocator size mismatch hit");
+
+        // 3 + 2 resident pages go over the 4 page high-water mark
+        posix->free(posix, b);
+        stats = posix_allocator_stats();
+        assert_true(stats.trimCount == before.trimCount + 1 && stats.residentCachedBytes == 0, "posix_allocator trim did not fire");
+        assert_true(stats.cachedBytes == 5 * page, "posix_allocator trim unmapped cached runs");
+
+        u8 *e = (u8 *)posix->alloc(posix, 3 * page - 64);
+        assert_true(e == a && e[3 * page - 65] == 0, "posix_allocator trimmed run not reused");
+        posix->free(posix, e);
+
+        posix_allocator_set_cache_limits(64 * page, page);
+        stats = posix_allocator_stats();
+        assert_true(stats.trimCount == before.trimCount + 2 && stats.residentCachedBytes == 0, "posix_allocator_set_cache_limits did not trim");
+
+        posix_allocator_set_cache_limits(6 * page, 4 * page);
+        posix->free(posix, d);
+        stats = posix_allocator_stats();
+        assert_true(stats.cachedBytes == 5 * page, "posix_allocator cached past maxCachedBytes");
+
+        posix_allocator_release_cache();
+        stats = posix_allocator_stats();
+        assert_true(stats.cachedBytes == 0 && stats.residentCachedBytes == 0, "posix_allocator_release_cache left runs");
+
+        posix_allocator_set_cache_limits(_X_POSIX_CACHE_DEFAULT_MAX_BYTES, _X_POSIX_CACHE_DEFAULT_HIGH_WATER);
+    }
+    io_println("posix_allocator_huge_pages");
+    {
+        Allocator *posix = &_posix_allocator;
+        u64 huge = (u64)2 * 1024 * 1024;
+        PosixAllocatorStats before = posix_allocator_stats();
+
+        posix_allocator_configure((PosixAllocatorConfig){.hugePageThreshold = 2 * huge, .populate = false, .noReserve = false});
+
+        u8 *small = (u8 *)posix->alloc(posix, huge);
+        u8 *big = (u8 *)posix->alloc(posix, 2 * huge);
+        assert_true(small && big, "posix_allocator_huge_pages alloc == NULL");
+        assert_true(posix_allocator_stats().hugePageAllocs == before.hugePageAllocs + 1, "posix_allocator_huge_pages hugePageAllocs");
+
+        // Blocks sit right after the header at the start of the mapping
+        assert_true(((uPtr)big & (huge - 1)) == sizeof(_posix_alloc_header_t), "posix_allocator_huge_pages mapping not 2MiB aligned");
+        assert_true((allocator_usable_size(posix, big, 0) + sizeof(_posix_alloc_header_t)) % huge == 0, "posix_allocator_huge_pages size not 2MiB multiple");
+        big[0] = 7;
+
+        small[0] = 9;
+        small = (u8 *)posix->realloc(posix, small, 3 * huge);
+        assert_true(small && small[0] == 9 && ((uPtr)small & (huge - 1)) == sizeof(_posix_alloc_header_t), "posix_allocator_huge_pages realloc not 2MiB aligned");
+
+        posix->free(posix, small);
+        posix->free(posix, big);
+        posix_allocator_configure((PosixAllocatorConfig){.hugePageThreshold = 0, .populate = false, .noReserve = false});
+    }
+    io_println("arena_allocator_vm");
+    {
+        u64 reserve = (u64)4 * 1024 * 1024;
+        ResAllocator res = arena_allocator_vm(reserve);
+        assert_res_ok((Res*)&res, "arena_allocator_vm res.err.code != ERR_OK");
+
+        Allocator arena = res.value;
+        ArenaAllocatorState *state = (ArenaAllocatorState *)arena._internalState;
+        i8 *base = state->buffer;
+        u64 committed = state->capacity;
+
+        u8 *block = (u8 *)arena.alloc(&arena, 1000);
+        assert_true(block != NULL, "arena_allocator_vm alloc == NULL");
+        block[0] = 42;
+
+        // Each size is past the committed range, so every realloc commits more pages
+        u64 sizes[] = {committed, 3 * committed, 16 * committed, reserve / 2};
+        for (u32 i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+        {
+            u64 before = state->capacity;
+            assert_true(arena.realloc(&arena, block, sizes[i]) == block, "arena_allocator_vm realloc moved the last block");
+            assert_true(state->capacity > before, "arena_allocator_vm realloc did not commit");
+            block[sizes[i] - 1] = (u8)i;
+        }
+        assert_true(block[0] == 42, "arena_allocator_vm realloc lost data");
+
+        assert_true(arena.alloc(&arena, reserve) == NULL, "arena_allocator_vm alloc past the reserve != NULL");
+        assert_true(arena.realloc(&arena, block, reserve) == NULL, "arena_allocator_vm realloc past the reserve != NULL");
+        assert_true(arena.alloc(&arena, 16) != NULL, "arena_allocator_vm alloc after failure == NULL");
+
+        u8 *aligned = (u8 *)arena.alloc_aligned(&arena, 100, 4096);
+        assert_true(aligned && ((uPtr)aligned & 4095) == 0, "arena_allocator_vm alloc_aligned not aligned");
+        aligned = (u8 *)arena.alloc_aligned(&arena, 100, 64 * 1024);
+        assert_true(aligned && ((uPtr)aligned & (64 * 1024 - 1)) == 0, "arena_allocator_vm alloc_aligned 64KiB not aligned");
+        aligned[99] = 1;
+
+        arena_allocator_clear(&arena);
+        u8 *reused = (u8 *)arena.alloc(&arena, 1000);
+        assert_true(reused == block, "arena_allocator_clear did not rewind");
+        assert_true(arena.realloc(&arena, reused, reserve / 2) == reused, "arena_allocator_clear arena not reusable");
+#if defined(__linux__)
+        // Decommitted pages are zero filled when touched again
+        assert_true(reused[sizes[1] - 1] == 0 && reused[reserve / 2 - 1] == 0, "arena_allocator_clear did not decommit");
+#endif
+
+        arena_allocator_deinit(&arena);
+        assert_true(arena._internalState == NULL, "arena_allocator_deinit _internalState != NULL");
+        assert_true(msync(base, reserve, MS_ASYNC) != 0, "arena_allocator_deinit did not unmap the range");
+
+        ResAllocator res2 = arena_allocator_vm(0);
+        assert_true(res2.err.code != ERR_OK, "arena_allocator_vm(0) res.err.code == ERR_OK");
+    }
+#endif
+}
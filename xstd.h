@@ -11,13 +11,23 @@
 #include "xstd/xstd_alloc_default.h"
 #include "xstd/xstd_buffer.h"
 #include "xstd/xstd_list.h"
+#include "xstd/xstd_slotmap.h"
 #include "xstd/xstd_utf16.h"
 #include "xstd/xstd_utf8.h"
 #include "xstd/xstd_string.h"
 #include "xstd/xstd_writer.h"
 #include "xstd/xstd_file.h"
 #include "xstd/xstd_io.h"
+#include "xstd/xstd_hash.h"
 #include "xstd/xstd_hashmap.h"
+#include "xstd/xstd_hashmap_flat.h"
+#include "xstd/xstd_hashmap_u64.h"
 #include "xstd/xstd_time.h"
 #include "xstd/xstd_alloc_arena.h"
+#include "xstd/xstd_alloc_slab.h"
+#include "xstd/xstd_alloc_atomic_arena.h"
+#include "xstd/xstd_alloc_magazine.h"
+#include "xstd/xstd_alloc_budget.h"
 #include "xstd/xstd_alloc_debug.h"
+#include "xstd/xstd_alloc_debug_profile.h"
+#include "xstd/xstd_alloc_debug_sharded.h"
@@ -5,12 +5,234 @@
 
 // Struct with methods to manipulate heap memory, implementations can be created
 // by overwriting those methods. Get the default allocator using `default_allocator()`
+//
+// Blocks returned by `alloc_aligned` must be released with `free_aligned`, and
+// cannot be passed to `realloc`. `alignment` must be a power of two. Both may be
+// NULL in hand-written allocators, prefer `allocator_alloc_aligned()` and
+// `allocator_free_aligned()` which fall back to over-allocating with `alloc`.
+//
+// `usable_size`, `free_sized`, `alloc_batch` and `free_batch` are optional and
+// may be NULL, prefer calling them through `allocator_usable_size()`,
+// `allocator_free_sized()`, `allocator_alloc_batch()` and `allocator_free_batch()`.
 typedef struct _allocator_t
 {
     void *_internalState;
     void *(*alloc)(struct _allocator_t *a, u64 allocSize);
     void *(*realloc)(struct _allocator_t *a, void *block, u64 newSize);
     void (*free)(struct _allocator_t *a, void *block);
+    void *(*alloc_aligned)(struct _allocator_t *a, u64 allocSize, u64 alignment);
+    void (*free_aligned)(struct _allocator_t *a, void *block);
+    u64 (*usable_size)(struct _allocator_t *a, void *block);
+    void (*free_sized)(struct _allocator_t *a, void *block, u64 size);
+    Bool (*alloc_batch)(struct _allocator_t *a, u64 allocSize, u64 count, void **outPtrs);
+    void (*free_batch)(struct _allocator_t *a, void **blocks, u64 count);
 } Allocator;
 
 result_define(Allocator, Allocator);
+
+static inline Bool _allocator_is_pow2(u64 value)
+{
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+static inline u64 _allocator_align_up(u64 value, u64 alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+/**
+ * @brief Returns the amount of bytes that can be used in `block`, which may be
+ * more than requested when the allocator rounds sizes up.
+ *
+ * Memory past `requestedSize` can be used without calling `realloc`.
+ *
+ * ```c
+ * u8 *bytes = a->alloc(a, 100);
+ * u64 usable = allocator_usable_size(a, bytes, 100);
+ * // usable >= 100
+ * ```
+ *
+ * @param a
+ * @param block
+ * @param requestedSize size the block was allocated or last reallocated with
+ * @return u64 `requestedSize` if the allocator cannot tell
+ */
+static inline u64 allocator_usable_size(Allocator *a, void *block, u64 requestedSize)
+{
+    if (!a || !block || !a->usable_size)
+        return requestedSize;
+
+    u64 usable = a->usable_size(a, block);
+    return usable > requestedSize ? usable : requestedSize;
+}
+
+/**
+ * @brief Frees `block` while passing its size to the allocator, sparing it a
+ * lookup. Falls back to `free` if the allocator has no sized free.
+ *
+ * @param a
+ * @param block
+ * @param size any value between the requested size and the usable size of the block
+ */
+static inline void allocator_free_sized(Allocator *a, void *block, u64 size)
+{
+    if (!a || !block)
+        return;
+
+    if (a->free_sized)
+        a->free_sized(a, block, size);
+    else
+        a->free(a, block);
+}
+
+/**
+ * @brief Allocates `count` blocks of `size` bytes in one call, each one can
+ * later be freed or reallocated on its own. All or nothing: on failure no
+ * block is left allocated.
+ *
+ * Allocators with a native batch path serve the whole group at once, others
+ * fall back to one `alloc` per block.
+ *
+ * ```c
+ * Json *nodes[8];
+ * if (!allocator_alloc_batch(a, sizeof(Json), 8, (void **)nodes)) // Error!
+ * // Use nodes
+ * allocator_free_batch(a, (void **)nodes, 8);
+ * ```
+ *
+ * @param a
+ * @param size
+ * @param count
+ * @param outPtrs array of at least `count` pointers, receives the blocks
+ * @return Bool false if allocation failed
+ */
+static inline Bool allocator_alloc_batch(Allocator *a, u64 size, u64 count, void **outPtrs)
+{
+    if (!a || !outPtrs || size == 0)
+        return false;
+
+    if (a->alloc_batch)
+        return a->alloc_batch(a, size, count, outPtrs);
+
+    for (u64 i = 0; i < count; ++i)
+    {
+        outPtrs[i] = a->alloc(a, size);
+        if (!outPtrs[i])
+        {
+            while (i > 0)
+                a->free(a, outPtrs[--i]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Frees `count` blocks in one call. Blocks may come from `alloc`,
+ * `realloc` or `allocator_alloc_batch()`, NULL entries are skipped.
+ *
+ * @param a
+ * @param blocks
+ * @param count
+ */
+static inline void allocator_free_batch(Allocator *a, void **blocks, u64 count)
+{
+    if (!a || !blocks)
+        return;
+
+    if (a->free_batch)
+    {
+        a->free_batch(a, blocks, count);
+        return;
+    }
+
+    for (u64 i = 0; i < count; ++i)
+    {
+        if (blocks[i])
+            a->free(a, blocks[i]);
+    }
+}
+
+/**
+ * @brief Aligned allocation built on top of `a->alloc`, for allocators without
+ * a way to request aligned memory from their source.
+ *
+ * Over-allocates by `alignment` bytes and stores the original block right
+ * before the returned one. Release with `_allocator_free_aligned_fallback()`.
+ *
+ * @param a
+ * @param size
+ * @param alignment power of two
+ * @return void*
+ */
+static inline void *_allocator_alloc_aligned_fallback(Allocator *a, u64 size, u64 alignment)
+{
+    if (!a || size == 0 || !_allocator_is_pow2(alignment))
+        return NULL;
+
+    if (alignment < sizeof(void *))
+        alignment = sizeof(void *);
+
+    if (size > ((u64)-1) - alignment - sizeof(void *))
+        return NULL;
+
+    i8 *raw = (i8 *)a->alloc(a, size + alignment + sizeof(void *));
+    if (!raw)
+        return NULL;
+
+    i8 *aligned = (i8 *)(uPtr)_allocator_align_up((uPtr)(raw + sizeof(void *)), alignment);
+    ((void **)aligned)[-1] = raw;
+    return aligned;
+}
+
+static inline void _allocator_free_aligned_fallback(Allocator *a, void *block)
+{
+    if (!a || !block)
+        return;
+
+    a->free(a, ((void **)block)[-1]);
+}
+
+/**
+ * @brief Allocates `size` bytes aligned to `alignment`. Uses the allocator's
+ * `alloc_aligned`, or over-allocates with `alloc` when it has none.
+ *
+ * ```c
+ * void *block = allocator_alloc_aligned(a, 256, 64);
+ * if (!block) // Error!
+ * allocator_free_aligned(a, block);
+ * ```
+ *
+ * @param a
+ * @param size
+ * @param alignment power of two
+ * @return void*
+ */
+static inline void *allocator_alloc_aligned(Allocator *a, u64 size, u64 alignment)
+{
+    if (!a)
+        return NULL;
+
+    if (a->alloc_aligned)
+        return a->alloc_aligned(a, size, alignment);
+
+    return _allocator_alloc_aligned_fallback(a, size, alignment);
+}
+
+/**
+ * @brief Frees a block returned by `allocator_alloc_aligned()`.
+ *
+ * @param a
+ * @param block
+ */
+static inline void allocator_free_aligned(Allocator *a, void *block)
+{
+    if (!a || !block)
+        return;
+
+    if (a->free_aligned)
+        a->free_aligned(a, block);
+    else
+        _allocator_free_aligned_fallback(a, block);
+}
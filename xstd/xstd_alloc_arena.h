@@ -4,17 +4,48 @@
 #include "xstd_result.h"
 #include "xstd_buffer.h"
 #include "xstd_alloc.h"
+#include "xstd_mem.h"
+
+// Header placed at the start of every block chained after the first one
+typedef struct _arena_block_header
+{
+    struct _arena_block_header *prev; // previously chained block, NULL if previous is the first block
+    u64 capacity;                     // total size of the block, header included
+} _ArenaBlockHeader;
 
 // ArenaAllocator State
 typedef struct _arena_allocator_state
 {
-    i8 *buffer;        // start of buffer
-    u64 capacity;      // total size
+    i8 *buffer;        // start of current block
+    u64 capacity;      // total size of current block
     u64 headerSize;    // size of aligned state
-    u64 offset;        // bytes used
+    u64 offset;        // bytes used in current block
     Bool bufferOwned; // if true, buffer is heap-allocated and should be freed
+    i8 *lastAlloc;     // start of the most recent allocation, resized and freed in place, NULL if unknown
+
+    Allocator *backingAllocator;  // if not NULL, arena chains new blocks from it when full
+    _ArenaBlockHeader *lastBlock; // most recently chained block, NULL while in first block
+    i8 *firstBuffer;              // start of the first block, holding this state
+    u64 firstCapacity;            // total size of the first block
+    u64 nextBlockSize;            // size of the next chained block, doubles on each chain
+
+    // Virtual memory hooks, set by `arena_allocator_vm()`, NULL otherwise
+    u64 reservedCapacity;                                                  // size of the reserved range, `capacity` being its committed part
+    Bool (*commit)(struct _arena_allocator_state *state, u64 minCapacity); // commits pages until `capacity >= minCapacity`
+    void (*decommit)(struct _arena_allocator_state *state);                // releases physical memory of pages past `offset`
+    void (*release)(struct _arena_allocator_state *state);                 // unmaps the reserved range, state included
 } ArenaAllocatorState;
 
+// Saved position of an arena, see `arena_mark()` and `arena_rewind()`
+typedef struct _arena_mark
+{
+    _ArenaBlockHeader *block; // chained block current at time of mark, NULL for first block
+    u64 offset;               // bytes used in that block at time of mark
+    i8 *lastAlloc;            // most recent allocation at time of mark
+} ArenaMark;
+
+#define _X_ARENA_BLOCK_HEADER_SIZE (_arena_offset_to_aligned(sizeof(_ArenaBlockHeader)))
+
 static inline u64 _arena_offset_to_aligned(u64 offset)
 {
     const u64 defaultAlign = 16;
@@ -32,6 +63,45 @@ static inline Bool _arena_offset_invalid(u64 totalCapacity, u64 alignedOffset, u
     return false;
 }
 
+// Grows a virtual memory arena so that `size` bytes fit at `offset`
+static inline Bool _arena_commit(ArenaAllocatorState *state, u64 offset, u64 size)
+{
+    if (!state->commit || offset > ((u64)-1) - size)
+        return false;
+
+    return state->commit(state, offset + size);
+}
+
+static void *_arena_alloc_chain(ArenaAllocatorState *state, u64 size)
+{
+    Allocator *backing = state->backingAllocator;
+    u64 blockHeaderSize = _X_ARENA_BLOCK_HEADER_SIZE;
+
+    if (size > ((u64)-1) - blockHeaderSize)
+        return NULL;
+
+    u64 blockSize = state->nextBlockSize;
+    if (blockSize < blockHeaderSize + size)
+        blockSize = blockHeaderSize + size;
+
+    _ArenaBlockHeader *block = (_ArenaBlockHeader *)backing->alloc(backing, blockSize);
+    if (!block)
+        return NULL;
+
+    block->prev = state->lastBlock;
+    block->capacity = blockSize;
+
+    state->lastBlock = block;
+    state->buffer = (i8 *)block;
+    state->capacity = blockSize;
+    state->offset = blockHeaderSize + size;
+
+    if (state->nextBlockSize <= ((u64)-1) / 2)
+        state->nextBlockSize *= 2;
+
+    return (i8 *)block + blockHeaderSize;
+}
+
 static void *_arena_alloc(Allocator *a, u64 size)
 {
     if (!a || !a->_internalState)
@@ -44,49 +114,178 @@ static void *_arena_alloc(Allocator *a, u64 size)
     u64 alignedOffset = _arena_offset_to_aligned(state->offset);
 
     if (_arena_offset_invalid(state->capacity, alignedOffset, size))
-        return NULL;
+    {
+        if (state->backingAllocator)
+        {
+            i8 *chained = (i8 *)_arena_alloc_chain(state, size);
+            if (chained)
+                state->lastAlloc = chained;
+            return chained;
+        }
+        if (!_arena_commit(state, alignedOffset, size))
+            return NULL;
+    }
 
     void *out = state->buffer + alignedOffset;
     state->offset = alignedOffset + size;
+    state->lastAlloc = (i8 *)out;
     return out;
 }
 
+// Bytes from `block` to the end of the arena block holding it, bounds what a
+// copy may read when the size of `block` is not known
+static inline u64 _arena_block_extent(ArenaAllocatorState *state, i8 *block)
+{
+    uPtr ptr = (uPtr)block;
+
+    if (ptr >= (uPtr)state->buffer && ptr < (uPtr)state->buffer + state->offset)
+        return (uPtr)state->buffer + state->offset - ptr;
+
+    _ArenaBlockHeader *chained = state->lastBlock ? state->lastBlock->prev : NULL;
+    for (; chained; chained = chained->prev)
+    {
+        if (ptr >= (uPtr)chained && ptr < (uPtr)chained + chained->capacity)
+            return (uPtr)chained + chained->capacity - ptr;
+    }
+
+    if (ptr >= (uPtr)state->firstBuffer && ptr < (uPtr)state->firstBuffer + state->firstCapacity)
+        return (uPtr)state->firstBuffer + state->firstCapacity - ptr;
+
+    return 0;
+}
+
+static void _arena_free(Allocator *a, void *block);
+
 static void *_arena_realloc(Allocator *a, void *block, u64 newSize)
 {
     if (!a || !a->_internalState)
         return NULL;
 
+    if (!block)
+        return _arena_alloc(a, newSize);
+
     ArenaAllocatorState *state = (ArenaAllocatorState *)a->_internalState;
-    if (!state->buffer || newSize == 0 || !block)
+    if (!state->buffer)
+        return NULL;
+
+    if (newSize == 0)
+    {
+        _arena_free(a, block);
         return NULL;
+    }
 
     i8 *blockPtr = (i8 *)block;
-    u64 blockOffset = blockPtr - state->buffer;
 
-    // If block is at end
-    if (blockOffset == (_arena_offset_to_aligned(state->offset) - newSize))
+    // Top of the arena, grows or shrinks in place
+    if (blockPtr == state->lastAlloc)
+    {
+        u64 blockOffset = (u64)(blockPtr - state->buffer);
+
+        if (!_arena_offset_invalid(state->capacity, blockOffset, newSize) || _arena_commit(state, blockOffset, newSize))
+        {
+            state->offset = blockOffset + newSize;
+            return block;
+        }
+    }
+
+    // Size of older blocks is not recorded, copies whatever may belong to them
+    u64 extent = _arena_block_extent(state, blockPtr);
+
+    void *newBlock = _arena_alloc(a, newSize);
+    if (!newBlock)
+        return NULL;
+
+    mem_copy(newBlock, block, extent < newSize ? extent : newSize);
+    return newBlock;
+}
+
+static void *_arena_alloc_aligned(Allocator *a, u64 size, u64 alignment)
+{
+    if (!a || !a->_internalState || !_allocator_is_pow2(alignment))
+        return NULL;
+
+    ArenaAllocatorState *state = (ArenaAllocatorState *)a->_internalState;
+    if (!state->buffer || size == 0)
+        return NULL;
+
+    // Unlike `_arena_alloc`, aligns the address rather than the offset
+    uPtr base = (uPtr)state->buffer;
+    u64 alignedOffset = _allocator_align_up(base + state->offset, alignment) - base;
+
+    if (alignedOffset < state->offset || _arena_offset_invalid(state->capacity, alignedOffset, size))
     {
-        u64 alignedOffset = _arena_offset_to_aligned(blockOffset);
+        if (alignedOffset >= state->offset && _arena_commit(state, alignedOffset, size))
+        {
+            state->offset = alignedOffset + size;
+            state->lastAlloc = state->buffer + alignedOffset;
+            return state->lastAlloc;
+        }
+
+        if (!state->backingAllocator || size > ((u64)-1) - alignment)
+            return NULL;
 
-        if (_arena_offset_invalid(state->capacity, alignedOffset, newSize))
+        i8 *chained = (i8 *)_arena_alloc_chain(state, size + alignment);
+        if (!chained)
             return NULL;
 
-        state->offset = alignedOffset + newSize;
-        return block;
+        alignedOffset = _allocator_align_up((uPtr)chained, alignment) - (uPtr)state->buffer;
     }
 
-    return _arena_alloc(a, newSize);
+    state->offset = alignedOffset + size;
+    state->lastAlloc = state->buffer + alignedOffset;
+    return state->lastAlloc;
 }
 
+// Only the most recent allocation gives its space back
 static void _arena_free(Allocator *a, void *block)
+{
+    if (!a || !a->_internalState || !block)
+        return;
+
+    ArenaAllocatorState *state = (ArenaAllocatorState *)a->_internalState;
+    if ((i8 *)block != state->lastAlloc)
+        return;
+
+    state->offset = (u64)((i8 *)block - state->buffer);
+    state->lastAlloc = NULL;
+}
+
+// Bumps the whole group at once, blocks are laid out 16 bytes apart
+static Bool _arena_alloc_batch(Allocator *a, u64 size, u64 count, void **outPtrs)
+{
+    if (count == 0)
+        return true;
+
+    u64 stride = _arena_offset_to_aligned(size);
+    if (stride < size || count - 1 > (((u64)-1) - size) / stride)
+        return false;
+
+    i8 *bytes = (i8 *)_arena_alloc(a, stride * (count - 1) + size);
+    if (!bytes)
+        return false;
+
+    for (u64 i = 0; i < count; ++i)
+        outPtrs[i] = bytes + i * stride;
+
+    // Resizing the first block in place would overwrite the others
+    ArenaAllocatorState *state = (ArenaAllocatorState *)a->_internalState;
+    state->lastAlloc = (i8 *)outPtrs[count - 1];
+    return true;
+}
+
+static void _arena_free_batch(Allocator *a, void **blocks, u64 count)
 {
     (void)a;
-    (void)block;
+    (void)blocks;
+    (void)count;
 }
 
 /**
  * @brief Clears the contents of the of the arena, allows for reuse.
  *
+ * Arenas created with `arena_allocator_vm()` also return the physical memory
+ * of their committed pages to the OS, the address range stays reserved.
+ *
  * IMPORTANT: Make sure no dangling pointers are pointing to arena memory as those
  * pointers will become invalid and cause undefined behavior.
  *
@@ -95,7 +294,143 @@ static void _arena_free(Allocator *a, void *block)
 static inline void arena_allocator_clear(Allocator *arena)
 {
     ArenaAllocatorState *state = (ArenaAllocatorState *)arena->_internalState;
+
+    if (state->backingAllocator)
+    {
+        Allocator *backing = state->backingAllocator;
+        _ArenaBlockHeader *block = state->lastBlock;
+
+        while (block)
+        {
+            _ArenaBlockHeader *prev = block->prev;
+            backing->free(backing, block);
+            block = prev;
+        }
+
+        state->lastBlock = NULL;
+        state->nextBlockSize = state->firstCapacity * 2;
+    }
+
+    state->buffer = state->firstBuffer;
+    state->capacity = state->firstCapacity;
     state->offset = state->headerSize;
+    state->lastAlloc = NULL;
+
+    if (state->decommit)
+        state->decommit(state);
+}
+
+/**
+ * @brief Saves the current position of the arena, allocations made after this
+ * call can be released all at once with `arena_rewind()`.
+ *
+ * The last allocation made before the mark is no longer resized in place
+ * until the mark is rewound, `realloc` moves it instead.
+ *
+ * ```c
+ * ArenaMark mark = arena_mark(&arena);
+ * // Temporary allocations
+ * arena_rewind(&arena, mark);
+ * ```
+ *
+ * @param arena
+ * @return ArenaMark
+ */
+static inline ArenaMark arena_mark(Allocator *arena)
+{
+    ArenaAllocatorState *state = (ArenaAllocatorState *)arena->_internalState;
+    ArenaMark mark = {
+        .block = state->lastBlock,
+        .offset = state->offset,
+        .lastAlloc = state->lastAlloc,
+    };
+
+    // Pins the top block until the rewind, growing it in place would cross the mark
+    state->lastAlloc = NULL;
+    return mark;
+}
+
+/**
+ * @brief Releases every allocation made since `mark` was taken, blocks chained
+ * since then are returned to the backing allocator.
+ *
+ * Marks must be rewound in reverse order of creation, rewinding to a mark
+ * taken after the last rewind or clear is undefined behavior.
+ *
+ * IMPORTANT: Make sure no dangling pointers are pointing to memory allocated
+ * after the mark as those pointers will become invalid.
+ *
+ * @param arena
+ * @param mark
+ */
+static inline void arena_rewind(Allocator *arena, ArenaMark mark)
+{
+    ArenaAllocatorState *state = (ArenaAllocatorState *)arena->_internalState;
+
+    if (state->lastBlock != mark.block)
+    {
+        Allocator *backing = state->backingAllocator;
+        _ArenaBlockHeader *block = state->lastBlock;
+
+        while (block && block != mark.block)
+        {
+            _ArenaBlockHeader *prev = block->prev;
+            backing->free(backing, block);
+            block = prev;
+        }
+
+        state->lastBlock = mark.block;
+        if (mark.block)
+        {
+            state->buffer = (i8 *)mark.block;
+            state->capacity = mark.block->capacity;
+        }
+        else
+        {
+            state->buffer = state->firstBuffer;
+            state->capacity = state->firstCapacity;
+        }
+    }
+
+    state->offset = mark.offset;
+    state->lastAlloc = mark.lastAlloc;
+}
+
+/**
+ * @brief Frees every block owned by a chained arena created with `arena_allocator_chained()`,
+ * or unmaps the range reserved by `arena_allocator_vm()`.
+ *
+ * Does nothing for arenas created with `arena_allocator()`, since the buffer is
+ * owned by the caller.
+ *
+ * IMPORTANT: Invalidates the arena and all pointers to its memory.
+ *
+ * @param arena
+ */
+static inline void arena_allocator_deinit(Allocator *arena)
+{
+    if (!arena || !arena->_internalState)
+        return;
+
+    ArenaAllocatorState *state = (ArenaAllocatorState *)arena->_internalState;
+    if (state->release)
+    {
+        arena->_internalState = NULL;
+        state->release(state);
+        return;
+    }
+
+    if (!state->backingAllocator)
+        return;
+
+    Allocator *backing = state->backingAllocator;
+    i8 *firstBuffer = state->firstBuffer;
+
+    arena_allocator_clear(arena);
+    arena->_internalState = NULL;
+
+    // State lives inside the first block, must be freed last
+    backing->free(backing, firstBuffer);
 }
 
 static inline ArenaAllocatorState *_arena_alloc_header(Buffer buff, Bool isHeap)
@@ -115,6 +450,16 @@ static inline ArenaAllocatorState *_arena_alloc_header(Buffer buff, Bool isHeap)
         .headerSize = alignDiff + headerSize,
         .offset = alignDiff + headerSize,
         .bufferOwned = isHeap,
+        .lastAlloc = NULL,
+        .backingAllocator = NULL,
+        .lastBlock = NULL,
+        .firstBuffer = buff.bytes,
+        .firstCapacity = buff.size,
+        .nextBlockSize = 0,
+        .reservedCapacity = 0,
+        .commit = NULL,
+        .decommit = NULL,
+        .release = NULL,
     };
     return state;
 }
@@ -154,6 +499,72 @@ static inline result_type(Allocator) arena_allocator(Buffer buffer, Bool isHeap)
         .alloc = _arena_alloc,
         .realloc = _arena_realloc,
         .free = _arena_free,
+        .alloc_aligned = _arena_alloc_aligned,
+        .free_aligned = _arena_free,
+        .usable_size = NULL,
+        .free_sized = NULL,
+        .alloc_batch = _arena_alloc_batch,
+        .free_batch = _arena_free_batch,
+    };
+    return result_ok(Allocator, a);
+}
+
+/**
+ * @brief Create a growable arena allocator, chaining new blocks from `backingAllocator`
+ * whenever the current block is full. Each new block is twice the size of the
+ * previous one, large allocations get a block of their own.
+ *
+ * ```c
+ * ResAllocator arenaRes = arena_allocator_chained(default_allocator(), 4096);
+ * if (arenaRes.isErr) // Error!
+ * Allocator arena = arenaRes.value;
+ * // Do stuff with arena
+ * arena_allocator_deinit(&arena);
+ * ```
+ *
+ * Blocks are returned to `backingAllocator` on `arena_allocator_clear()` (all but
+ * the first) and on `arena_allocator_deinit()` (all of them).
+ *
+ * @param backingAllocator allocator providing the blocks, must outlive the arena
+ * @param initialBlockSize size of the first block
+ * @return Allocator
+ * @exception ERR_INVALID_PARAMETER, ERR_OUT_OF_MEMORY
+ */
+static inline result_type(Allocator) arena_allocator_chained(Allocator *backingAllocator, u64 initialBlockSize)
+{
+    if (!backingAllocator || initialBlockSize == 0 || initialBlockSize > ((u64)-1) / 2)
+        return result_err(Allocator, X_ERR_EXT("alloc_arena", "arena_allocator_chained", ERR_INVALID_PARAMETER, "null allocator or invalid size"));
+
+    u64 minSize = _arena_offset_to_aligned(sizeof(ArenaAllocatorState)) + 16;
+    if (initialBlockSize < minSize)
+        initialBlockSize = minSize;
+
+    i8 *bytes = (i8 *)backingAllocator->alloc(backingAllocator, initialBlockSize);
+    if (!bytes)
+        return result_err(Allocator, X_ERR_EXT("alloc_arena", "arena_allocator_chained", ERR_OUT_OF_MEMORY, "alloc failure"));
+
+    Buffer buff = {.bytes = bytes, .size = initialBlockSize};
+    ArenaAllocatorState *state = _arena_alloc_header(buff, true);
+    if (!state)
+    {
+        backingAllocator->free(backingAllocator, bytes);
+        return result_err(Allocator, X_ERR_EXT("alloc_arena", "arena_allocator_chained", ERR_OUT_OF_MEMORY, "alloc failure"));
+    }
+
+    state->backingAllocator = backingAllocator;
+    state->nextBlockSize = initialBlockSize * 2;
+
+    Allocator a = {
+        ._internalState = state,
+        .alloc = _arena_alloc,
+        .realloc = _arena_realloc,
+        .free = _arena_free,
+        .alloc_aligned = _arena_alloc_aligned,
+        .free_aligned = _arena_free,
+        .usable_size = NULL,
+        .free_sized = NULL,
+        .alloc_batch = _arena_alloc_batch,
+        .free_batch = _arena_free_batch,
     };
     return result_ok(Allocator, a);
 }
@@ -0,0 +1,192 @@
+#pragma once
+
+// Arena allocator over a reserved virtual address range, pages are committed
+// on demand as the arena grows. On POSIX systems, requires mmap, mprotect and
+// madvise (define _DEFAULT_SOURCE or _GNU_SOURCE before including system headers).
+
+#include "xstd_core.h"
+#include "xstd_result.h"
+#include "xstd_alloc_arena.h"
+
+#if _X_PLAT_WIN
+    #include "xstd_win32.h"
+#else
+    #include "sys/mman.h"
+    #include "unistd.h"
+
+    #ifndef MAP_ANONYMOUS
+        #define MAP_ANONYMOUS MAP_ANON
+    #endif
+
+    #ifdef MAP_NORESERVE
+        #define _X_ARENA_VM_MAP_NORESERVE MAP_NORESERVE
+    #else
+        #define _X_ARENA_VM_MAP_NORESERVE 0
+    #endif
+#endif
+
+// Pages are committed by at least this many bytes, and by at most
+// _X_ARENA_VM_MAX_COMMIT_STEP beyond what is needed
+#define _X_ARENA_VM_COMMIT_GRANULARITY ((u64)64 * 1024)
+#define _X_ARENA_VM_MAX_COMMIT_STEP ((u64)64 * 1024 * 1024)
+
+static inline u64 _arena_vm_page_size(void)
+{
+#if _X_PLAT_WIN
+    return 4096;
+#else
+    long result = sysconf(_SC_PAGESIZE);
+    return result > 0 ? (u64)result : 4096;
+#endif
+}
+
+static inline u64 _arena_vm_granularity(void)
+{
+    u64 pageSize = _arena_vm_page_size();
+    return pageSize > _X_ARENA_VM_COMMIT_GRANULARITY ? pageSize : _X_ARENA_VM_COMMIT_GRANULARITY;
+}
+
+static inline i8 *_arena_vm_reserve(u64 size)
+{
+#if _X_PLAT_WIN
+    return (i8 *)VirtualAlloc(NULL, size, _WIN_32_MEM_RESERVE, _WIN_32_PAGE_NOACCESS);
+#else
+    void *mapping = mmap(NULL, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | _X_ARENA_VM_MAP_NORESERVE, -1, 0);
+    return mapping == MAP_FAILED ? NULL : (i8 *)mapping;
+#endif
+}
+
+static inline Bool _arena_vm_commit_range(i8 *start, u64 size)
+{
+#if _X_PLAT_WIN
+    return VirtualAlloc(start, size, _WIN_32_MEM_COMMIT, _WIN_32_PAGE_READWRITE) != NULL;
+#else
+    return mprotect(start, size, PROT_READ | PROT_WRITE) == 0;
+#endif
+}
+
+static Bool _arena_vm_commit(ArenaAllocatorState *state, u64 minCapacity)
+{
+    if (minCapacity > state->reservedCapacity)
+        return false;
+
+    // Grows geometrically to keep the number of syscalls logarithmic
+    u64 step = state->capacity;
+    if (step > _X_ARENA_VM_MAX_COMMIT_STEP)
+        step = _X_ARENA_VM_MAX_COMMIT_STEP;
+
+    u64 newCapacity = state->capacity + step;
+    if (newCapacity < minCapacity)
+        newCapacity = minCapacity;
+
+    newCapacity = _allocator_align_up(newCapacity, _arena_vm_granularity());
+    if (newCapacity > state->reservedCapacity)
+        newCapacity = state->reservedCapacity;
+
+    if (!_arena_vm_commit_range(state->buffer + state->capacity, newCapacity - state->capacity))
+        return false;
+
+    // Only one block, `arena_allocator_clear()` resets capacity to the first one
+    state->capacity = newCapacity;
+    state->firstCapacity = newCapacity;
+    return true;
+}
+
+static void _arena_vm_decommit(ArenaAllocatorState *state)
+{
+    u64 keep = _allocator_align_up(state->offset, _arena_vm_page_size());
+    if (keep >= state->capacity)
+        return;
+
+    // Pages stay committed and accessible, their physical memory is released
+    // and they read back as zeros (or stale data on win32) once touched again
+#if _X_PLAT_WIN
+    VirtualAlloc(state->buffer + keep, state->capacity - keep, _WIN_32_MEM_RESET, _WIN_32_PAGE_READWRITE);
+#elif defined(MADV_DONTNEED)
+    madvise(state->buffer + keep, state->capacity - keep, MADV_DONTNEED);
+#else
+    posix_madvise(state->buffer + keep, state->capacity - keep, POSIX_MADV_DONTNEED);
+#endif
+}
+
+static void _arena_vm_release(ArenaAllocatorState *state)
+{
+    // State lives inside the mapping
+    i8 *start = state->buffer;
+    u64 size = state->reservedCapacity;
+
+#if _X_PLAT_WIN
+    (void)size;
+    VirtualFree(start, 0, _WIN_32_MEM_RELEASE);
+#else
+    munmap(start, size);
+#endif
+}
+
+/**
+ * @brief Create an arena allocator reserving `reserveSize` bytes of virtual
+ * address space up front, physical memory is only committed as the arena grows.
+ *
+ * The arena never moves nor chains blocks, so the last allocation can always be
+ * grown in place by `realloc` until the reserved range is exhausted. Reserving
+ * far more than needed (e.g. several GiB) costs nothing but address space.
+ *
+ * ```c
+ * ResAllocator arenaRes = arena_allocator_vm((u64)4 * 1024 * 1024 * 1024);
+ * if (arenaRes.isErr) // Error!
+ * Allocator arena = arenaRes.value;
+ * // Do stuff with arena
+ * arena_allocator_clear(&arena); // Memory is returned to the OS, range stays reserved
+ * arena_allocator_deinit(&arena);
+ * ```
+ *
+ * @param reserveSize size of the virtual range, rounded up to 64KiB
+ * @return Allocator
+ * @exception ERR_INVALID_PARAMETER, ERR_OUT_OF_MEMORY
+ */
+static inline result_type(Allocator) arena_allocator_vm(u64 reserveSize)
+{
+    u64 granularity = _arena_vm_granularity();
+
+    if (reserveSize == 0 || reserveSize > ((u64)-1) - granularity)
+        return result_err(Allocator, X_ERR_EXT("alloc_arena_vm", "arena_allocator_vm", ERR_INVALID_PARAMETER, "invalid size"));
+
+    reserveSize = _allocator_align_up(reserveSize, granularity);
+
+    i8 *bytes = _arena_vm_reserve(reserveSize);
+    if (!bytes)
+        return result_err(Allocator, X_ERR_EXT("alloc_arena_vm", "arena_allocator_vm", ERR_OUT_OF_MEMORY, "reserve failure"));
+
+    ArenaAllocatorState *state = NULL;
+    if (_arena_vm_commit_range(bytes, granularity))
+        state = _arena_alloc_header((Buffer){.bytes = bytes, .size = granularity}, true);
+
+    if (!state)
+    {
+#if _X_PLAT_WIN
+        VirtualFree(bytes, 0, _WIN_32_MEM_RELEASE);
+#else
+        munmap(bytes, reserveSize);
+#endif
+        return result_err(Allocator, X_ERR_EXT("alloc_arena_vm", "arena_allocator_vm", ERR_OUT_OF_MEMORY, "commit failure"));
+    }
+
+    state->reservedCapacity = reserveSize;
+    state->commit = _arena_vm_commit;
+    state->decommit = _arena_vm_decommit;
+    state->release = _arena_vm_release;
+
+    Allocator a = {
+        ._internalState = state,
+        .alloc = _arena_alloc,
+        .realloc = _arena_realloc,
+        .free = _arena_free,
+        .alloc_aligned = _arena_alloc_aligned,
+        .free_aligned = _arena_free,
+        .usable_size = NULL,
+        .free_sized = NULL,
+        .alloc_batch = _arena_alloc_batch,
+        .free_batch = _arena_free_batch,
+    };
+    return result_ok(Allocator, a);
+}
@@ -0,0 +1,379 @@
+#pragma once
+
+#include "xstd_core.h"
+#include "xstd_result.h"
+#include "xstd_buffer.h"
+#include "xstd_alloc.h"
+#include "xstd_mem.h"
+
+#define _X_ATOMIC_ARENA_ALIGN 16u
+#define _X_ATOMIC_ARENA_DEFAULT_CHUNK_SIZE ((u64)64 * 1024)
+
+// Placed right before every block returned by an atomic arena
+typedef struct _atomic_arena_block_header
+{
+    u64 size; // usable size of the block
+    u64 _reserved;
+} _AtomicArenaBlockHeader;
+
+// AtomicArenaAllocator State, shared by every thread allocating from the region
+typedef struct _atomic_arena_state
+{
+    i8 *buffer;    // start of the region, 16 bytes aligned
+    u64 capacity;  // usable size of the region
+    u64 offset;    // bytes handed out, only accessed atomically
+    u64 chunkSize; // size of the sub-chunks taken by workers
+    u64 epoch;     // incremented on each reset, workers drop their sub-chunk when it changes
+} AtomicArenaState;
+
+// Per-thread view of an atomic arena, see `atomic_arena_worker()`
+typedef struct _atomic_arena_worker
+{
+    AtomicArenaState *arena;
+    i8 *cursor;     // next free byte of the current sub-chunk
+    i8 *end;        // end of the current sub-chunk
+    i8 *lastBlock;  // most recent allocation from the sub-chunk, can grow in place
+    u64 epoch;      // arena epoch the sub-chunk was taken in
+} AtomicArenaWorker;
+
+#define _X_ATOMIC_ARENA_HEADER_SIZE ((u64)sizeof(_AtomicArenaBlockHeader))
+
+static inline u64 _atomic_arena_align(u64 size)
+{
+    return _allocator_align_up(size, _X_ATOMIC_ARENA_ALIGN);
+}
+
+static inline _AtomicArenaBlockHeader *_atomic_arena_header(void *block)
+{
+    return ((_AtomicArenaBlockHeader *)block) - 1;
+}
+
+// Lock-free fast path, `size` must be a multiple of _X_ATOMIC_ARENA_ALIGN
+static inline i8 *_atomic_arena_bump(AtomicArenaState *state, u64 size)
+{
+    if (size > state->capacity)
+        return NULL;
+
+    // Compare-and-swap so a failed bump leaves `offset` untouched, smaller
+    // requests can still fit in the remaining space
+    u64 offset = __atomic_load_n(&state->offset, __ATOMIC_RELAXED);
+    do
+    {
+        if (offset > state->capacity - size)
+            return NULL;
+    } while (!__atomic_compare_exchange_n(&state->offset, &offset, offset + size, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    return state->buffer + offset;
+}
+
+// Returns the total size of a block with its header, 0 on overflow
+static inline u64 _atomic_arena_block_size(u64 size)
+{
+    if (size == 0 || size > ((u64)-1) - _X_ATOMIC_ARENA_HEADER_SIZE - _X_ATOMIC_ARENA_ALIGN)
+        return 0;
+
+    return _atomic_arena_align(size + _X_ATOMIC_ARENA_HEADER_SIZE);
+}
+
+static inline void *_atomic_arena_init_block(i8 *bytes, u64 size)
+{
+    _AtomicArenaBlockHeader *header = (_AtomicArenaBlockHeader *)bytes;
+    header->size = size;
+    return header + 1;
+}
+
+static void *_atomic_arena_alloc(Allocator *a, u64 size)
+{
+    if (!a || !a->_internalState)
+        return NULL;
+
+    AtomicArenaState *state = (AtomicArenaState *)a->_internalState;
+    u64 blockSize = _atomic_arena_block_size(size);
+    if (blockSize == 0)
+        return NULL;
+
+    i8 *bytes = _atomic_arena_bump(state, blockSize);
+    if (!bytes)
+        return NULL;
+
+    return _atomic_arena_init_block(bytes, size);
+}
+
+static void *_atomic_arena_realloc(Allocator *a, void *block, u64 newSize)
+{
+    if (!block)
+        return _atomic_arena_alloc(a, newSize);
+
+    if (!a || !a->_internalState || newSize == 0)
+        return NULL;
+
+    _AtomicArenaBlockHeader *header = _atomic_arena_header(block);
+    if (newSize <= header->size)
+        return block;
+
+    void *newBlock = a->alloc(a, newSize);
+    if (!newBlock)
+        return NULL;
+
+    mem_copy(newBlock, block, header->size);
+    return newBlock;
+}
+
+static void _atomic_arena_free(Allocator *a, void *block)
+{
+    (void)a;
+    (void)block;
+}
+
+static u64 _atomic_arena_usable_size(Allocator *a, void *block)
+{
+    (void)a;
+    return _atomic_arena_header(block)->size;
+}
+
+static void *_atomic_arena_alloc_aligned(Allocator *a, u64 size, u64 alignment)
+{
+    if (!a || !_allocator_is_pow2(alignment))
+        return NULL;
+
+    if (alignment <= _X_ATOMIC_ARENA_ALIGN)
+        return a->alloc(a, size);
+
+    if (size == 0 || size > ((u64)-1) - alignment)
+        return NULL;
+
+    // Blocks are 16 bytes aligned, so an aligned start past the first one
+    // leaves at least a header worth of padding in front of it
+    u64 rawSize = size + alignment;
+    i8 *raw = (i8 *)a->alloc(a, rawSize);
+    if (!raw)
+        return NULL;
+
+    i8 *aligned = (i8 *)(uPtr)_allocator_align_up((uPtr)raw, alignment);
+    return _atomic_arena_init_block(aligned - _X_ATOMIC_ARENA_HEADER_SIZE, rawSize - (u64)(aligned - raw));
+}
+
+static void *_atomic_arena_worker_alloc(Allocator *a, u64 size)
+{
+    if (!a || !a->_internalState)
+        return NULL;
+
+    AtomicArenaWorker *worker = (AtomicArenaWorker *)a->_internalState;
+    AtomicArenaState *state = worker->arena;
+
+    u64 blockSize = _atomic_arena_block_size(size);
+    if (blockSize == 0)
+        return NULL;
+
+    // Arena was reset since the sub-chunk was taken
+    if (worker->epoch != __atomic_load_n(&state->epoch, __ATOMIC_RELAXED))
+    {
+        worker->cursor = NULL;
+        worker->end = NULL;
+        worker->lastBlock = NULL;
+        worker->epoch = __atomic_load_n(&state->epoch, __ATOMIC_RELAXED);
+    }
+
+    if ((u64)(worker->end - worker->cursor) < blockSize)
+    {
+        // Large blocks would waste most of a sub-chunk, bump them directly
+        if (blockSize > state->chunkSize / 4)
+        {
+            i8 *bytes = _atomic_arena_bump(state, blockSize);
+            return bytes ? _atomic_arena_init_block(bytes, size) : NULL;
+        }
+
+        // Near the end of the region a full sub-chunk no longer fits, bump
+        // the block alone so the remaining space stays usable
+        i8 *chunk = _atomic_arena_bump(state, state->chunkSize);
+        if (!chunk)
+        {
+            i8 *bytes = _atomic_arena_bump(state, blockSize);
+            return bytes ? _atomic_arena_init_block(bytes, size) : NULL;
+        }
+
+        worker->cursor = chunk;
+        worker->end = chunk + state->chunkSize;
+    }
+
+    i8 *bytes = worker->cursor;
+    worker->cursor += blockSize;
+    worker->lastBlock = bytes;
+    return _atomic_arena_init_block(bytes, size);
+}
+
+static void *_atomic_arena_worker_realloc(Allocator *a, void *block, u64 newSize)
+{
+    if (!block)
+        return _atomic_arena_worker_alloc(a, newSize);
+
+    if (!a || !a->_internalState || newSize == 0)
+        return NULL;
+
+    AtomicArenaWorker *worker = (AtomicArenaWorker *)a->_internalState;
+    _AtomicArenaBlockHeader *header = _atomic_arena_header(block);
+
+    if (newSize <= header->size)
+        return block;
+
+    // Last block of the sub-chunk grows in place
+    u64 blockSize = _atomic_arena_block_size(newSize);
+    if ((i8 *)header == worker->lastBlock && blockSize != 0 &&
+        worker->epoch == __atomic_load_n(&worker->arena->epoch, __ATOMIC_RELAXED) &&
+        (u64)(worker->end - (i8 *)header) >= blockSize)
+    {
+        worker->cursor = (i8 *)header + blockSize;
+        header->size = newSize;
+        return block;
+    }
+
+    void *newBlock = _atomic_arena_worker_alloc(a, newSize);
+    if (!newBlock)
+        return NULL;
+
+    mem_copy(newBlock, block, header->size);
+    return newBlock;
+}
+
+/**
+ * @brief Releases every allocation of the arena at once, after a parallel phase.
+ *
+ * Workers drop their sub-chunk on their next allocation and keep working.
+ *
+ * IMPORTANT: Must not run concurrently with allocations. Make sure no dangling
+ * pointers are pointing to arena memory as those pointers will become invalid.
+ *
+ * @param state
+ */
+static inline void atomic_arena_reset(AtomicArenaState *state)
+{
+    if (!state)
+        return;
+
+    __atomic_store_n(&state->offset, 0, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&state->epoch, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Returns the amount of bytes handed out by the arena, sub-chunks
+ * reserved by workers included.
+ *
+ * @param state
+ * @return u64
+ */
+static inline u64 atomic_arena_used(AtomicArenaState *state)
+{
+    return __atomic_load_n(&state->offset, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Create a bump allocator over `buffer` that any number of threads can
+ * allocate from at the same time, without locks.
+ *
+ * Every allocation from the returned allocator is a compare-and-swap on the
+ * shared offset, retried while other threads move it. A fetch-add would be
+ * cheaper, but a request that does not fit would still advance the offset and
+ * lose the remaining space for smaller ones. For many small allocations, give
+ * each thread its own `atomic_arena_worker()`, which takes sub-chunks of
+ * `chunkSize` bytes from the region and allocates from them without touching
+ * shared memory.
+ *
+ * Memory is released all at once with `atomic_arena_reset()`, `free` does nothing.
+ *
+ * ```c
+ * u8 bytes[1 << 20]; AtomicArenaState state;
+ * Buffer buff = (Buffer){ .bytes = bytes, .size = sizeof(bytes) };
+ * ResAllocator arenaRes = atomic_arena_allocator(&state, buff, 0);
+ * if (arenaRes.isErr) // Error!
+ * // Parallel phase, each thread allocates from a worker
+ * atomic_arena_reset(&state);
+ * ```
+ *
+ * @param state must outlive the allocator and its workers
+ * @param buffer region to allocate from, owned by the caller
+ * @param chunkSize size of worker sub-chunks, 0 for the default of 64KiB
+ * @return Allocator
+ * @exception ERR_INVALID_PARAMETER
+ */
+static inline result_type(Allocator) atomic_arena_allocator(AtomicArenaState *state, Buffer buffer, u64 chunkSize)
+{
+    if (!state || !buffer.bytes || buffer.size == 0)
+        return result_err(Allocator, X_ERR_EXT("alloc_atomic_arena", "atomic_arena_allocator", ERR_INVALID_PARAMETER, "null arg or empty buff"));
+
+    u64 alignDiff = _atomic_arena_align((uPtr)buffer.bytes) - (uPtr)buffer.bytes;
+    if (buffer.size <= alignDiff)
+        return result_err(Allocator, X_ERR_EXT("alloc_atomic_arena", "atomic_arena_allocator", ERR_INVALID_PARAMETER, "buff too small"));
+
+    if (chunkSize == 0)
+        chunkSize = _X_ATOMIC_ARENA_DEFAULT_CHUNK_SIZE;
+
+    if (chunkSize > ((u64)-1) - _X_ATOMIC_ARENA_ALIGN)
+        return result_err(Allocator, X_ERR_EXT("alloc_atomic_arena", "atomic_arena_allocator", ERR_INVALID_PARAMETER, "invalid chunk size"));
+
+    *state = (AtomicArenaState){
+        .buffer = buffer.bytes + alignDiff,
+        .capacity = (buffer.size - alignDiff) & ~((u64)_X_ATOMIC_ARENA_ALIGN - 1),
+        .offset = 0,
+        .chunkSize = _atomic_arena_align(chunkSize),
+        .epoch = 0,
+    };
+
+    Allocator a = {
+        ._internalState = state,
+        .alloc = _atomic_arena_alloc,
+        .realloc = _atomic_arena_realloc,
+        .free = _atomic_arena_free,
+        .alloc_aligned = _atomic_arena_alloc_aligned,
+        .free_aligned = _atomic_arena_free,
+        .usable_size = _atomic_arena_usable_size,
+        .free_sized = NULL,
+    };
+    return result_ok(Allocator, a);
+}
+
+/**
+ * @brief Create a per-thread allocator over an atomic arena. Allocations are
+ * served from a private sub-chunk, only refilling it touches the shared offset.
+ *
+ * A worker must only be used by one thread at a time. The end of its last
+ * sub-chunk is unused until `atomic_arena_reset()`. Once a whole sub-chunk no
+ * longer fits in the region, blocks are bumped from the shared offset one by
+ * one.
+ *
+ * ```c
+ * // In each worker thread
+ * AtomicArenaWorker worker;
+ * Allocator a = atomic_arena_worker(&worker, &state).value;
+ * ResList listRes = ListInitT(u64, &a);
+ * ```
+ *
+ * @param worker per-thread state, must outlive the allocator
+ * @param arena state initialized with `atomic_arena_allocator()`
+ * @return Allocator
+ * @exception ERR_INVALID_PARAMETER
+ */
+static inline result_type(Allocator) atomic_arena_worker(AtomicArenaWorker *worker, AtomicArenaState *arena)
+{
+    if (!worker || !arena || !arena->buffer)
+        return result_err(Allocator, X_ERR_EXT("alloc_atomic_arena", "atomic_arena_worker", ERR_INVALID_PARAMETER, "null arg"));
+
+    *worker = (AtomicArenaWorker){
+        .arena = arena,
+        .cursor = NULL,
+        .end = NULL,
+        .lastBlock = NULL,
+        .epoch = __atomic_load_n(&arena->epoch, __ATOMIC_ACQUIRE),
+    };
+
+    Allocator a = {
+        ._internalState = worker,
+        .alloc = _atomic_arena_worker_alloc,
+        .realloc = _atomic_arena_worker_realloc,
+        .free = _atomic_arena_free,
+        .alloc_aligned = _atomic_arena_alloc_aligned,
+        .free_aligned = _atomic_arena_free,
+        .usable_size = _atomic_arena_usable_size,
+        .free_sized = NULL,
+    };
+    return result_ok(Allocator, a);
+}
@@ -0,0 +1,397 @@
+#pragma once
+
+// Accounting allocators nested into a tree, each node tracks live and peak
+// bytes of its subtree and can cap them with a hard budget
+
+#include "xstd_core.h"
+#include "xstd_result.h"
+#include "xstd_alloc.h"
+#include "xstd_mem.h"
+
+// Placed right before every block returned by a budget allocator
+typedef struct _budget_block_header
+{
+    u64 size;        // requested size, charged to the node and its ancestors
+    u32 alignOffset; // distance from the parent's block for aligned allocations, 0 otherwise
+    u32 _reserved;
+} _BudgetBlockHeader;
+
+#define _X_BUDGET_HEADER_SIZE ((u64)sizeof(_BudgetBlockHeader))
+#define _X_BUDGET_MAGIC 0x42554447u // "BUDG", marks initialized states
+
+// BudgetAllocator State, one node of the accounting tree
+typedef struct _budget_allocator_state
+{
+    u32 _magic; // _X_BUDGET_MAGIC once initialized
+    ConstStr name;
+    Allocator *targetAllocator; // allocator actually serving blocks, shared by the whole tree
+    struct _budget_allocator_state *parent;
+    struct _budget_allocator_state *firstChild;
+    struct _budget_allocator_state *nextSibling;
+
+    u64 budget; // max live bytes of the subtree, 0 for unlimited
+
+    // Updated atomically, bytes include the subtree
+    u64 liveBytes;
+    u64 peakBytes;
+    u64 allocCount;
+    u64 failedAllocs;
+} BudgetAllocatorState;
+
+// Read-only view of one node, see `budget_allocator_snapshot()`
+typedef struct _budget_allocator_snapshot
+{
+    ConstStr name;
+    u32 depth; // 0 for the node the walk started from
+    u64 budget;
+    u64 liveBytes;
+    u64 peakBytes;
+    u64 allocCount;
+    u64 failedAllocs;
+} BudgetAllocatorSnapshot;
+
+static inline void _budget_update_peak(BudgetAllocatorState *node, u64 live)
+{
+    u64 peak = __atomic_load_n(&node->peakBytes, __ATOMIC_RELAXED);
+    while (live > peak && !__atomic_compare_exchange_n(&node->peakBytes, &peak, live, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+}
+
+static inline void _budget_uncharge(BudgetAllocatorState *node, BudgetAllocatorState *stop, u64 size)
+{
+    for (; node != stop; node = node->parent)
+        __atomic_sub_fetch(&node->liveBytes, size, __ATOMIC_RELAXED);
+}
+
+// Charges `size` to the node, then to its ancestors. Each node rolls its own
+// charge back if an ancestor refuses, and only records its peak once the
+// whole chain up to the root accepted, so failed allocations never show up.
+static inline Bool _budget_charge_chain(BudgetAllocatorState *node, u64 size)
+{
+    if (!node)
+        return true;
+
+    u64 live = __atomic_add_fetch(&node->liveBytes, size, __ATOMIC_RELAXED);
+    if ((node->budget && live > node->budget) || !_budget_charge_chain(node->parent, size))
+    {
+        __atomic_sub_fetch(&node->liveBytes, size, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    _budget_update_peak(node, live);
+    return true;
+}
+
+// Charges `size` to the node and all its ancestors, rolled back if any budget is exceeded
+static inline Bool _budget_charge(BudgetAllocatorState *state, u64 size)
+{
+    if (_budget_charge_chain(state, size))
+        return true;
+
+    __atomic_add_fetch(&state->failedAllocs, 1, __ATOMIC_RELAXED);
+    return false;
+}
+
+static inline _BudgetBlockHeader *_budget_header_from_block(void *block)
+{
+    return (_BudgetBlockHeader *)block - 1;
+}
+
+static void *_budget_alloc(Allocator *a, u64 size)
+{
+    if (!a || !a->_internalState || size == 0 || size > ((u64)-1) - _X_BUDGET_HEADER_SIZE)
+        return NULL;
+
+    BudgetAllocatorState *state = (BudgetAllocatorState *)a->_internalState;
+    if (!_budget_charge(state, size))
+        return NULL;
+
+    Allocator *target = state->targetAllocator;
+    _BudgetBlockHeader *header = (_BudgetBlockHeader *)target->alloc(target, size + _X_BUDGET_HEADER_SIZE);
+    if (!header)
+    {
+        _budget_uncharge(state, NULL, size);
+        __atomic_add_fetch(&state->failedAllocs, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    header->size = size;
+    header->alignOffset = 0;
+    __atomic_add_fetch(&state->allocCount, 1, __ATOMIC_RELAXED);
+    return header + 1;
+}
+
+static void *_budget_alloc_aligned(Allocator *a, u64 size, u64 alignment)
+{
+    if (!a || !a->_internalState || size == 0 || !_allocator_is_pow2(alignment))
+        return NULL;
+
+    // Target blocks keep their alignment past a 16 bytes header
+    if (alignment <= _X_BUDGET_HEADER_SIZE)
+        return _budget_alloc(a, size);
+
+    BudgetAllocatorState *state = (BudgetAllocatorState *)a->_internalState;
+    Allocator *target = state->targetAllocator;
+
+    if (alignment > 0x80000000u || size > ((u64)-1) - alignment)
+        return NULL;
+
+    if (!_budget_charge(state, size))
+        return NULL;
+
+    // Whole alignment unit in front of the block holds its header
+    i8 *raw = (i8 *)allocator_alloc_aligned(target, size + alignment, alignment);
+    if (!raw)
+    {
+        _budget_uncharge(state, NULL, size);
+        __atomic_add_fetch(&state->failedAllocs, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    i8 *block = raw + alignment;
+    _BudgetBlockHeader *header = _budget_header_from_block(block);
+    header->size = size;
+    header->alignOffset = (u32)alignment;
+    __atomic_add_fetch(&state->allocCount, 1, __ATOMIC_RELAXED);
+    return block;
+}
+
+static void _budget_free(Allocator *a, void *block)
+{
+    if (!a || !a->_internalState || !block)
+        return;
+
+    BudgetAllocatorState *state = (BudgetAllocatorState *)a->_internalState;
+    Allocator *target = state->targetAllocator;
+    _BudgetBlockHeader *header = _budget_header_from_block(block);
+
+    _budget_uncharge(state, NULL, header->size);
+
+    if (header->alignOffset)
+        allocator_free_aligned(target, (i8 *)block - header->alignOffset);
+    else
+        target->free(target, header);
+}
+
+static void *_budget_realloc(Allocator *a, void *block, u64 newSize)
+{
+    if (!a || !a->_internalState)
+        return NULL;
+
+    if (!block)
+        return _budget_alloc(a, newSize);
+
+    if (newSize == 0)
+    {
+        _budget_free(a, block);
+        return NULL;
+    }
+
+    BudgetAllocatorState *state = (BudgetAllocatorState *)a->_internalState;
+    Allocator *target = state->targetAllocator;
+    _BudgetBlockHeader *header = _budget_header_from_block(block);
+    u64 oldSize = header->size;
+
+    if (header->alignOffset)
+    {
+        void *newBlock = _budget_alloc_aligned(a, newSize, header->alignOffset);
+        if (!newBlock)
+            return NULL;
+
+        mem_copy(newBlock, block, oldSize < newSize ? oldSize : newSize);
+        _budget_free(a, block);
+        return newBlock;
+    }
+
+    if (newSize > ((u64)-1) - _X_BUDGET_HEADER_SIZE)
+        return NULL;
+
+    // Growth is charged up front so the budget holds while the target reallocates
+    if (newSize > oldSize && !_budget_charge(state, newSize - oldSize))
+        return NULL;
+
+    _BudgetBlockHeader *newHeader = (_BudgetBlockHeader *)target->realloc(target, header, newSize + _X_BUDGET_HEADER_SIZE);
+    if (!newHeader)
+    {
+        if (newSize > oldSize)
+        {
+            _budget_uncharge(state, NULL, newSize - oldSize);
+            __atomic_add_fetch(&state->failedAllocs, 1, __ATOMIC_RELAXED);
+        }
+        return NULL;
+    }
+
+    if (newSize < oldSize)
+        _budget_uncharge(state, NULL, oldSize - newSize);
+
+    newHeader->size = newSize;
+    return newHeader + 1;
+}
+
+static u64 _budget_usable_size(Allocator *a, void *block)
+{
+    (void)a;
+    return _budget_header_from_block(block)->size;
+}
+
+/**
+ * @brief Walks the accounting tree below `root` (included) in depth-first order.
+ *
+ * Counters of each node are read atomically, but not all at once, so a
+ * snapshot taken while other threads allocate may be slightly inconsistent.
+ *
+ * ```c
+ * BudgetAllocatorSnapshot nodes[16];
+ * u32 count = budget_allocator_snapshot(&rootState, nodes, 16);
+ * for (u32 i = 0; i < count && i < 16; ++i)
+ *     // nodes[i].name, nodes[i].liveBytes, ...
+ * ```
+ *
+ * @param root
+ * @param out array of at least `capacity` snapshots, may be NULL if `capacity` is 0
+ * @param capacity
+ * @return number of nodes in the tree, only the first `capacity` are written
+ */
+static inline u32 budget_allocator_snapshot(BudgetAllocatorState *root, BudgetAllocatorSnapshot *out, u32 capacity)
+{
+    if (!root)
+        return 0;
+
+    u32 count = 0;
+    u32 depth = 0;
+    BudgetAllocatorState *node = root;
+
+    while (node)
+    {
+        if (count < capacity)
+        {
+            BudgetAllocatorSnapshot *snap = &out[count];
+            snap->name = node->name;
+            snap->depth = depth;
+            snap->budget = node->budget;
+            snap->liveBytes = __atomic_load_n(&node->liveBytes, __ATOMIC_RELAXED);
+            snap->peakBytes = __atomic_load_n(&node->peakBytes, __ATOMIC_RELAXED);
+            snap->allocCount = __atomic_load_n(&node->allocCount, __ATOMIC_RELAXED);
+            snap->failedAllocs = __atomic_load_n(&node->failedAllocs, __ATOMIC_RELAXED);
+        }
+        count += 1;
+
+        BudgetAllocatorState *child = __atomic_load_n(&node->firstChild, __ATOMIC_ACQUIRE);
+        if (child)
+        {
+            node = child;
+            depth += 1;
+            continue;
+        }
+
+        // Climbs until a node with a next sibling, without leaving the subtree of `root`
+        while (node != root && !node->nextSibling)
+        {
+            node = node->parent;
+            depth -= 1;
+        }
+        node = node == root ? NULL : node->nextSibling;
+    }
+
+    return count;
+}
+
+static inline Allocator _budget_allocator_make(BudgetAllocatorState *state, ConstStr name, Allocator *targetAllocator, u64 budget)
+{
+    state->_magic = _X_BUDGET_MAGIC;
+    state->name = name;
+    state->targetAllocator = targetAllocator;
+    state->parent = NULL;
+    state->firstChild = NULL;
+    state->nextSibling = NULL;
+    state->budget = budget;
+    state->liveBytes = 0;
+    state->peakBytes = 0;
+    state->allocCount = 0;
+    state->failedAllocs = 0;
+
+    Allocator a = {
+        ._internalState = state,
+        .alloc = _budget_alloc,
+        .realloc = _budget_realloc,
+        .free = _budget_free,
+        .alloc_aligned = _budget_alloc_aligned,
+        .free_aligned = _budget_free,
+        .usable_size = _budget_usable_size,
+        .free_sized = NULL,
+    };
+    return a;
+}
+
+/**
+ * @brief Creates an accounting allocator at the root of a new tree, serving
+ * blocks from `targetAllocator`. Nest nodes under it with `budget_allocator_child()`.
+ *
+ * Failed allocations return NULL like any out of memory allocator, so callers
+ * surface them as `ERR_OUT_OF_MEMORY`. Counters are atomic, nodes may be shared
+ * between threads if the underlying allocator is thread-safe.
+ *
+ * Only requested bytes are charged, not the 16 bytes header of every block.
+ *
+ * ```c
+ * BudgetAllocatorState rootState, jsonState;
+ * Allocator root = budget_allocator(&rootState, "app", default_allocator(), 0).value;
+ * Allocator json = budget_allocator_child(&jsonState, "json", &rootState, 16 * 1024 * 1024).value;
+ * // Parse with json, rootState.liveBytes includes jsonState.liveBytes
+ * ```
+ *
+ * @param state must outlive the allocator
+ * @param name label reported by snapshots, not copied
+ * @param targetAllocator allocator serving the blocks of the whole tree
+ * @param budget max live bytes of the tree, 0 for unlimited
+ * @return Allocator
+ * @exception ERR_INVALID_PARAMETER
+ */
+static inline result_type(Allocator) budget_allocator(BudgetAllocatorState *state, ConstStr name, Allocator *targetAllocator, u64 budget)
+{
+    if (!state || !targetAllocator || !targetAllocator->alloc)
+        return result_err(Allocator, X_ERR_EXT("alloc_budget", "budget_allocator", ERR_INVALID_PARAMETER, "null arg"));
+
+    return result_ok(Allocator, _budget_allocator_make(state, name, targetAllocator, budget));
+}
+
+/**
+ * @brief Creates an accounting allocator nested under `parent`: allocations are
+ * charged to the node and all its ancestors, and fail if any of their budgets
+ * would be exceeded. Blocks come from the allocator of the tree's root.
+ *
+ * Nodes are never unlinked from their parent: child states must live as long
+ * as the tree is used.
+ *
+ * ```c
+ * Allocator json = budget_allocator_child(&jsonState, "json", &rootState, 16 * 1024 * 1024).value;
+ * Allocator jsonStrings = budget_allocator_child(&stringsState, "strings", &jsonState, 0).value;
+ * ```
+ *
+ * @param state must outlive the allocator
+ * @param name label reported by snapshots, not copied
+ * @param parent state of a budget allocator, root or child
+ * @param budget max live bytes of the subtree, 0 for unlimited
+ * @return Allocator
+ * @exception ERR_INVALID_PARAMETER
+ */
+static inline result_type(Allocator) budget_allocator_child(BudgetAllocatorState *state, ConstStr name, BudgetAllocatorState *parent, u64 budget)
+{
+    if (!state || !parent || state == parent)
+        return result_err(Allocator, X_ERR_EXT("alloc_budget", "budget_allocator_child", ERR_INVALID_PARAMETER, "null arg"));
+
+    if (parent->_magic != _X_BUDGET_MAGIC)
+        return result_err(Allocator, X_ERR_EXT("alloc_budget", "budget_allocator_child", ERR_INVALID_PARAMETER, "parent is not a budget allocator"));
+
+    Allocator a = _budget_allocator_make(state, name, parent->targetAllocator, budget);
+    state->parent = parent;
+
+    BudgetAllocatorState *head = __atomic_load_n(&parent->firstChild, __ATOMIC_RELAXED);
+    do
+    {
+        state->nextSibling = head;
+    } while (!__atomic_compare_exchange_n(&parent->firstChild, &head, state, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    return result_ok(Allocator, a);
+}
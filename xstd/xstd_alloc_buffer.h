@@ -77,6 +77,67 @@ static void *_buffalloc_alloc(Allocator *a, u64 size)
     return NULL;
 }
 
+static void *_buffalloc_alloc_aligned(Allocator *a, u64 size, u64 alignment)
+{
+    if (!a || !a->_internalState || size == 0 || !_allocator_is_pow2(alignment))
+        return NULL;
+
+    if (alignment <= 16)
+        return _buffalloc_alloc(a, size);
+
+    BufferAllocatorState *state = (BufferAllocatorState *)a->_internalState;
+    _BufferBlockHeader *curr = state->head;
+
+    const u64 headerSize = _X_BUFFALLOC_BLOCK_HEADER_SIZE;
+    u64 totalSize = _buffalloc_offset_to_aligned(size) + headerSize;
+
+    while (curr)
+    {
+        if (curr->isFree)
+        {
+            // Space skipped before the aligned block must be able to hold a free block
+            uPtr userAddr = (uPtr)_allocator_align_up((uPtr)curr + headerSize, alignment);
+            u64 gap = userAddr - headerSize - (uPtr)curr;
+            if (gap != 0 && gap < headerSize + 16)
+                gap += alignment;
+
+            if (curr->size >= gap + totalSize)
+            {
+                if (gap != 0)
+                {
+                    _BufferBlockHeader *alignedBlock = (_BufferBlockHeader *)((i8 *)curr + gap);
+                    alignedBlock->size = curr->size - gap;
+                    alignedBlock->isFree = true;
+                    alignedBlock->next = curr->next;
+
+                    curr->size = gap;
+                    curr->next = alignedBlock;
+                    curr = alignedBlock;
+                }
+
+                u64 leftover = curr->size - totalSize;
+                if (leftover > headerSize + 16)
+                {
+                    _BufferBlockHeader *newBlock = (_BufferBlockHeader *)((i8 *)curr + totalSize);
+                    newBlock->size = leftover;
+                    newBlock->isFree = true;
+                    newBlock->next = curr->next;
+
+                    curr->size = totalSize;
+                    curr->next = newBlock;
+                }
+
+                curr->isFree = false;
+                return (i8 *)curr + headerSize;
+            }
+        }
+
+        curr = curr->next;
+    }
+
+    return NULL;
+}
+
 static void _buffalloc_free(Allocator *a, void *ptr)
 {
     if (!a || !ptr)
@@ -131,6 +192,13 @@ static void *_buffalloc_realloc(Allocator *a, void *ptr, u64 newSize)
     return newPtr;
 }
 
+static u64 _buffalloc_usable_size(Allocator *a, void *ptr)
+{
+    (void)a;
+    _BufferBlockHeader *header = (_BufferBlockHeader *)((i8 *)ptr - _X_BUFFALLOC_BLOCK_HEADER_SIZE);
+    return header->size - _X_BUFFALLOC_BLOCK_HEADER_SIZE;
+}
+
 /**
  * @brief Initializes a buffer allocator using the given byte buffer.
  *
@@ -166,7 +234,12 @@ static inline result_type(Allocator) buffer_allocator(Buffer buffer)
         .capacity = buffer.size,
         .head = NULL};
 
-    u64 usableOffset = alignDiff + headerSize;
+    u64 usableOffset = alignDiff + alignedHeaderSize;
+    if (usableOffset + _X_BUFFALLOC_BLOCK_HEADER_SIZE > buffer.size)
+        return result_err(Allocator, X_ERR_EXT(
+                "alloc_buffer", "buffer_allocator",
+                ERR_INVALID_PARAMETER, "buffer too small for proper alignment"));
+
     u64 usableSize = buffer.size - usableOffset;
 
     _BufferBlockHeader *initial = (_BufferBlockHeader *)(buffer.bytes + usableOffset);
@@ -183,6 +256,421 @@ static inline result_type(Allocator) buffer_allocator(Buffer buffer)
         .alloc = _buffalloc_alloc,
         .realloc = _buffalloc_realloc,
         .free = _buffalloc_free,
+        .alloc_aligned = _buffalloc_alloc_aligned,
+        .free_aligned = _buffalloc_free,
+        .usable_size = _buffalloc_usable_size,
+        .free_sized = NULL,
+    };
+    return result_ok(Allocator, a);
+}
+
+// Two-level segregated fit (TLSF) variant of the buffer allocator.
+// Blocks carry boundary tags (pointer to previous physical block) so that
+// allocation, free and coalescing are all constant time.
+
+#define _X_TLSF_ALIGN_LOG2 4u
+#define _X_TLSF_SL_LOG2 4u
+#define _X_TLSF_SL_COUNT (1u << _X_TLSF_SL_LOG2)
+#define _X_TLSF_FL_SHIFT (_X_TLSF_SL_LOG2 + _X_TLSF_ALIGN_LOG2)
+#define _X_TLSF_SMALL_BLOCK_SIZE ((u64)1 << _X_TLSF_FL_SHIFT)
+#define _X_TLSF_FL_MAX_LOG2 48u
+#define _X_TLSF_FL_COUNT (_X_TLSF_FL_MAX_LOG2 - _X_TLSF_FL_SHIFT + 1u)
+#define _X_TLSF_MAX_BLOCK_SIZE (((u64)1 << _X_TLSF_FL_MAX_LOG2) - 16u)
+#define _X_TLSF_BLOCK_FREE ((u64)1)
+
+typedef struct _buffalloc_tlsf_block
+{
+    struct _buffalloc_tlsf_block *prevPhys; // Previous block in memory, NULL for the first block
+    u64 size;                               // Total size including header, lowest bit set if free
+    struct _buffalloc_tlsf_block *nextFree; // Only valid while free, overlaps user memory
+    struct _buffalloc_tlsf_block *prevFree; // Only valid while free, overlaps user memory
+} _TlsfBlockHeader;
+
+typedef struct _buffalloc_tlsf_state
+{
+    i8 *buffer;
+    u64 capacity;
+    i8 *end; // End of the last block
+    u64 flBitmap;
+    u32 slBitmap[_X_TLSF_FL_COUNT];
+    _TlsfBlockHeader *freeLists[_X_TLSF_FL_COUNT][_X_TLSF_SL_COUNT];
+} TlsfBufferAllocatorState;
+
+#define _X_TLSF_BLOCK_HEADER_SIZE ((u64)_buffalloc_offset_to_aligned(sizeof(void *) + sizeof(u64)))
+#define _X_TLSF_MIN_BLOCK_SIZE ((u64)_buffalloc_offset_to_aligned(sizeof(_TlsfBlockHeader)))
+
+static inline u64 _buffalloc_tlsf_size(_TlsfBlockHeader *block)
+{
+    return block->size & ~_X_TLSF_BLOCK_FREE;
+}
+
+static inline Bool _buffalloc_tlsf_is_free(_TlsfBlockHeader *block)
+{
+    return (block->size & _X_TLSF_BLOCK_FREE) != 0;
+}
+
+static inline _TlsfBlockHeader *_buffalloc_tlsf_next_phys(TlsfBufferAllocatorState *state, _TlsfBlockHeader *block)
+{
+    i8 *next = (i8 *)block + _buffalloc_tlsf_size(block);
+    return next < state->end ? (_TlsfBlockHeader *)next : NULL;
+}
+
+static inline u32 _buffalloc_tlsf_fls(u64 value)
+{
+    return 63u - (u32)__builtin_clzll(value);
+}
+
+static inline void _buffalloc_tlsf_mapping(u64 size, u32 *fl, u32 *sl)
+{
+    if (size < _X_TLSF_SMALL_BLOCK_SIZE)
+    {
+        *fl = 0;
+        *sl = (u32)(size >> _X_TLSF_ALIGN_LOG2);
+        return;
+    }
+
+    u32 log2 = _buffalloc_tlsf_fls(size);
+    *sl = (u32)(size >> (log2 - _X_TLSF_SL_LOG2)) ^ _X_TLSF_SL_COUNT;
+    *fl = log2 - (_X_TLSF_FL_SHIFT - 1u);
+}
+
+static inline void _buffalloc_tlsf_insert(TlsfBufferAllocatorState *state, _TlsfBlockHeader *block)
+{
+    u32 fl, sl;
+    _buffalloc_tlsf_mapping(_buffalloc_tlsf_size(block), &fl, &sl);
+
+    _TlsfBlockHeader *head = state->freeLists[fl][sl];
+    block->nextFree = head;
+    block->prevFree = NULL;
+    if (head)
+        head->prevFree = block;
+
+    state->freeLists[fl][sl] = block;
+    state->flBitmap |= (u64)1 << fl;
+    state->slBitmap[fl] |= 1u << sl;
+}
+
+static inline void _buffalloc_tlsf_remove(TlsfBufferAllocatorState *state, _TlsfBlockHeader *block)
+{
+    u32 fl, sl;
+    _buffalloc_tlsf_mapping(_buffalloc_tlsf_size(block), &fl, &sl);
+
+    if (block->prevFree)
+        block->prevFree->nextFree = block->nextFree;
+    else
+        state->freeLists[fl][sl] = block->nextFree;
+
+    if (block->nextFree)
+        block->nextFree->prevFree = block->prevFree;
+
+    if (!state->freeLists[fl][sl])
+    {
+        state->slBitmap[fl] &= ~(1u << sl);
+        if (!state->slBitmap[fl])
+            state->flBitmap &= ~((u64)1 << fl);
+    }
+}
+
+static inline _TlsfBlockHeader *_buffalloc_tlsf_find(TlsfBufferAllocatorState *state, u64 size)
+{
+    // Round up to the next list so that any block found is large enough
+    if (size >= _X_TLSF_SMALL_BLOCK_SIZE)
+        size += ((u64)1 << (_buffalloc_tlsf_fls(size) - _X_TLSF_SL_LOG2)) - 1u;
+
+    u32 fl, sl;
+    _buffalloc_tlsf_mapping(size, &fl, &sl);
+
+    if (fl >= _X_TLSF_FL_COUNT)
+        return NULL;
+
+    u32 slMap = state->slBitmap[fl] & (~0u << sl);
+    if (!slMap)
+    {
+        u64 flMap = state->flBitmap & (~(u64)0 << (fl + 1u));
+        if (!flMap)
+            return NULL;
+
+        fl = (u32)__builtin_ctzll(flMap);
+        slMap = state->slBitmap[fl];
+    }
+
+    sl = (u32)__builtin_ctz(slMap);
+    return state->freeLists[fl][sl];
+}
+
+// Splits `block` (not in any free list) at `size`, the remainder is made free.
+static inline void _buffalloc_tlsf_split(TlsfBufferAllocatorState *state, _TlsfBlockHeader *block, u64 size)
+{
+    u64 blockSize = _buffalloc_tlsf_size(block);
+    if (blockSize - size < _X_TLSF_MIN_BLOCK_SIZE)
+        return;
+
+    _TlsfBlockHeader *rest = (_TlsfBlockHeader *)((i8 *)block + size);
+    rest->prevPhys = block;
+    rest->size = (blockSize - size) | _X_TLSF_BLOCK_FREE;
+    block->size = size | (block->size & _X_TLSF_BLOCK_FREE);
+
+    _TlsfBlockHeader *next = _buffalloc_tlsf_next_phys(state, rest);
+    if (next)
+    {
+        next->prevPhys = rest;
+
+        // Keep free blocks coalesced
+        if (_buffalloc_tlsf_is_free(next))
+        {
+            _buffalloc_tlsf_remove(state, next);
+            rest->size += _buffalloc_tlsf_size(next);
+
+            _TlsfBlockHeader *after = _buffalloc_tlsf_next_phys(state, rest);
+            if (after)
+                after->prevPhys = rest;
+        }
+    }
+
+    _buffalloc_tlsf_insert(state, rest);
+}
+
+static inline u64 _buffalloc_tlsf_block_size_for(u64 size)
+{
+    if (size > _X_TLSF_MAX_BLOCK_SIZE)
+        return 0;
+
+    u64 blockSize = _buffalloc_offset_to_aligned(size) + _X_TLSF_BLOCK_HEADER_SIZE;
+    return blockSize < _X_TLSF_MIN_BLOCK_SIZE ? _X_TLSF_MIN_BLOCK_SIZE : blockSize;
+}
+
+static void *_buffalloc_tlsf_alloc(Allocator *a, u64 size)
+{
+    if (!a || !a->_internalState || size == 0)
+        return NULL;
+
+    TlsfBufferAllocatorState *state = (TlsfBufferAllocatorState *)a->_internalState;
+
+    u64 blockSize = _buffalloc_tlsf_block_size_for(size);
+    if (blockSize == 0)
+        return NULL;
+
+    _TlsfBlockHeader *block = _buffalloc_tlsf_find(state, blockSize);
+    if (!block)
+        return NULL;
+
+    _buffalloc_tlsf_remove(state, block);
+    block->size &= ~_X_TLSF_BLOCK_FREE;
+    _buffalloc_tlsf_split(state, block, blockSize);
+
+    return (i8 *)block + _X_TLSF_BLOCK_HEADER_SIZE;
+}
+
+static void *_buffalloc_tlsf_alloc_aligned(Allocator *a, u64 size, u64 alignment)
+{
+    if (!a || !a->_internalState || size == 0 || !_allocator_is_pow2(alignment))
+        return NULL;
+
+    if (alignment <= 16)
+        return _buffalloc_tlsf_alloc(a, size);
+
+    TlsfBufferAllocatorState *state = (TlsfBufferAllocatorState *)a->_internalState;
+
+    u64 blockSize = _buffalloc_tlsf_block_size_for(size);
+    if (blockSize == 0 || alignment > _X_TLSF_MAX_BLOCK_SIZE - blockSize - _X_TLSF_MIN_BLOCK_SIZE)
+        return NULL;
+
+    // Leave room for a free block in front of the aligned one
+    _TlsfBlockHeader *block = _buffalloc_tlsf_find(state, blockSize + alignment + _X_TLSF_MIN_BLOCK_SIZE);
+    if (!block)
+        return NULL;
+
+    _buffalloc_tlsf_remove(state, block);
+    block->size &= ~_X_TLSF_BLOCK_FREE;
+
+    uPtr userAddr = (uPtr)_allocator_align_up((uPtr)block + _X_TLSF_BLOCK_HEADER_SIZE, alignment);
+    u64 gap = userAddr - _X_TLSF_BLOCK_HEADER_SIZE - (uPtr)block;
+    if (gap != 0 && gap < _X_TLSF_MIN_BLOCK_SIZE)
+        gap += alignment;
+
+    if (gap != 0)
+    {
+        _TlsfBlockHeader *alignedBlock = (_TlsfBlockHeader *)((i8 *)block + gap);
+        alignedBlock->prevPhys = block;
+        alignedBlock->size = _buffalloc_tlsf_size(block) - gap;
+
+        _TlsfBlockHeader *next = _buffalloc_tlsf_next_phys(state, alignedBlock);
+        if (next)
+            next->prevPhys = alignedBlock;
+
+        // Previous physical block cannot be free, no coalescing needed
+        block->size = gap | _X_TLSF_BLOCK_FREE;
+        _buffalloc_tlsf_insert(state, block);
+        block = alignedBlock;
+    }
+
+    _buffalloc_tlsf_split(state, block, blockSize);
+    return (i8 *)block + _X_TLSF_BLOCK_HEADER_SIZE;
+}
+
+static void _buffalloc_tlsf_free(Allocator *a, void *ptr)
+{
+    if (!a || !a->_internalState || !ptr)
+        return;
+
+    TlsfBufferAllocatorState *state = (TlsfBufferAllocatorState *)a->_internalState;
+    _TlsfBlockHeader *block = (_TlsfBlockHeader *)((i8 *)ptr - _X_TLSF_BLOCK_HEADER_SIZE);
+
+    if (_buffalloc_tlsf_is_free(block))
+        return;
+
+    block->size |= _X_TLSF_BLOCK_FREE;
+
+    _TlsfBlockHeader *next = _buffalloc_tlsf_next_phys(state, block);
+    if (next && _buffalloc_tlsf_is_free(next))
+    {
+        _buffalloc_tlsf_remove(state, next);
+        block->size += _buffalloc_tlsf_size(next);
+    }
+
+    _TlsfBlockHeader *prev = block->prevPhys;
+    if (prev && _buffalloc_tlsf_is_free(prev))
+    {
+        _buffalloc_tlsf_remove(state, prev);
+        prev->size += _buffalloc_tlsf_size(block);
+        block = prev;
+    }
+
+    next = _buffalloc_tlsf_next_phys(state, block);
+    if (next)
+        next->prevPhys = block;
+
+    _buffalloc_tlsf_insert(state, block);
+}
+
+static void *_buffalloc_tlsf_realloc(Allocator *a, void *ptr, u64 newSize)
+{
+    if (!ptr)
+        return _buffalloc_tlsf_alloc(a, newSize);
+
+    if (newSize == 0)
+    {
+        _buffalloc_tlsf_free(a, ptr);
+        return NULL;
+    }
+
+    if (!a || !a->_internalState)
+        return NULL;
+
+    TlsfBufferAllocatorState *state = (TlsfBufferAllocatorState *)a->_internalState;
+    _TlsfBlockHeader *block = (_TlsfBlockHeader *)((i8 *)ptr - _X_TLSF_BLOCK_HEADER_SIZE);
+
+    u64 blockSize = _buffalloc_tlsf_block_size_for(newSize);
+    if (blockSize == 0)
+        return NULL;
+
+    u64 currSize = _buffalloc_tlsf_size(block);
+    if (blockSize <= currSize)
+    {
+        _buffalloc_tlsf_split(state, block, blockSize);
+        return ptr;
+    }
+
+    // Grow in place by absorbing the next block if free and large enough
+    _TlsfBlockHeader *next = _buffalloc_tlsf_next_phys(state, block);
+    if (next && _buffalloc_tlsf_is_free(next) && currSize + _buffalloc_tlsf_size(next) >= blockSize)
+    {
+        _buffalloc_tlsf_remove(state, next);
+        block->size += _buffalloc_tlsf_size(next);
+
+        _TlsfBlockHeader *after = _buffalloc_tlsf_next_phys(state, block);
+        if (after)
+            after->prevPhys = block;
+
+        _buffalloc_tlsf_split(state, block, blockSize);
+        return ptr;
+    }
+
+    void *newPtr = _buffalloc_tlsf_alloc(a, newSize);
+    if (!newPtr)
+        return NULL;
+
+    mem_copy(newPtr, ptr, currSize - _X_TLSF_BLOCK_HEADER_SIZE);
+
+    _buffalloc_tlsf_free(a, ptr);
+    return newPtr;
+}
+
+static u64 _buffalloc_tlsf_usable_size(Allocator *a, void *ptr)
+{
+    (void)a;
+    _TlsfBlockHeader *block = (_TlsfBlockHeader *)((i8 *)ptr - _X_TLSF_BLOCK_HEADER_SIZE);
+    return _buffalloc_tlsf_size(block) - _X_TLSF_BLOCK_HEADER_SIZE;
+}
+
+/**
+ * @brief Initializes a buffer allocator using the given byte buffer, backed by
+ * a two-level segregated fit (TLSF) allocator.
+ *
+ * Unlike `buffer_allocator()`, allocation, free and coalescing of free blocks are
+ * constant time regardless of fragmentation, which makes it suited for large
+ * buffers with many live allocations. In exchange, roughly 5KiB of the buffer
+ * is used for the allocator's free lists.
+ *
+ * Memory passed must remain valid for the lifetime of the allocator.
+ *
+ * @param buffer Allocated buffer
+ * @return ResAllocator
+ * @exception ERR_INVALID_PARAMETER
+ */
+static inline result_type(Allocator) buffer_allocator_tlsf(Buffer buffer)
+{
+    const u64 alignedHeaderSize = (u64)_buffalloc_offset_to_aligned(sizeof(TlsfBufferAllocatorState));
+
+    if (!buffer.bytes || buffer.size < alignedHeaderSize + _X_TLSF_MIN_BLOCK_SIZE + 16)
+        return result_err(Allocator, X_ERR_EXT(
+                "alloc_buffer", "buffer_allocator_tlsf",
+                ERR_INVALID_PARAMETER, "null or empty buff"));
+
+    u64 alignedOffset = _buffalloc_offset_to_aligned((uPtr)buffer.bytes);
+    u64 alignDiff = alignedOffset - (uPtr)buffer.bytes;
+
+    if (_buffalloc_offset_invalid(buffer.size, alignDiff, alignedHeaderSize + _X_TLSF_MIN_BLOCK_SIZE))
+        return result_err(Allocator, X_ERR_EXT(
+                "alloc_buffer", "buffer_allocator_tlsf",
+                ERR_INVALID_PARAMETER, "buffer too small for proper alignment"));
+
+    TlsfBufferAllocatorState *state = (TlsfBufferAllocatorState *)(buffer.bytes + alignDiff);
+    *state = (TlsfBufferAllocatorState){
+        .buffer = buffer.bytes,
+        .capacity = buffer.size,
+        .end = NULL,
+        .flBitmap = 0,
+    };
+
+    for (u32 fl = 0; fl < _X_TLSF_FL_COUNT; ++fl)
+    {
+        state->slBitmap[fl] = 0;
+        for (u32 sl = 0; sl < _X_TLSF_SL_COUNT; ++sl)
+            state->freeLists[fl][sl] = NULL;
+    }
+
+    u64 usableOffset = alignDiff + alignedHeaderSize;
+    u64 usableSize = (buffer.size - usableOffset) & ~(u64)15;
+    if (usableSize > _X_TLSF_MAX_BLOCK_SIZE)
+        usableSize = _X_TLSF_MAX_BLOCK_SIZE;
+
+    _TlsfBlockHeader *initial = (_TlsfBlockHeader *)(buffer.bytes + usableOffset);
+    initial->prevPhys = NULL;
+    initial->size = usableSize | _X_TLSF_BLOCK_FREE;
+    state->end = (i8 *)initial + usableSize;
+
+    _buffalloc_tlsf_insert(state, initial);
+
+    Allocator a = {
+        ._internalState = (void *)state,
+        .alloc = _buffalloc_tlsf_alloc,
+        .realloc = _buffalloc_tlsf_realloc,
+        .free = _buffalloc_tlsf_free,
+        .alloc_aligned = _buffalloc_tlsf_alloc_aligned,
+        .free_aligned = _buffalloc_tlsf_free,
+        .usable_size = _buffalloc_tlsf_usable_size,
+        .free_sized = NULL,
     };
     return result_ok(Allocator, a);
 }
@@ -8,19 +8,44 @@
 #define _X_DEBUG_ALLOC_ENTRY_FULL 1u
 #define _X_DEBUG_ALLOC_ENTRY_TOMB 2u
 
+#define _X_DEBUG_ALLOC_DEFAULT_SAMPLE_INTERVAL ((u64)512 * 1024)
+#define _X_DEBUG_ALLOC_NO_SITE 0xFFFFFFFFu
+
+// Address the allocation call returns to, identifies its call site
+#if defined(__GNUC__) || defined(__clang__)
+    #define _X_DEBUG_ALLOC_CALLER() __builtin_return_address(0)
+#else
+    #define _X_DEBUG_ALLOC_CALLER() NULL
+#endif
+
 typedef struct _debug_allocator_entry
 {
     void *ptr;
     u64 size;
+    u32 samples; // in sampling mode, sample points that fell in the allocation
+    u32 site;    // index in `DebugAllocatorState.sites`, _X_DEBUG_ALLOC_NO_SITE if not attributed
     u8 state;
 } DebugAllocEntry;
 
+// Allocation statistics of one call site, see `debug_allocator_track_sites()`
+typedef struct _debug_alloc_site
+{
+    void *caller;     // return address of the allocation call
+    u64 liveCount;    // tracked allocations still alive
+    u64 liveBytes;    // requested bytes of tracked allocations still alive
+    u64 totalCount;   // tracked allocations since init
+    u64 totalBytes;   // requested bytes of tracked allocations since init
+    u64 liveEstimate; // live bytes, extrapolated in sampling mode
+    u64 peakEstimate; // peak of `liveEstimate`
+} DebugAllocSite;
+
 typedef struct _debug_allocator_state
 {
     Allocator *targetAllocator;
     DebugAllocEntry *table;
     u32 capacity;
     u32 count;
+    u32 tombstones; // removed entries, counted against the load factor as they lengthen probes
     u32 mask;
     u32 resizeThreshold;
 
@@ -45,6 +70,24 @@ typedef struct _debug_allocator_state
     u64 failedInsertions;
     u64 untrackedFrees;
     u64 untrackedReallocs;
+    u64 sizedFreeMismatches; // calls to free_sized with a size different from the allocated one
+
+    // Sampling mode, see `debug_allocator_sampled()`. Table and active/peak
+    // counters above then only cover sampled allocations.
+    u64 sampleInterval;             // mean bytes between sampled allocations, 0 if every allocation is tracked
+    u64 bytesUntilSample;           // bytes left before the next sample point
+    u64 sampleRng;                  // xorshift state drawing sample intervals
+    u64 estimatedActiveBytes;       // extrapolated live bytes
+    u64 estimatedPeakBytes;         // extrapolated peak of live bytes
+    u64 estimatedTotalAllocBytes;   // extrapolated bytes allocated since init
+    f64 estimatedActiveAllocCount;  // extrapolated live allocations
+
+    // Call-site attribution, see `debug_allocator_track_sites()`
+    DebugAllocSite *sites; // NULL if disabled, indices stay valid as it grows
+    u32 siteCount;
+    u32 siteCapacity;
+    u32 *siteSlots;        // open-addressing index of `sites` by caller, 0 if empty, index + 1 otherwise
+    u32 siteSlotMask;
 } DebugAllocatorState;
 
 static inline u32 _debug_allocator_hash_ptr(void *ptr)
@@ -84,13 +127,41 @@ static inline u32 _debug_allocator_resize_threshold(u32 capacity)
     return threshold;
 }
 
+static inline void *_debug_allocator_meta_alloc(DebugAllocatorState *state, u64 bytes)
+{
+    void *block = state->targetAllocator->alloc(state->targetAllocator, bytes);
+    if (!block)
+        return NULL;
+
+    state->totalMetaAllocBytes += bytes;
+    state->activeOverheadBytes += bytes;
+    if (state->activeOverheadBytes > state->peakOverheadBytes)
+        state->peakOverheadBytes = state->activeOverheadBytes;
+
+    return block;
+}
+
+static inline void _debug_allocator_meta_free(DebugAllocatorState *state, void *block, u64 bytes)
+{
+    if (!block)
+        return;
+
+    if (state->activeOverheadBytes >= bytes)
+        state->activeOverheadBytes -= bytes;
+    else
+        state->activeOverheadBytes = 0;
+
+    state->totalMetaFreeBytes += bytes;
+    state->targetAllocator->free(state->targetAllocator, block);
+}
+
 static inline DebugAllocEntry *_debug_allocator_table_alloc(DebugAllocatorState *state, u32 capacity)
 {
     if (!state || !state->targetAllocator)
         return NULL;
 
     u64 bytes = (u64)capacity * (u64)sizeof(DebugAllocEntry);
-    DebugAllocEntry *entries = (DebugAllocEntry *)state->targetAllocator->alloc(state->targetAllocator, bytes);
+    DebugAllocEntry *entries = (DebugAllocEntry *)_debug_allocator_meta_alloc(state, bytes);
     if (!entries)
         return NULL;
 
@@ -98,14 +169,11 @@ static inline DebugAllocEntry *_debug_allocator_table_alloc(DebugAllocatorState
     {
         entries[i].ptr = NULL;
         entries[i].size = 0;
+        entries[i].samples = 0;
+        entries[i].site = _X_DEBUG_ALLOC_NO_SITE;
         entries[i].state = _X_DEBUG_ALLOC_ENTRY_EMPTY;
     }
 
-    state->totalMetaAllocBytes += bytes;
-    state->activeOverheadBytes += bytes;
-    if (state->activeOverheadBytes > state->peakOverheadBytes)
-        state->peakOverheadBytes = state->activeOverheadBytes;
-
     return entries;
 }
 
@@ -114,14 +182,7 @@ static inline void _debug_allocator_table_free(DebugAllocatorState *state, Debug
     if (!state || !state->targetAllocator || !table)
         return;
 
-    u64 bytes = (u64)capacity * (u64)sizeof(DebugAllocEntry);
-    if (state->activeOverheadBytes >= bytes)
-        state->activeOverheadBytes -= bytes;
-    else
-        state->activeOverheadBytes = 0;
-
-    state->totalMetaFreeBytes += bytes;
-    state->targetAllocator->free(state->targetAllocator, table);
+    _debug_allocator_meta_free(state, table, (u64)capacity * (u64)sizeof(DebugAllocEntry));
 }
 
 static inline DebugAllocEntry *_debug_allocator_find(DebugAllocatorState *state, void *ptr, u32 *indexOut)
@@ -155,6 +216,125 @@ static inline DebugAllocEntry *_debug_allocator_find(DebugAllocatorState *state,
     return NULL;
 }
 
+static inline Bool _debug_allocator_sites_grow(DebugAllocatorState *state)
+{
+    if (state->siteCapacity >= (1u << 29))
+        return false;
+
+    u32 newCapacity = state->siteCapacity << 1;
+    u32 slotCount = newCapacity << 1;
+
+    DebugAllocSite *newSites = (DebugAllocSite *)_debug_allocator_meta_alloc(state, (u64)newCapacity * sizeof(DebugAllocSite));
+    if (!newSites)
+        return false;
+
+    u32 *newSlots = (u32 *)_debug_allocator_meta_alloc(state, (u64)slotCount * sizeof(u32));
+    if (!newSlots)
+    {
+        _debug_allocator_meta_free(state, newSites, (u64)newCapacity * sizeof(DebugAllocSite));
+        return false;
+    }
+
+    for (u32 i = 0; i < slotCount; ++i)
+        newSlots[i] = 0;
+
+    u32 mask = slotCount - 1u;
+    for (u32 i = 0; i < state->siteCount; ++i)
+    {
+        newSites[i] = state->sites[i];
+
+        u32 idx = _debug_allocator_hash_ptr(newSites[i].caller) & mask;
+        while (newSlots[idx] != 0)
+            idx = (idx + 1u) & mask;
+        newSlots[idx] = i + 1u;
+    }
+
+    _debug_allocator_meta_free(state, state->sites, (u64)state->siteCapacity * sizeof(DebugAllocSite));
+    _debug_allocator_meta_free(state, state->siteSlots, ((u64)state->siteSlotMask + 1u) * sizeof(u32));
+
+    state->sites = newSites;
+    state->siteCapacity = newCapacity;
+    state->siteSlots = newSlots;
+    state->siteSlotMask = mask;
+    return true;
+}
+
+// Returns the index of the site of `caller`, created on first use
+static inline u32 _debug_allocator_site(DebugAllocatorState *state, void *caller)
+{
+    if (!state->sites || !caller)
+        return _X_DEBUG_ALLOC_NO_SITE;
+
+    u32 idx = _debug_allocator_hash_ptr(caller) & state->siteSlotMask;
+    while (state->siteSlots[idx] != 0)
+    {
+        u32 site = state->siteSlots[idx] - 1u;
+        if (state->sites[site].caller == caller)
+            return site;
+
+        idx = (idx + 1u) & state->siteSlotMask;
+    }
+
+    if (state->siteCount == state->siteCapacity)
+    {
+        if (!_debug_allocator_sites_grow(state))
+            return _X_DEBUG_ALLOC_NO_SITE;
+
+        // Slots were rebuilt
+        return _debug_allocator_site(state, caller);
+    }
+
+    u32 site = state->siteCount++;
+    state->sites[site] = (DebugAllocSite){
+        .caller = caller,
+        .liveCount = 0,
+        .liveBytes = 0,
+        .totalCount = 0,
+        .totalBytes = 0,
+        .liveEstimate = 0,
+        .peakEstimate = 0,
+    };
+    state->siteSlots[idx] = site + 1u;
+    return site;
+}
+
+// Bytes an entry stands for, more than its size for sampled allocations
+static inline u64 _debug_allocator_entry_weight(DebugAllocatorState *state, DebugAllocEntry *entry)
+{
+    return state->sampleInterval ? (u64)entry->samples * state->sampleInterval : entry->size;
+}
+
+// Attributes a freshly tracked entry to the site of `caller`
+static inline void _debug_allocator_site_add(DebugAllocatorState *state, DebugAllocEntry *entry, void *caller)
+{
+    entry->site = _debug_allocator_site(state, caller);
+    if (entry->site == _X_DEBUG_ALLOC_NO_SITE)
+        return;
+
+    DebugAllocSite *site = &state->sites[entry->site];
+    site->liveCount += 1u;
+    site->liveBytes += entry->size;
+    site->totalCount += 1u;
+    site->totalBytes += entry->size;
+    site->liveEstimate += _debug_allocator_entry_weight(state, entry);
+    if (site->liveEstimate > site->peakEstimate)
+        site->peakEstimate = site->liveEstimate;
+}
+
+static inline void _debug_allocator_site_remove(DebugAllocatorState *state, DebugAllocEntry *entry)
+{
+    if (entry->site == _X_DEBUG_ALLOC_NO_SITE)
+        return;
+
+    DebugAllocSite *site = &state->sites[entry->site];
+    u64 weight = _debug_allocator_entry_weight(state, entry);
+
+    site->liveCount -= site->liveCount > 0u ? 1u : 0u;
+    site->liveBytes -= site->liveBytes >= entry->size ? entry->size : site->liveBytes;
+    site->liveEstimate -= site->liveEstimate >= weight ? weight : site->liveEstimate;
+    entry->site = _X_DEBUG_ALLOC_NO_SITE;
+}
+
 static inline Bool _debug_allocator_grow(DebugAllocatorState *state);
 
 static inline DebugAllocEntry *_debug_allocator_insert(DebugAllocatorState *state, void *ptr, u64 size, Bool isReinsert)
@@ -162,7 +342,7 @@ static inline DebugAllocEntry *_debug_allocator_insert(DebugAllocatorState *stat
     if (!state || !state->table)
         return NULL;
 
-    if (!isReinsert && state->count + 1u > state->resizeThreshold)
+    if (!isReinsert && state->count + state->tombstones + 1u > state->resizeThreshold)
     {
         if (!_debug_allocator_grow(state))
             return NULL;
@@ -182,6 +362,8 @@ static inline DebugAllocEntry *_debug_allocator_insert(DebugAllocatorState *stat
             {
                 if (!isReinsert)
                 {
+                    _debug_allocator_site_remove(state, entry);
+
                     if (state->activeUserBytes >= entry->size)
                         state->activeUserBytes -= entry->size;
                     else
@@ -199,10 +381,18 @@ static inline DebugAllocEntry *_debug_allocator_insert(DebugAllocatorState *stat
         }
         else if (entry->state == _X_DEBUG_ALLOC_ENTRY_EMPTY)
         {
-            u32 targetIdx = (firstTombstone != 0xFFFFFFFFu) ? firstTombstone : idx;
+            u32 targetIdx = idx;
+            if (firstTombstone != 0xFFFFFFFFu)
+            {
+                targetIdx = firstTombstone;
+                state->tombstones -= 1u;
+            }
+
             DebugAllocEntry *target = &table[targetIdx];
             target->ptr = ptr;
             target->size = size;
+            target->samples = 1;
+            target->site = _X_DEBUG_ALLOC_NO_SITE;
             target->state = _X_DEBUG_ALLOC_ENTRY_FULL;
 
             state->count += 1u;
@@ -233,12 +423,14 @@ static inline void _debug_allocator_remove(DebugAllocatorState *state, u32 index
     if (entry->state != _X_DEBUG_ALLOC_ENTRY_FULL)
         return;
 
+    _debug_allocator_site_remove(state, entry);
     entry->state = _X_DEBUG_ALLOC_ENTRY_TOMB;
     entry->ptr = NULL;
     entry->size = 0;
 
     if (state->count > 0u)
         state->count -= 1u;
+    state->tombstones += 1u;
 }
 
 static inline Bool _debug_allocator_grow(DebugAllocatorState *state)
@@ -246,11 +438,16 @@ static inline Bool _debug_allocator_grow(DebugAllocatorState *state)
     if (!state || !state->table)
         return false;
 
+    // Mostly tombstones, rebuilding at the same capacity is enough
     u32 oldCapacity = state->capacity;
-    if (oldCapacity >= (1u << 30))
-        return false;
+    u32 newCapacity = oldCapacity;
+    if (state->tombstones < state->count)
+    {
+        if (oldCapacity >= (1u << 30))
+            return false;
+        newCapacity = oldCapacity << 1;
+    }
 
-    u32 newCapacity = oldCapacity << 1;
     DebugAllocEntry *newTable = _debug_allocator_table_alloc(state, newCapacity);
     if (!newTable)
         return false;
@@ -263,48 +460,211 @@ static inline Bool _debug_allocator_grow(DebugAllocatorState *state)
     state->resizeThreshold = _debug_allocator_resize_threshold(newCapacity);
 
     state->count = 0u;
+    state->tombstones = 0u;
 
     for (u32 i = 0u; i < oldCapacity; ++i)
     {
         if (oldTable[i].state == _X_DEBUG_ALLOC_ENTRY_FULL)
-            _debug_allocator_insert(state, oldTable[i].ptr, oldTable[i].size, true);
+        {
+            DebugAllocEntry *entry = _debug_allocator_insert(state, oldTable[i].ptr, oldTable[i].size, true);
+            entry->samples = oldTable[i].samples;
+            entry->site = oldTable[i].site;
+        }
     }
 
     _debug_allocator_table_free(state, oldTable, oldCapacity);
     return true;
 }
 
-static void *_debug_alloc(Allocator *a, u64 size)
+// Approximation of log2(x) for x >= 1, precise to ~0.01, enough to draw sample intervals
+static inline f64 _debug_allocator_log2(u64 x)
 {
-    if (!a || size == 0u)
-        return NULL;
+    u32 exponent = 63u - (u32)__builtin_clzll(x);
+    f64 t = (f64)x / (f64)((u64)1 << exponent) - 1.0;
+    return (f64)exponent + t * (1.4425449 + t * (-0.7181452 + t * 0.2757921));
+}
 
-    DebugAllocatorState *state = (DebugAllocatorState *)a->_internalState;
-    if (!state || !state->targetAllocator)
-        return NULL;
+// Draws the distance to the next sample point from an exponential distribution
+// of mean `sampleInterval`, making sample points a Poisson process over bytes
+static inline u64 _debug_allocator_next_sample(DebugAllocatorState *state)
+{
+    u64 x = state->sampleRng;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    state->sampleRng = x;
+
+    // -ln(u) for u uniform in (0, 1], from 26 random bits
+    u64 q = (x >> 38) + 1u;
+    f64 negLn = (26.0 - _debug_allocator_log2(q)) * 0.6931471805599453;
+    if (negLn < 0.0)
+        negLn = 0.0;
+
+    u64 next = (u64)(negLn * (f64)state->sampleInterval);
+    return next > 0 ? next : 1;
+}
 
-    void *ptr = state->targetAllocator->alloc(state->targetAllocator, size);
-    if (!ptr)
-        return NULL;
+// Counts sample points falling in an allocation of `size` bytes, 0 if not sampled
+static inline u32 _debug_allocator_sample_points(DebugAllocatorState *state, u64 size)
+{
+    if (size < state->bytesUntilSample)
+    {
+        state->bytesUntilSample -= size;
+        return 0;
+    }
+
+    u32 points = 0;
+    while (size >= state->bytesUntilSample)
+    {
+        size -= state->bytesUntilSample;
+        state->bytesUntilSample = _debug_allocator_next_sample(state);
+        if (points < 0xFFFFFFFFu)
+            points += 1;
+    }
+
+    state->bytesUntilSample -= size;
+    return points;
+}
+
+// Each sample point stands for `sampleInterval` bytes, which keeps estimates unbiased
+static inline void _debug_allocator_estimate_add(DebugAllocatorState *state, u64 size, u32 points)
+{
+    u64 bytes = (u64)points * state->sampleInterval;
+
+    state->estimatedActiveBytes += bytes;
+    state->estimatedTotalAllocBytes += bytes;
+    state->estimatedActiveAllocCount += (f64)bytes / (f64)size;
+    if (state->estimatedActiveBytes > state->estimatedPeakBytes)
+        state->estimatedPeakBytes = state->estimatedActiveBytes;
+}
+
+static inline void _debug_allocator_estimate_remove(DebugAllocatorState *state, DebugAllocEntry *entry)
+{
+    u64 bytes = (u64)entry->samples * state->sampleInterval;
+
+    if (state->estimatedActiveBytes >= bytes)
+        state->estimatedActiveBytes -= bytes;
+    else
+        state->estimatedActiveBytes = 0;
+
+    state->estimatedActiveAllocCount -= (f64)bytes / (f64)entry->size;
+    if (state->estimatedActiveAllocCount < 0.0)
+        state->estimatedActiveAllocCount = 0.0;
+}
+
+// Sampling mode counterpart of `_debug_allocator_track_alloc()`, never fails the allocation
+static inline void _debug_allocator_sample_alloc(DebugAllocatorState *state, void *ptr, u64 size, void *caller)
+{
+    state->totalMallocCalls += 1u;
+    state->totalAllocBytes += size;
+
+    u32 points = _debug_allocator_sample_points(state, size);
+    if (points == 0)
+        return;
 
     DebugAllocEntry *entry = _debug_allocator_insert(state, ptr, size, false);
     if (!entry)
     {
         state->trackingOverflow = true;
         state->failedInsertions += 1u;
-        state->targetAllocator->free(state->targetAllocator, ptr);
-        return NULL;
+        return;
     }
 
+    entry->samples = points;
+    _debug_allocator_estimate_add(state, size, points);
+    _debug_allocator_site_add(state, entry, caller);
+
+    state->activeAllocCount += 1u;
+    if (state->activeAllocCount > state->peakAllocCount)
+        state->peakAllocCount = state->activeAllocCount;
+}
+
+static inline Bool _debug_allocator_track_alloc(DebugAllocatorState *state, void *ptr, u64 size, void *caller)
+{
+    if (state->sampleInterval)
+    {
+        _debug_allocator_sample_alloc(state, ptr, size, caller);
+        return true;
+    }
+
+    DebugAllocEntry *entry = _debug_allocator_insert(state, ptr, size, false);
+    if (!entry)
+    {
+        state->trackingOverflow = true;
+        state->failedInsertions += 1u;
+        return false;
+    }
+
+    _debug_allocator_site_add(state, entry, caller);
+
     state->activeAllocCount += 1u;
     if (state->activeAllocCount > state->peakAllocCount)
         state->peakAllocCount = state->activeAllocCount;
 
     state->totalMallocCalls += 1u;
     state->totalAllocBytes += size;
+    return true;
+}
+
+// Stops tracking `block`, returns false if it was not tracked
+static inline Bool _debug_allocator_untrack(DebugAllocatorState *state, void *block)
+{
+    u32 index = 0u;
+    DebugAllocEntry *entry = _debug_allocator_find(state, block, &index);
+    if (!entry)
+        return false;
+
+    if (state->sampleInterval)
+        _debug_allocator_estimate_remove(state, entry);
+
+    if (state->activeUserBytes >= entry->size)
+        state->activeUserBytes -= entry->size;
+    else
+        state->activeUserBytes = 0;
+
+    if (state->activeAllocCount > 0u)
+        state->activeAllocCount -= 1u;
+
+    state->totalFreedBytes += entry->size;
+    _debug_allocator_remove(state, index);
+    return true;
+}
+
+static inline void _debug_allocator_track_free(DebugAllocatorState *state, void *block)
+{
+    state->totalFreeCalls += 1u;
+
+    // Unsampled blocks are expected in sampling mode
+    if (!_debug_allocator_untrack(state, block) && !state->sampleInterval)
+        state->untrackedFrees += 1u;
+}
+
+static void *_debug_alloc_at(Allocator *a, u64 size, void *caller)
+{
+    if (!a || size == 0u)
+        return NULL;
+
+    DebugAllocatorState *state = (DebugAllocatorState *)a->_internalState;
+    if (!state || !state->targetAllocator)
+        return NULL;
+
+    void *ptr = state->targetAllocator->alloc(state->targetAllocator, size);
+    if (!ptr)
+        return NULL;
+
+    if (!_debug_allocator_track_alloc(state, ptr, size, caller))
+    {
+        state->targetAllocator->free(state->targetAllocator, ptr);
+        return NULL;
+    }
     return ptr;
 }
 
+static void *_debug_alloc(Allocator *a, u64 size)
+{
+    return _debug_alloc_at(a, size, _X_DEBUG_ALLOC_CALLER());
+}
+
 static void _debug_free(Allocator *a, void *block)
 {
     if (!a || !block)
@@ -314,28 +674,74 @@ static void _debug_free(Allocator *a, void *block)
     if (!state || !state->targetAllocator)
         return;
 
-    u32 index = 0u;
-    DebugAllocEntry *entry = _debug_allocator_find(state, block, &index);
-
+    _debug_allocator_track_free(state, block);
     state->targetAllocator->free(state->targetAllocator, block);
-    state->totalFreeCalls += 1u;
+}
 
-    if (!entry)
+static void *_debug_alloc_aligned(Allocator *a, u64 size, u64 alignment)
+{
+    if (!a || size == 0u)
+        return NULL;
+
+    DebugAllocatorState *state = (DebugAllocatorState *)a->_internalState;
+    if (!state || !state->targetAllocator)
+        return NULL;
+
+    Allocator *target = state->targetAllocator;
+    void *ptr = allocator_alloc_aligned(target, size, alignment);
+    if (!ptr)
+        return NULL;
+
+    if (!_debug_allocator_track_alloc(state, ptr, size, _X_DEBUG_ALLOC_CALLER()))
     {
-        state->untrackedFrees += 1u;
-        return;
+        allocator_free_aligned(target, ptr);
+        return NULL;
     }
+    return ptr;
+}
 
-    if (state->activeUserBytes >= entry->size)
-        state->activeUserBytes -= entry->size;
-    else
-        state->activeUserBytes = 0;
+static void _debug_free_aligned(Allocator *a, void *block)
+{
+    if (!a || !block)
+        return;
 
-    if (state->activeAllocCount > 0u)
-        state->activeAllocCount -= 1u;
+    DebugAllocatorState *state = (DebugAllocatorState *)a->_internalState;
+    if (!state || !state->targetAllocator)
+        return;
 
-    state->totalFreedBytes += entry->size;
-    _debug_allocator_remove(state, index);
+    _debug_allocator_track_free(state, block);
+    allocator_free_aligned(state->targetAllocator, block);
+}
+
+static u64 _debug_usable_size(Allocator *a, void *block)
+{
+    if (!a || !block)
+        return 0;
+
+    DebugAllocatorState *state = (DebugAllocatorState *)a->_internalState;
+    if (!state)
+        return 0;
+
+    // Only the requested size is reported, so that tracked bytes stay exact
+    DebugAllocEntry *entry = _debug_allocator_find(state, block, NULL);
+    return entry ? entry->size : 0;
+}
+
+static void _debug_free_sized(Allocator *a, void *block, u64 size)
+{
+    if (!a || !block)
+        return;
+
+    DebugAllocatorState *state = (DebugAllocatorState *)a->_internalState;
+    if (!state || !state->targetAllocator)
+        return;
+
+    DebugAllocEntry *entry = _debug_allocator_find(state, block, NULL);
+    if (entry && entry->size != size)
+        state->sizedFreeMismatches += 1u;
+
+    _debug_allocator_track_free(state, block);
+    allocator_free_sized(state->targetAllocator, block, size);
 }
 
 static void *_debug_realloc(Allocator *a, void *block, u64 newSize)
@@ -347,8 +753,10 @@ static void *_debug_realloc(Allocator *a, void *block, u64 newSize)
     if (!state || !state->targetAllocator)
         return NULL;
 
+    void *caller = _X_DEBUG_ALLOC_CALLER();
+
     if (!block)
-        return _debug_alloc(a, newSize);
+        return _debug_alloc_at(a, newSize, caller);
 
     if (newSize == 0u)
     {
@@ -356,6 +764,18 @@ static void *_debug_realloc(Allocator *a, void *block, u64 newSize)
         return NULL;
     }
 
+    if (state->sampleInterval)
+    {
+        void *moved = state->targetAllocator->realloc(state->targetAllocator, block, newSize);
+        if (!moved)
+            return NULL;
+
+        // Resampled as a new allocation, the old block stops being tracked
+        _debug_allocator_untrack(state, block);
+        _debug_allocator_sample_alloc(state, moved, newSize, caller);
+        return moved;
+    }
+
     u32 oldIndex = 0u;
     DebugAllocEntry *entry = _debug_allocator_find(state, block, &oldIndex);
     u64 oldSize = entry ? entry->size : 0u;
@@ -375,6 +795,10 @@ static void *_debug_realloc(Allocator *a, void *block, u64 newSize)
             state->trackingOverflow = true;
             state->failedInsertions += 1u;
         }
+        else
+        {
+            _debug_allocator_site_add(state, updated, caller);
+        }
         return ptr;
     }
 
@@ -405,6 +829,7 @@ static void *_debug_realloc(Allocator *a, void *block, u64 newSize)
         return NULL;
     }
 
+    _debug_allocator_site_add(state, newEntry, caller);
     state->activeAllocCount += 1u;
     if (state->activeAllocCount > state->peakAllocCount)
         state->peakAllocCount = state->activeAllocCount;
@@ -452,6 +877,7 @@ static inline result_type(Allocator) debug_allocator(DebugAllocatorState *state,
         .table = NULL,
         .capacity = capacity,
         .count = 0,
+        .tombstones = 0,
         .mask = capacity - 1,
         .resizeThreshold = _debug_allocator_resize_threshold(capacity),
         .activeAllocCount = 0,
@@ -470,6 +896,19 @@ static inline result_type(Allocator) debug_allocator(DebugAllocatorState *state,
         .failedInsertions = 0,
         .untrackedFrees = 0,
         .untrackedReallocs = 0,
+        .sizedFreeMismatches = 0,
+        .sampleInterval = 0,
+        .bytesUntilSample = 0,
+        .sampleRng = 0,
+        .estimatedActiveBytes = 0,
+        .estimatedPeakBytes = 0,
+        .estimatedTotalAllocBytes = 0,
+        .estimatedActiveAllocCount = 0.0,
+        .sites = NULL,
+        .siteCount = 0,
+        .siteCapacity = 0,
+        .siteSlots = NULL,
+        .siteSlotMask = 0,
     };
 
     DebugAllocEntry *table = _debug_allocator_table_alloc(state, capacity);
@@ -484,6 +923,116 @@ static inline result_type(Allocator) debug_allocator(DebugAllocatorState *state,
         .alloc = _debug_alloc,
         .realloc = _debug_realloc,
         .free = _debug_free,
+        .alloc_aligned = _debug_alloc_aligned,
+        .free_aligned = _debug_free_aligned,
+        .usable_size = _debug_usable_size,
+        .free_sized = _debug_free_sized,
     };
     return result_ok(Allocator, a);
 }
+
+/**
+ * @brief Creates a debug allocator in sampling mode, cheap enough to leave on in
+ * production. Only about one allocation per `sampleInterval` bytes is tracked,
+ * picked Poisson-style so that every byte has the same chance of being sampled.
+ *
+ * Exact call and byte counters (`totalMallocCalls`, `totalAllocBytes`...) are
+ * kept for every allocation. Live and peak figures are extrapolated from the
+ * sampled allocations into the `estimated*` fields of `state`, while the
+ * `active*`/`peak*` fields only count sampled allocations.
+ *
+ * ```c
+ * DebugAllocatorState state;
+ * ResAllocator dbgAllocRes = debug_allocator_sampled(&state, default_allocator(), 0);
+ * if (dbgAllocRes.isErr) // Error!
+ * // Periodically report heap growth
+ * io_print_uint(state.estimatedActiveBytes);
+ * ```
+ *
+ * @param state
+ * @param wrappedAllocator
+ * @param sampleInterval mean bytes between sampled allocations, 0 for the default of 512KiB
+ * @return ResAllocator
+ * @exception ERR_INVALID_PARAMETER, ERR_OUT_OF_MEMORY
+ */
+static inline result_type(Allocator) debug_allocator_sampled(DebugAllocatorState *state, Allocator *wrappedAllocator, u64 sampleInterval)
+{
+    ResAllocator res = debug_allocator(state, 64, wrappedAllocator);
+    if (res.isErr)
+        return res;
+
+    state->sampleInterval = sampleInterval ? sampleInterval : _X_DEBUG_ALLOC_DEFAULT_SAMPLE_INTERVAL;
+    state->sampleRng = ((u64)(uPtr)state ^ 0x9e3779b97f4a7c15ull) | 1u;
+    state->bytesUntilSample = _debug_allocator_next_sample(state);
+    return res;
+}
+
+/**
+ * @brief Enables call-site attribution: every tracked allocation is attributed
+ * to the return address of its `alloc`/`realloc` call, and live, peak and total
+ * bytes are aggregated per site in `state->sites`.
+ *
+ * Call right after creating the allocator. Write the result with
+ * `debug_allocator_write_profile()` or `debug_allocator_write_pprof()`.
+ *
+ * ```c
+ * DebugAllocatorState state;
+ * ResAllocator dbgAllocRes = debug_allocator(&state, 128, default_allocator());
+ * if (dbgAllocRes.isErr) // Error!
+ * Error err = debug_allocator_track_sites(&state, 64);
+ * ```
+ *
+ * @param state
+ * @param requestedCapacity initial number of sites, grows as needed
+ * @return Error
+ * @exception ERR_INVALID_PARAMETER, ERR_OUT_OF_MEMORY
+ */
+static inline Error debug_allocator_track_sites(DebugAllocatorState *state, u32 requestedCapacity)
+{
+    if (!state || !state->targetAllocator || state->sites)
+        return X_ERR_EXT("alloc_debug", "debug_allocator_track_sites", ERR_INVALID_PARAMETER, "null arg or already tracking");
+
+    u32 capacity = _debug_allocator_next_pow2(requestedCapacity);
+    u32 slotCount = capacity << 1;
+
+    DebugAllocSite *sites = (DebugAllocSite *)_debug_allocator_meta_alloc(state, (u64)capacity * sizeof(DebugAllocSite));
+    u32 *slots = (u32 *)_debug_allocator_meta_alloc(state, (u64)slotCount * sizeof(u32));
+    if (!sites || !slots)
+    {
+        _debug_allocator_meta_free(state, sites, (u64)capacity * sizeof(DebugAllocSite));
+        _debug_allocator_meta_free(state, slots, (u64)slotCount * sizeof(u32));
+        return X_ERR_EXT("alloc_debug", "debug_allocator_track_sites", ERR_OUT_OF_MEMORY, "alloc failure");
+    }
+
+    for (u32 i = 0; i < slotCount; ++i)
+        slots[i] = 0;
+
+    state->sites = sites;
+    state->siteCount = 0;
+    state->siteCapacity = capacity;
+    state->siteSlots = slots;
+    state->siteSlotMask = slotCount - 1u;
+    return X_ERR_OK;
+}
+
+/**
+ * @brief Releases the tracking table and call sites of a debug allocator. Tracked
+ * allocations are not freed, read the leak counters of `state` before this call.
+ *
+ * @param state
+ */
+static inline void debug_allocator_deinit(DebugAllocatorState *state)
+{
+    if (!state || !state->targetAllocator)
+        return;
+
+    _debug_allocator_table_free(state, state->table, state->capacity);
+    _debug_allocator_meta_free(state, state->sites, (u64)state->siteCapacity * sizeof(DebugAllocSite));
+    _debug_allocator_meta_free(state, state->siteSlots, ((u64)state->siteSlotMask + 1u) * sizeof(u32));
+
+    state->table = NULL;
+    state->sites = NULL;
+    state->siteSlots = NULL;
+    state->siteCount = 0;
+    state->siteCapacity = 0;
+}
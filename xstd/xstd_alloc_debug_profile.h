@@ -0,0 +1,251 @@
+#pragma once
+
+// Heap profile export of the call sites tracked by the debug allocator,
+// see `debug_allocator_track_sites()`
+
+#include "xstd_core.h"
+#include "xstd_error.h"
+#include "xstd_alloc_debug.h"
+#include "xstd_file.h"
+
+static inline Error _debug_profile_write_hex(File *file, u64 value)
+{
+    static const char digits[] = "0123456789abcdef";
+    char buf[19];
+    i32 idx = 18;
+
+    buf[idx] = 0;
+    do
+    {
+        buf[--idx] = digits[value & 0xFu];
+        value >>= 4;
+    } while (value != 0);
+
+    buf[--idx] = 'x';
+    buf[--idx] = '0';
+    return file_write_str(file, buf + idx);
+}
+
+// Fills `order` with site indices sorted by decreasing live bytes, then peak bytes
+static inline void _debug_profile_sort_sites(DebugAllocatorState *state, u32 *order)
+{
+    DebugAllocSite *sites = state->sites;
+    u32 n = state->siteCount;
+
+    for (u32 i = 0; i < n; ++i)
+        order[i] = i;
+
+    // Shell sort, profiles are written rarely and hold few sites
+    for (u32 gap = n / 2; gap > 0; gap /= 2)
+    {
+        for (u32 i = gap; i < n; ++i)
+        {
+            u32 cur = order[i];
+            u32 j = i;
+
+            while (j >= gap)
+            {
+                DebugAllocSite *prev = &sites[order[j - gap]];
+                Bool before = sites[cur].liveEstimate > prev->liveEstimate ||
+                              (sites[cur].liveEstimate == prev->liveEstimate && sites[cur].peakEstimate > prev->peakEstimate);
+                if (!before)
+                    break;
+
+                order[j] = order[j - gap];
+                j -= gap;
+            }
+            order[j] = cur;
+        }
+    }
+}
+
+static inline Error _debug_profile_write_text(DebugAllocatorState *state, File *file, u32 *order)
+{
+    Error err = file_write_str(file, state->sampleInterval ? "# xstd heap profile, sampled every " : "# xstd heap profile, exact");
+    if (err.code != ERR_OK)
+        return err;
+
+    if (state->sampleInterval)
+    {
+        if ((err = file_write_uint(file, state->sampleInterval)).code != ERR_OK)
+            return err;
+        if ((err = file_write_str(file, " bytes, bytes are extrapolated")).code != ERR_OK)
+            return err;
+    }
+
+    err = file_write_str(file, "\n# live_bytes peak_bytes live_count total_bytes total_count site\n");
+    if (err.code != ERR_OK)
+        return err;
+
+    for (u32 i = 0; i < state->siteCount; ++i)
+    {
+        DebugAllocSite *site = &state->sites[order[i]];
+        const u64 columns[5] = {site->liveEstimate, site->peakEstimate, site->liveCount, site->totalBytes, site->totalCount};
+
+        for (u32 c = 0; c < 5; ++c)
+        {
+            if ((err = file_write_uint(file, columns[c])).code != ERR_OK)
+                return err;
+            if ((err = file_write_char(file, ' ')).code != ERR_OK)
+                return err;
+        }
+
+        if ((err = _debug_profile_write_hex(file, (u64)(uPtr)site->caller)).code != ERR_OK)
+            return err;
+        if ((err = file_write_char(file, '\n')).code != ERR_OK)
+            return err;
+    }
+
+    return X_ERR_OK;
+}
+
+// "<liveCount>: <liveBytes> [<totalCount>: <totalBytes>] @ "
+static inline Error _debug_profile_write_pprof_counts(File *file, u64 liveCount, u64 liveBytes, u64 totalCount, u64 totalBytes)
+{
+    Error err;
+    if ((err = file_write_uint(file, liveCount)).code != ERR_OK)
+        return err;
+    if ((err = file_write_str(file, ": ")).code != ERR_OK)
+        return err;
+    if ((err = file_write_uint(file, liveBytes)).code != ERR_OK)
+        return err;
+    if ((err = file_write_str(file, " [")).code != ERR_OK)
+        return err;
+    if ((err = file_write_uint(file, totalCount)).code != ERR_OK)
+        return err;
+    if ((err = file_write_str(file, ": ")).code != ERR_OK)
+        return err;
+    if ((err = file_write_uint(file, totalBytes)).code != ERR_OK)
+        return err;
+    return file_write_str(file, "] @ ");
+}
+
+static inline Error _debug_profile_write_pprof(DebugAllocatorState *state, File *file, u32 *order)
+{
+    u64 liveCount = 0, liveBytes = 0, totalCount = 0, totalBytes = 0;
+    for (u32 i = 0; i < state->siteCount; ++i)
+    {
+        liveCount += state->sites[i].liveCount;
+        liveBytes += state->sites[i].liveBytes;
+        totalCount += state->sites[i].totalCount;
+        totalBytes += state->sites[i].totalBytes;
+    }
+
+    // Raw sampled values, pprof extrapolates them from the sampling period
+    Error err = file_write_str(file, "heap profile: ");
+    if (err.code != ERR_OK)
+        return err;
+    if ((err = _debug_profile_write_pprof_counts(file, liveCount, liveBytes, totalCount, totalBytes)).code != ERR_OK)
+        return err;
+    if ((err = file_write_str(file, "heap_v2/")).code != ERR_OK)
+        return err;
+    if ((err = file_write_uint(file, state->sampleInterval ? state->sampleInterval : 1)).code != ERR_OK)
+        return err;
+    if ((err = file_write_char(file, '\n')).code != ERR_OK)
+        return err;
+
+    for (u32 i = 0; i < state->siteCount; ++i)
+    {
+        DebugAllocSite *site = &state->sites[order[i]];
+
+        err = _debug_profile_write_pprof_counts(file, site->liveCount, site->liveBytes, site->totalCount, site->totalBytes);
+        if (err.code != ERR_OK)
+            return err;
+        if ((err = _debug_profile_write_hex(file, (u64)(uPtr)site->caller)).code != ERR_OK)
+            return err;
+        if ((err = file_write_char(file, '\n')).code != ERR_OK)
+            return err;
+    }
+
+    // Lets pprof symbolize addresses of position independent executables
+    if (!file_exists("/proc/self/maps"))
+        return X_ERR_OK;
+
+    ResFile mapsRes = file_open("/proc/self/maps", EnumFileOpenMode.READ);
+    if (mapsRes.isErr)
+        return X_ERR_OK;
+
+    err = file_write_str(file, "\nMAPPED_LIBRARIES:\n");
+
+    i8 chunk[4096];
+    u64 read = 0;
+    while (err.code == ERR_OK && (read = _file_read_internal(&mapsRes.value, chunk, sizeof(chunk), false)) > 0)
+        err = file_write_bytes(file, (Buffer){.bytes = chunk, .size = read});
+
+    file_close(&mapsRes.value);
+    return err;
+}
+
+// Returns site indices sorted for output, NULL if there are no sites or on alloc failure
+static inline u32 *_debug_profile_sorted_sites(DebugAllocatorState *state)
+{
+    if (state->siteCount == 0)
+        return NULL;
+
+    Allocator *a = state->targetAllocator;
+    u32 *order = (u32 *)a->alloc(a, (u64)state->siteCount * sizeof(u32));
+    if (order)
+        _debug_profile_sort_sites(state, order);
+
+    return order;
+}
+
+/**
+ * @brief Writes a human readable heap profile of the tracked call sites to `file`,
+ * one line per site sorted by decreasing live bytes.
+ *
+ * Sites are return addresses, resolve them with `addr2line -e <binary>` (after
+ * subtracting the load address of position independent executables).
+ *
+ * ```c
+ * debug_allocator_track_sites(&state, 64);
+ * // Run the workload
+ * debug_allocator_write_profile(&state, io_stdout());
+ * ```
+ *
+ * @param state debug allocator state with call-site tracking enabled
+ * @param file
+ * @return Error
+ * @exception ERR_INVALID_PARAMETER, ERR_OUT_OF_MEMORY, or any write error
+ */
+static inline Error debug_allocator_write_profile(DebugAllocatorState *state, File *file)
+{
+    if (!state || !state->targetAllocator || !file || !state->sites)
+        return X_ERR_EXT("alloc_debug_profile", "debug_allocator_write_profile", ERR_INVALID_PARAMETER, "null arg or sites not tracked");
+
+    u32 *order = _debug_profile_sorted_sites(state);
+    if (!order && state->siteCount > 0)
+        return X_ERR_EXT("alloc_debug_profile", "debug_allocator_write_profile", ERR_OUT_OF_MEMORY, "alloc failure");
+
+    Error err = _debug_profile_write_text(state, file, order);
+    if (order)
+        state->targetAllocator->free(state->targetAllocator, order);
+    return err;
+}
+
+/**
+ * @brief Writes the tracked call sites to `file` in the legacy heap profile
+ * format read by pprof (`pprof -top <binary> <file>`).
+ *
+ * In sampling mode, raw sampled values are written along with the sampling
+ * period, pprof extrapolates them.
+ *
+ * @param state debug allocator state with call-site tracking enabled
+ * @param file
+ * @return Error
+ * @exception ERR_INVALID_PARAMETER, ERR_OUT_OF_MEMORY, or any write error
+ */
+static inline Error debug_allocator_write_pprof(DebugAllocatorState *state, File *file)
+{
+    if (!state || !state->targetAllocator || !file || !state->sites)
+        return X_ERR_EXT("alloc_debug_profile", "debug_allocator_write_pprof", ERR_INVALID_PARAMETER, "null arg or sites not tracked");
+
+    u32 *order = _debug_profile_sorted_sites(state);
+    if (!order && state->siteCount > 0)
+        return X_ERR_EXT("alloc_debug_profile", "debug_allocator_write_pprof", ERR_OUT_OF_MEMORY, "alloc failure");
+
+    Error err = _debug_profile_write_pprof(state, file, order);
+    if (order)
+        state->targetAllocator->free(state->targetAllocator, order);
+    return err;
+}
@@ -0,0 +1,359 @@
+#pragma once
+
+// Thread-safe debug allocator, tracking tables are partitioned by pointer hash
+// into shards guarded by their own lock
+
+#include "xstd_core.h"
+#include "xstd_result.h"
+#include "xstd_alloc.h"
+#include "xstd_alloc_debug.h"
+
+// Shard locks are built on the __atomic builtins
+#if !defined(__GNUC__) && !defined(__clang__)
+    #error "xstd_alloc_debug_sharded.h requires GCC or Clang"
+#endif
+
+#define _X_DEBUG_SHARD_COUNT 16u
+#define _X_DEBUG_SHARD_CACHE_LINE 64u
+
+// Each shard starts on its own cache line, so the lock and counters of
+// neighbouring shards never share one
+typedef struct _debug_allocator_shard
+{
+    DebugAllocatorState state;
+    volatile Bool lock;
+} __attribute__((aligned(_X_DEBUG_SHARD_CACHE_LINE))) _DebugAllocatorShard;
+
+// ShardedDebugAllocator State
+typedef struct _sharded_debug_allocator_state
+{
+    Allocator *targetAllocator;
+    _DebugAllocatorShard shards[_X_DEBUG_SHARD_COUNT];
+} ShardedDebugAllocatorState;
+
+static inline _DebugAllocatorShard *_debug_sharded_shard(ShardedDebugAllocatorState *state, void *ptr)
+{
+    // High bits, tables inside a shard index with the low ones
+    return &state->shards[_debug_allocator_hash_ptr(ptr) >> 28];
+}
+
+// Tells the core it is spinning, frees pipeline resources for the lock owner
+static inline void _debug_sharded_pause(void)
+{
+    #if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+    #elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+    #endif
+}
+
+// Test-and-test-and-set: waiters spin on a plain load of their cached copy
+// and only retry the atomic write once the lock looks free. Realloc holds the
+// lock across the target's realloc, so waits can be long.
+static inline void _debug_sharded_lock(_DebugAllocatorShard *shard)
+{
+    while (__atomic_test_and_set(&shard->lock, __ATOMIC_ACQUIRE))
+    {
+        while (__atomic_load_n(&shard->lock, __ATOMIC_RELAXED))
+            _debug_sharded_pause();
+    }
+}
+
+static inline void _debug_sharded_unlock(_DebugAllocatorShard *shard)
+{
+    __atomic_clear(&shard->lock, __ATOMIC_RELEASE);
+}
+
+static inline void *_debug_sharded_track(ShardedDebugAllocatorState *state, void *ptr, u64 size, Bool aligned)
+{
+    _DebugAllocatorShard *shard = _debug_sharded_shard(state, ptr);
+
+    _debug_sharded_lock(shard);
+    Bool tracked = _debug_allocator_track_alloc(&shard->state, ptr, size, NULL);
+    _debug_sharded_unlock(shard);
+
+    if (tracked)
+        return ptr;
+
+    Allocator *target = state->targetAllocator;
+    if (aligned)
+        allocator_free_aligned(target, ptr);
+    else
+        target->free(target, ptr);
+    return NULL;
+}
+
+static void *_debug_sharded_alloc(Allocator *a, u64 size)
+{
+    if (!a || !a->_internalState || size == 0u)
+        return NULL;
+
+    ShardedDebugAllocatorState *state = (ShardedDebugAllocatorState *)a->_internalState;
+    Allocator *target = state->targetAllocator;
+
+    void *ptr = target->alloc(target, size);
+    if (!ptr)
+        return NULL;
+
+    return _debug_sharded_track(state, ptr, size, false);
+}
+
+static void *_debug_sharded_alloc_aligned(Allocator *a, u64 size, u64 alignment)
+{
+    if (!a || !a->_internalState || size == 0u)
+        return NULL;
+
+    ShardedDebugAllocatorState *state = (ShardedDebugAllocatorState *)a->_internalState;
+    Allocator *target = state->targetAllocator;
+    void *ptr = allocator_alloc_aligned(target, size, alignment);
+    if (!ptr)
+        return NULL;
+
+    return _debug_sharded_track(state, ptr, size, true);
+}
+
+// Untracks before releasing, once freed the address may be tracked again by another thread
+static void _debug_sharded_free(Allocator *a, void *block)
+{
+    if (!a || !a->_internalState || !block)
+        return;
+
+    ShardedDebugAllocatorState *state = (ShardedDebugAllocatorState *)a->_internalState;
+    _DebugAllocatorShard *shard = _debug_sharded_shard(state, block);
+
+    _debug_sharded_lock(shard);
+    _debug_allocator_track_free(&shard->state, block);
+    _debug_sharded_unlock(shard);
+
+    state->targetAllocator->free(state->targetAllocator, block);
+}
+
+static void _debug_sharded_free_aligned(Allocator *a, void *block)
+{
+    if (!a || !a->_internalState || !block)
+        return;
+
+    ShardedDebugAllocatorState *state = (ShardedDebugAllocatorState *)a->_internalState;
+    _DebugAllocatorShard *shard = _debug_sharded_shard(state, block);
+
+    _debug_sharded_lock(shard);
+    _debug_allocator_track_free(&shard->state, block);
+    _debug_sharded_unlock(shard);
+
+    allocator_free_aligned(state->targetAllocator, block);
+}
+
+static void _debug_sharded_free_sized(Allocator *a, void *block, u64 size)
+{
+    if (!a || !a->_internalState || !block)
+        return;
+
+    ShardedDebugAllocatorState *state = (ShardedDebugAllocatorState *)a->_internalState;
+    _DebugAllocatorShard *shard = _debug_sharded_shard(state, block);
+
+    _debug_sharded_lock(shard);
+    DebugAllocEntry *entry = _debug_allocator_find(&shard->state, block, NULL);
+    if (entry && entry->size != size)
+        shard->state.sizedFreeMismatches += 1u;
+    _debug_allocator_track_free(&shard->state, block);
+    _debug_sharded_unlock(shard);
+
+    allocator_free_sized(state->targetAllocator, block, size);
+}
+
+static u64 _debug_sharded_usable_size(Allocator *a, void *block)
+{
+    if (!a || !a->_internalState || !block)
+        return 0;
+
+    ShardedDebugAllocatorState *state = (ShardedDebugAllocatorState *)a->_internalState;
+    _DebugAllocatorShard *shard = _debug_sharded_shard(state, block);
+
+    _debug_sharded_lock(shard);
+    DebugAllocEntry *entry = _debug_allocator_find(&shard->state, block, NULL);
+    u64 size = entry ? entry->size : 0;
+    _debug_sharded_unlock(shard);
+
+    return size;
+}
+
+static void *_debug_sharded_realloc(Allocator *a, void *block, u64 newSize)
+{
+    if (!a || !a->_internalState)
+        return NULL;
+
+    if (!block)
+        return _debug_sharded_alloc(a, newSize);
+
+    if (newSize == 0u)
+    {
+        _debug_sharded_free(a, block);
+        return NULL;
+    }
+
+    ShardedDebugAllocatorState *state = (ShardedDebugAllocatorState *)a->_internalState;
+    Allocator *target = state->targetAllocator;
+    _DebugAllocatorShard *oldShard = _debug_sharded_shard(state, block);
+
+    // Old shard stays locked until the old block is untracked, the target may
+    // free it and hand its address to another thread right away
+    _debug_sharded_lock(oldShard);
+
+    void *ptr = target->realloc(target, block, newSize);
+    if (!ptr)
+    {
+        _debug_sharded_unlock(oldShard);
+        return NULL;
+    }
+
+    DebugAllocatorState *oldState = &oldShard->state;
+    if (!_debug_allocator_untrack(oldState, block))
+        oldState->untrackedReallocs += 1u;
+
+    _DebugAllocatorShard *newShard = _debug_sharded_shard(state, ptr);
+    if (newShard != oldShard)
+    {
+        _debug_sharded_unlock(oldShard);
+        _debug_sharded_lock(newShard);
+    }
+
+    // Counted as one allocation call, like `_debug_realloc()`. The old block is
+    // gone, so an untracked block is still handed back, the failure only sets
+    // `trackingOverflow` and counts in `failedInsertions`
+    _debug_allocator_track_alloc(&newShard->state, ptr, newSize, NULL);
+    _debug_sharded_unlock(newShard);
+
+    return ptr;
+}
+
+/**
+ * @brief Merges the statistics of every shard into a single state, table excluded.
+ *
+ * Counters are read shard by shard, so the result is not an atomic snapshot
+ * while other threads allocate. `peak*` fields are the sum of per-shard peaks,
+ * an upper bound of the global peak.
+ *
+ * ```c
+ * DebugAllocatorState stats = debug_allocator_sharded_stats(&state);
+ * io_print_uint(stats.activeAllocCount);
+ * ```
+ *
+ * @param state
+ * @return DebugAllocatorState with `table` set to NULL
+ */
+static inline DebugAllocatorState debug_allocator_sharded_stats(ShardedDebugAllocatorState *state)
+{
+    DebugAllocatorState total = {0};
+    if (!state)
+        return total;
+
+    total.targetAllocator = state->targetAllocator;
+
+    for (u32 i = 0; i < _X_DEBUG_SHARD_COUNT; ++i)
+    {
+        _DebugAllocatorShard *shard = &state->shards[i];
+
+        _debug_sharded_lock(shard);
+        DebugAllocatorState *s = &shard->state;
+
+        total.capacity += s->capacity;
+        total.count += s->count;
+        total.activeAllocCount += s->activeAllocCount;
+        total.peakAllocCount += s->peakAllocCount;
+        total.activeUserBytes += s->activeUserBytes;
+        total.peakUserBytes += s->peakUserBytes;
+        total.activeOverheadBytes += s->activeOverheadBytes;
+        total.peakOverheadBytes += s->peakOverheadBytes;
+        total.totalMallocCalls += s->totalMallocCalls;
+        total.totalFreeCalls += s->totalFreeCalls;
+        total.totalAllocBytes += s->totalAllocBytes;
+        total.totalFreedBytes += s->totalFreedBytes;
+        total.totalMetaAllocBytes += s->totalMetaAllocBytes;
+        total.totalMetaFreeBytes += s->totalMetaFreeBytes;
+        total.trackingOverflow = total.trackingOverflow || s->trackingOverflow;
+        total.failedInsertions += s->failedInsertions;
+        total.untrackedFrees += s->untrackedFrees;
+        total.untrackedReallocs += s->untrackedReallocs;
+        total.sizedFreeMismatches += s->sizedFreeMismatches;
+
+        _debug_sharded_unlock(shard);
+    }
+
+    return total;
+}
+
+/**
+ * @brief Releases the tracking tables of every shard. Tracked allocations are
+ * not freed, read the leak counters with `debug_allocator_sharded_stats()` first.
+ *
+ * Must not run concurrently with allocations.
+ *
+ * @param state
+ */
+static inline void debug_allocator_sharded_deinit(ShardedDebugAllocatorState *state)
+{
+    if (!state)
+        return;
+
+    for (u32 i = 0; i < _X_DEBUG_SHARD_COUNT; ++i)
+        debug_allocator_deinit(&state->shards[i].state);
+}
+
+/**
+ * @brief Creates a thread-safe debug allocator. Allocations are tracked in one
+ * of 16 tables picked by pointer hash, each guarded by its own spinlock, so
+ * threads only contend when they touch the same shard.
+ *
+ * `wrappedAllocator` must be thread-safe. Call-site tracking and sampling are
+ * not available in this variant. Shards are cache-line aligned, so a heap
+ * allocated `state` should come from `allocator_alloc_aligned()` with 64.
+ *
+ * ```c
+ * ShardedDebugAllocatorState state;
+ * ResAllocator dbgAllocRes = debug_allocator_sharded(&state, 1024, default_allocator());
+ * if (dbgAllocRes.isErr) // Error!
+ * // Share the allocator between threads
+ * DebugAllocatorState stats = debug_allocator_sharded_stats(&state);
+ * debug_allocator_sharded_deinit(&state);
+ * ```
+ *
+ * @param state
+ * @param requestedCapacity initial capacity of all tables combined
+ * @param wrappedAllocator
+ * @return ResAllocator
+ * @exception ERR_INVALID_PARAMETER, ERR_OUT_OF_MEMORY
+ */
+static inline result_type(Allocator) debug_allocator_sharded(ShardedDebugAllocatorState *state, u32 requestedCapacity, Allocator *wrappedAllocator)
+{
+    if (!state || !wrappedAllocator)
+        return result_err(Allocator, X_ERR_EXT("alloc_debug_sharded", "debug_allocator_sharded", ERR_INVALID_PARAMETER, "null arg"));
+
+    state->targetAllocator = wrappedAllocator;
+
+    for (u32 i = 0; i < _X_DEBUG_SHARD_COUNT; ++i)
+    {
+        _DebugAllocatorShard *shard = &state->shards[i];
+        shard->lock = false;
+
+        ResAllocator res = debug_allocator(&shard->state, requestedCapacity / _X_DEBUG_SHARD_COUNT, wrappedAllocator);
+        if (res.isErr)
+        {
+            for (u32 j = 0; j < i; ++j)
+                debug_allocator_deinit(&state->shards[j].state);
+
+            return result_err(Allocator, X_ERR_EXT("alloc_debug_sharded", "debug_allocator_sharded", ERR_OUT_OF_MEMORY, "alloc failure"));
+        }
+    }
+
+    Allocator a = {
+        ._internalState = state,
+        .alloc = _debug_sharded_alloc,
+        .realloc = _debug_sharded_realloc,
+        .free = _debug_sharded_free,
+        .alloc_aligned = _debug_sharded_alloc_aligned,
+        .free_aligned = _debug_sharded_free_aligned,
+        .usable_size = _debug_sharded_usable_size,
+        .free_sized = _debug_sharded_free_sized,
+    };
+    return result_ok(Allocator, a);
+}
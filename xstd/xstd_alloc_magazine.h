@@ -0,0 +1,378 @@
+#pragma once
+
+#include "xstd_core.h"
+#include "xstd_result.h"
+#include "xstd_alloc.h"
+#include "xstd_alloc_default.h"
+#include "xstd_mem.h"
+
+#if defined(_MSC_VER)
+    #define _X_THREAD_LOCAL __declspec(thread)
+#else
+    #define _X_THREAD_LOCAL __thread
+#endif
+
+#define _X_MAGAZINE_CLASS_GRANULARITY 16u
+#define _X_MAGAZINE_CLASS_COUNT 32u
+#define _X_MAGAZINE_MAX_SMALL_SIZE (_X_MAGAZINE_CLASS_GRANULARITY * _X_MAGAZINE_CLASS_COUNT)
+#define _X_MAGAZINE_CAPACITY 32u
+#define _X_MAGAZINE_BATCH (_X_MAGAZINE_CAPACITY / 2)
+#define _X_MAGAZINE_LARGE_CLASS 0xFFFFFFFFu
+#define _X_MAGAZINE_ALIGNED_CLASS 0xFFFFFFFEu
+
+// Placed right before every block returned by the magazine allocator
+typedef struct _magazine_object_header
+{
+    u32 classIdx;    // size class of the block, _X_MAGAZINE_LARGE_CLASS or _X_MAGAZINE_ALIGNED_CLASS if not cached
+    u32 alignOffset; // for _X_MAGAZINE_ALIGNED_CLASS, distance from the parent's block
+    u64 size;        // usable size of the block
+} _MagazineObjectHeader;
+
+// Cached free blocks of one size class, used as a stack
+typedef struct _magazine
+{
+    u32 count;
+    _MagazineObjectHeader *blocks[_X_MAGAZINE_CAPACITY];
+} _Magazine;
+
+// MagazineAllocator State, one per thread
+typedef struct _magazine_allocator_state
+{
+    Allocator *parentAllocator;
+    _Magazine magazines[_X_MAGAZINE_CLASS_COUNT];
+    u64 hits;   // allocations served from a magazine
+    u64 misses; // allocations that refilled a magazine from the parent
+} MagazineAllocatorState;
+
+#define _X_MAGAZINE_OBJECT_HEADER_SIZE ((u64)sizeof(_MagazineObjectHeader))
+
+static inline u32 _magazine_class_index(u64 size)
+{
+    return (u32)((size + _X_MAGAZINE_CLASS_GRANULARITY - 1) / _X_MAGAZINE_CLASS_GRANULARITY) - 1u;
+}
+
+static inline u64 _magazine_class_size(u32 classIdx)
+{
+    return (u64)(classIdx + 1u) * _X_MAGAZINE_CLASS_GRANULARITY;
+}
+
+static inline _MagazineObjectHeader *_magazine_header_from_block(void *block)
+{
+    return ((_MagazineObjectHeader *)block) - 1;
+}
+
+// Takes up to _X_MAGAZINE_BATCH blocks of a class from the parent in one batch
+static inline Bool _magazine_refill(MagazineAllocatorState *state, u32 classIdx)
+{
+    Allocator *parent = state->parentAllocator;
+    _Magazine *mag = &state->magazines[classIdx];
+    u64 size = _magazine_class_size(classIdx);
+    u32 missing = mag->count < _X_MAGAZINE_BATCH ? _X_MAGAZINE_BATCH - mag->count : 0;
+    void *blocks[_X_MAGAZINE_BATCH];
+
+    if (missing > 0 && allocator_alloc_batch(parent, size + _X_MAGAZINE_OBJECT_HEADER_SIZE, missing, blocks))
+    {
+        for (u32 i = 0; i < missing; ++i)
+        {
+            _MagazineObjectHeader *header = (_MagazineObjectHeader *)blocks[i];
+            header->classIdx = classIdx;
+            header->size = size;
+            mag->blocks[mag->count++] = header;
+        }
+        return true;
+    }
+
+    // Parent is short on memory, takes what it can still provide
+    while (mag->count < _X_MAGAZINE_BATCH)
+    {
+        _MagazineObjectHeader *header = (_MagazineObjectHeader *)parent->alloc(parent, size + _X_MAGAZINE_OBJECT_HEADER_SIZE);
+        if (!header)
+            break;
+
+        header->classIdx = classIdx;
+        header->size = size;
+        mag->blocks[mag->count++] = header;
+    }
+
+    return mag->count > 0;
+}
+
+// Returns the `count` oldest blocks of a magazine to the parent
+static inline void _magazine_flush(MagazineAllocatorState *state, _Magazine *mag, u32 count)
+{
+    Allocator *parent = state->parentAllocator;
+
+    if (count > mag->count)
+        count = mag->count;
+
+    void *blocks[_X_MAGAZINE_CAPACITY];
+    for (u32 i = 0; i < count; ++i)
+        blocks[i] = mag->blocks[i];
+    allocator_free_batch(parent, blocks, count);
+
+    // Most recently freed blocks are the most likely to be in cache, kept on top
+    for (u32 i = count; i < mag->count; ++i)
+        mag->blocks[i - count] = mag->blocks[i];
+
+    mag->count -= count;
+}
+
+static void *_magazine_alloc_large(MagazineAllocatorState *state, u64 size)
+{
+    if (size > ((u64)-1) - _X_MAGAZINE_OBJECT_HEADER_SIZE)
+        return NULL;
+
+    Allocator *parent = state->parentAllocator;
+    _MagazineObjectHeader *header = (_MagazineObjectHeader *)parent->alloc(parent, size + _X_MAGAZINE_OBJECT_HEADER_SIZE);
+    if (!header)
+        return NULL;
+
+    header->classIdx = _X_MAGAZINE_LARGE_CLASS;
+    header->size = size;
+    return header + 1;
+}
+
+static void *_magazine_alloc(Allocator *a, u64 size)
+{
+    if (!a || !a->_internalState || size == 0)
+        return NULL;
+
+    MagazineAllocatorState *state = (MagazineAllocatorState *)a->_internalState;
+
+    if (size > _X_MAGAZINE_MAX_SMALL_SIZE)
+        return _magazine_alloc_large(state, size);
+
+    u32 classIdx = _magazine_class_index(size);
+    _Magazine *mag = &state->magazines[classIdx];
+
+    if (mag->count == 0)
+    {
+        state->misses += 1;
+        if (!_magazine_refill(state, classIdx))
+            return NULL;
+    }
+    else
+    {
+        state->hits += 1;
+    }
+
+    return mag->blocks[--mag->count] + 1;
+}
+
+static void _magazine_free(Allocator *a, void *block)
+{
+    if (!a || !a->_internalState || !block)
+        return;
+
+    MagazineAllocatorState *state = (MagazineAllocatorState *)a->_internalState;
+    Allocator *parent = state->parentAllocator;
+    _MagazineObjectHeader *header = _magazine_header_from_block(block);
+
+    if (header->classIdx == _X_MAGAZINE_LARGE_CLASS)
+    {
+        parent->free(parent, header);
+        return;
+    }
+
+    if (header->classIdx == _X_MAGAZINE_ALIGNED_CLASS)
+    {
+        allocator_free_aligned(parent, (i8 *)block - header->alignOffset);
+        return;
+    }
+
+    _Magazine *mag = &state->magazines[header->classIdx];
+    if (mag->count == _X_MAGAZINE_CAPACITY)
+        _magazine_flush(state, mag, _X_MAGAZINE_BATCH);
+
+    mag->blocks[mag->count++] = header;
+}
+
+static void *_magazine_alloc_aligned(Allocator *a, u64 size, u64 alignment)
+{
+    if (!a || !a->_internalState || size == 0 || !_allocator_is_pow2(alignment))
+        return NULL;
+
+    // Every cached block keeps the parent's alignment past a 16 bytes header
+    if (alignment <= _X_MAGAZINE_CLASS_GRANULARITY)
+        return _magazine_alloc(a, size);
+
+    MagazineAllocatorState *state = (MagazineAllocatorState *)a->_internalState;
+    Allocator *parent = state->parentAllocator;
+
+    if (alignment > 0x80000000u || size > ((u64)-1) - alignment)
+        return NULL;
+
+    // Whole alignment unit in front of the block holds its header
+    i8 *raw = (i8 *)allocator_alloc_aligned(parent, size + alignment, alignment);
+    if (!raw)
+        return NULL;
+
+    i8 *block = raw + alignment;
+    _MagazineObjectHeader *header = _magazine_header_from_block(block);
+    header->classIdx = _X_MAGAZINE_ALIGNED_CLASS;
+    header->alignOffset = (u32)alignment;
+    header->size = size;
+    return block;
+}
+
+static void *_magazine_realloc(Allocator *a, void *block, u64 newSize)
+{
+    if (!a || !a->_internalState)
+        return NULL;
+
+    if (!block)
+        return _magazine_alloc(a, newSize);
+
+    if (newSize == 0)
+    {
+        _magazine_free(a, block);
+        return NULL;
+    }
+
+    MagazineAllocatorState *state = (MagazineAllocatorState *)a->_internalState;
+    _MagazineObjectHeader *header = _magazine_header_from_block(block);
+
+    if (header->classIdx == _X_MAGAZINE_LARGE_CLASS && newSize > _X_MAGAZINE_MAX_SMALL_SIZE)
+    {
+        if (newSize > ((u64)-1) - _X_MAGAZINE_OBJECT_HEADER_SIZE)
+            return NULL;
+
+        Allocator *parent = state->parentAllocator;
+        _MagazineObjectHeader *newHeader = (_MagazineObjectHeader *)parent->realloc(parent, header, newSize + _X_MAGAZINE_OBJECT_HEADER_SIZE);
+        if (!newHeader)
+            return NULL;
+
+        newHeader->size = newSize;
+        return newHeader + 1;
+    }
+
+    if (newSize <= header->size && header->classIdx != _X_MAGAZINE_LARGE_CLASS)
+        return block;
+
+    void *newBlock = _magazine_alloc(a, newSize);
+    if (!newBlock)
+        return NULL;
+
+    mem_copy(newBlock, block, header->size < newSize ? header->size : newSize);
+    _magazine_free(a, block);
+    return newBlock;
+}
+
+static u64 _magazine_usable_size(Allocator *a, void *block)
+{
+    (void)a;
+    return _magazine_header_from_block(block)->size;
+}
+
+/**
+ * @brief Returns every block cached by the magazine allocator to the parent allocator.
+ *
+ * Must be called before a thread exits, or before the parent allocator is
+ * released, otherwise the cached blocks leak.
+ *
+ * @param magazine
+ */
+static inline void magazine_allocator_flush(Allocator *magazine)
+{
+    if (!magazine || !magazine->_internalState)
+        return;
+
+    MagazineAllocatorState *state = (MagazineAllocatorState *)magazine->_internalState;
+
+    for (u32 i = 0; i < _X_MAGAZINE_CLASS_COUNT; ++i)
+        _magazine_flush(state, &state->magazines[i], state->magazines[i].count);
+}
+
+/**
+ * @brief Creates a caching front-end over `parentAllocator`. Frees of up to 512
+ * bytes are kept in per-size-class magazines and handed back by the next
+ * allocations of the same class, without calling the parent.
+ *
+ * Magazines are refilled from and flushed to the parent in batches of 16 blocks.
+ * The state is not thread-safe: give each thread its own, over a thread-safe
+ * parent. Blocks may be freed by a different thread than the one that allocated them.
+ *
+ * ```c
+ * MagazineAllocatorState state;
+ * ResAllocator magRes = magazine_allocator(&state, default_allocator());
+ * if (magRes.isErr) // Error!
+ * Allocator mag = magRes.value;
+ * // Do stuff with mag
+ * magazine_allocator_flush(&mag);
+ * ```
+ *
+ * @param state must outlive the allocator
+ * @param parentAllocator must outlive the allocator
+ * @return Allocator
+ * @exception ERR_INVALID_PARAMETER
+ */
+static inline result_type(Allocator) magazine_allocator(MagazineAllocatorState *state, Allocator *parentAllocator)
+{
+    if (!state || !parentAllocator)
+        return result_err(Allocator, X_ERR_EXT("alloc_magazine", "magazine_allocator", ERR_INVALID_PARAMETER, "null arg"));
+
+    state->parentAllocator = parentAllocator;
+    state->hits = 0;
+    state->misses = 0;
+
+    for (u32 i = 0; i < _X_MAGAZINE_CLASS_COUNT; ++i)
+        state->magazines[i].count = 0;
+
+    Allocator a = {
+        ._internalState = state,
+        .alloc = _magazine_alloc,
+        .realloc = _magazine_realloc,
+        .free = _magazine_free,
+        .alloc_aligned = _magazine_alloc_aligned,
+        .free_aligned = _magazine_free,
+        .usable_size = _magazine_usable_size,
+        .free_sized = NULL,
+    };
+    return result_ok(Allocator, a);
+}
+
+typedef struct
+{
+    Bool initialized;
+    MagazineAllocatorState state;
+    Allocator allocator;
+} _magazine_thread_cache_t;
+
+static _X_THREAD_LOCAL _magazine_thread_cache_t _magazine_thread_cache;
+
+// DO NOT REMOVE
+// Prevents compiler errors on GCC since magazine_default_allocator() may not be used
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+
+/**
+ * @brief Returns the calling thread's magazine allocator over `default_allocator()`,
+ * created on first use.
+ *
+ * ```c
+ * Allocator *a = magazine_default_allocator();
+ * ResList listRes = ListInitT(u64, a);
+ * // Before the thread exits
+ * magazine_allocator_flush(a);
+ * ```
+ *
+ * IMPORTANT: Blocks are only valid with this allocator or another thread's
+ * `magazine_default_allocator()`.
+ *
+ * @return Allocator*
+ */
+static inline Allocator *magazine_default_allocator(void)
+{
+    _magazine_thread_cache_t *cache = &_magazine_thread_cache;
+
+    if (!cache->initialized)
+    {
+        cache->allocator = magazine_allocator(&cache->state, default_allocator()).value;
+        cache->initialized = true;
+    }
+
+    return &cache->allocator;
+}
+
+// DO NOT REMOVE
+#pragma GCC diagnostic pop
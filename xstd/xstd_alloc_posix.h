@@ -1,5 +1,9 @@
 #pragma once
 
+// Page allocator over mmap. Requires mmap and madvise (define _DEFAULT_SOURCE
+// or _GNU_SOURCE before including system headers). On Linux, realloc resizes
+// mappings with mremap when _GNU_SOURCE is defined, and copies otherwise.
+
 #include "xstd_alloc.h"
 
 #include "sys/mman.h"
@@ -9,9 +13,77 @@
 #define MAP_ANONYMOUS MAP_ANON
 #endif
 
+// Optional mapping flags, ignored on systems without them
+#ifdef MAP_POPULATE
+#define _X_POSIX_MAP_POPULATE MAP_POPULATE
+#else
+#define _X_POSIX_MAP_POPULATE 0
+#endif
+
+#ifdef MAP_NORESERVE
+#define _X_POSIX_MAP_NORESERVE MAP_NORESERVE
+#else
+#define _X_POSIX_MAP_NORESERVE 0
+#endif
+
+#define _X_POSIX_HUGE_PAGE_SIZE ((u64)2 * 1024 * 1024)
+
+// Configuration of `_posix_allocator`, see `posix_allocator_configure()`
+typedef struct _posix_allocator_config
+{
+    u64 hugePageThreshold; // mappings at least this large are 2MiB aligned and advised MADV_HUGEPAGE, 0 to disable
+    Bool populate;         // prefault new mappings with MAP_POPULATE
+    Bool noReserve;        // map with MAP_NORESERVE, no swap is reserved for sparse mappings
+} PosixAllocatorConfig;
+
+// Counters of the paths taken by `_posix_allocator`, see `posix_allocator_stats()`
+typedef struct _posix_allocator_stats
+{
+    u64 cacheHits;       // allocations served from the page-run cache
+    u64 cacheMisses;     // cacheable allocations that needed a new mapping
+    u64 mmapCalls;       // new mappings requested from the kernel
+    u64 hugePageAllocs;  // mappings that took the huge page path
+    u64 populatedAllocs; // mappings made with MAP_POPULATE
+    u64 noReserveAllocs; // mappings made with MAP_NORESERVE
+    u64 trimCount;       // times cached pages were released with madvise
+    u64 cachedBytes;
+    u64 residentCachedBytes;
+} PosixAllocatorStats;
+
+// Freed mappings of up to _X_POSIX_CACHE_BIN_COUNT pages are kept in per
+// page-count bins and reused before asking the kernel for new ones.
+#define _X_POSIX_CACHE_BIN_COUNT 64u
+#define _X_POSIX_CACHE_DEFAULT_MAX_BYTES ((u64)64 * 1024 * 1024)
+#define _X_POSIX_CACHE_DEFAULT_HIGH_WATER ((u64)16 * 1024 * 1024)
+
+// Placed at the start of a cached mapping
+typedef struct _posix_cached_run
+{
+    struct _posix_cached_run *next;
+    u64 mapping_size;
+    Bool resident; // false once the pages have been released with madvise
+} _posix_cached_run_t;
+
 typedef struct
 {
     u64 pageSize;
+    volatile Bool lock;
+
+    _posix_cached_run_t *bins[_X_POSIX_CACHE_BIN_COUNT];
+    u64 cachedBytes;         // bytes of address space held in the cache
+    u64 residentCachedBytes; // cached bytes still backed by physical memory
+    u64 maxCachedBytes;      // mappings are unmapped once the cache holds this much
+    u64 highWaterBytes;      // resident cached bytes above which pages are released
+
+    PosixAllocatorConfig config;
+
+    u64 cacheHits;
+    u64 cacheMisses;
+    u64 trimCount;
+    u64 mmapCalls;
+    u64 hugePageAllocs;
+    u64 populatedAllocs;
+    u64 noReserveAllocs;
 } _posix_alloc_state_t;
 
 typedef struct
@@ -22,8 +94,37 @@ typedef struct
 
 static _posix_alloc_state_t _posix_alloc_state = {
     .pageSize = 0,
+    .lock = false,
+    .cachedBytes = 0,
+    .residentCachedBytes = 0,
+    .maxCachedBytes = _X_POSIX_CACHE_DEFAULT_MAX_BYTES,
+    .highWaterBytes = _X_POSIX_CACHE_DEFAULT_HIGH_WATER,
+    .config = {
+        .hugePageThreshold = 0,
+        .populate = false,
+        .noReserve = false,
+    },
+    .cacheHits = 0,
+    .cacheMisses = 0,
+    .trimCount = 0,
+    .mmapCalls = 0,
+    .hugePageAllocs = 0,
+    .populatedAllocs = 0,
+    .noReserveAllocs = 0,
 };
 
+static void _posix_lock(void)
+{
+    while (__atomic_test_and_set(&_posix_alloc_state.lock, __ATOMIC_ACQUIRE))
+    {
+    }
+}
+
+static void _posix_unlock(void)
+{
+    __atomic_clear(&_posix_alloc_state.lock, __ATOMIC_RELEASE);
+}
+
 static u64 _posix_align_up(u64 value, u64 alignment)
 {
     if (alignment == 0)
@@ -60,6 +161,13 @@ static _posix_alloc_header_t *_posix_header_from_block(void *block)
     return ((_posix_alloc_header_t *)block) - 1;
 }
 
+// Mappings start at the page holding the header, which is only past the
+// start of the page for blocks from `_posix_alloc_aligned`.
+static void *_posix_mapping_base(_posix_alloc_header_t *header)
+{
+    return (void *)((uPtr)header & ~(uPtr)(_posix_get_page_size() - 1));
+}
+
 static void _posix_copy_memory(void *dst, const void *src, u64 size)
 {
     u8 *d = (u8 *)dst;
@@ -76,11 +184,192 @@ static u64 _posix_min_u64(u64 a, u64 b)
     return (a < b) ? a : b;
 }
 
+// Releases the physical pages of every cached run, keeping the address space.
+// Must be called with the lock held.
+static void _posix_cache_trim_locked(void)
+{
+    for (u32 i = 0; i < _X_POSIX_CACHE_BIN_COUNT; ++i)
+    {
+        for (_posix_cached_run_t *run = _posix_alloc_state.bins[i]; run; run = run->next)
+        {
+            if (!run->resident)
+            {
+                continue;
+            }
+
+            // Keep the first page, it holds the run's links
+            u64 pageSize = _posix_alloc_state.pageSize;
+            if (run->mapping_size > pageSize)
+            {
+#if defined(MADV_DONTNEED)
+                madvise((i8 *)run + pageSize, run->mapping_size - pageSize, MADV_DONTNEED);
+#else
+                posix_madvise((i8 *)run + pageSize, run->mapping_size - pageSize, POSIX_MADV_DONTNEED);
+#endif
+            }
+
+            run->resident = false;
+        }
+    }
+
+    _posix_alloc_state.residentCachedBytes = 0;
+    _posix_alloc_state.trimCount += 1;
+}
+
+static void *_posix_cache_take(u64 mappingSize)
+{
+    u64 pages = mappingSize / _posix_get_page_size();
+    if (pages > _X_POSIX_CACHE_BIN_COUNT)
+    {
+        return NULL;
+    }
+
+    _posix_lock();
+
+    _posix_cached_run_t *run = _posix_alloc_state.bins[pages - 1];
+    if (run)
+    {
+        _posix_alloc_state.bins[pages - 1] = run->next;
+        _posix_alloc_state.cachedBytes -= mappingSize;
+        if (run->resident)
+        {
+            _posix_alloc_state.residentCachedBytes -= mappingSize;
+        }
+        _posix_alloc_state.cacheHits += 1;
+    }
+    else
+    {
+        _posix_alloc_state.cacheMisses += 1;
+    }
+
+    _posix_unlock();
+    return (void *)run;
+}
+
+// Caches the mapping if there is room for it, unmaps it otherwise
+static void _posix_release_mapping(void *base, u64 mappingSize)
+{
+    u64 pages = mappingSize / _posix_get_page_size();
+
+    if (pages <= _X_POSIX_CACHE_BIN_COUNT)
+    {
+        _posix_lock();
+
+        if (_posix_alloc_state.cachedBytes + mappingSize <= _posix_alloc_state.maxCachedBytes)
+        {
+            _posix_cached_run_t *run = (_posix_cached_run_t *)base;
+            run->next = _posix_alloc_state.bins[pages - 1];
+            run->mapping_size = mappingSize;
+            run->resident = true;
+            _posix_alloc_state.bins[pages - 1] = run;
+
+            _posix_alloc_state.cachedBytes += mappingSize;
+            _posix_alloc_state.residentCachedBytes += mappingSize;
+
+            if (_posix_alloc_state.residentCachedBytes > _posix_alloc_state.highWaterBytes)
+            {
+                _posix_cache_trim_locked();
+            }
+
+            _posix_unlock();
+            return;
+        }
+
+        _posix_unlock();
+    }
+
+    munmap(base, mappingSize);
+}
+
+static void _posix_count(u64 *counter)
+{
+    __atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+}
+
+// Maps `size` bytes (page multiple) starting at a multiple of `alignment`
+// (page multiple), honoring the configured mapping flags.
+static void *_posix_map(u64 size, u64 alignment)
+{
+    PosixAllocatorConfig config = _posix_alloc_state.config;
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+    if (config.populate && _X_POSIX_MAP_POPULATE)
+    {
+        flags |= _X_POSIX_MAP_POPULATE;
+        _posix_count(&_posix_alloc_state.populatedAllocs);
+    }
+
+    if (config.noReserve && _X_POSIX_MAP_NORESERVE)
+    {
+        flags |= _X_POSIX_MAP_NORESERVE;
+        _posix_count(&_posix_alloc_state.noReserveAllocs);
+    }
+
+    u64 pageSize = _posix_get_page_size();
+    u64 reserveSize = alignment > pageSize ? size + alignment : size;
+
+    // Slack is mapped without MAP_POPULATE, only the kept range is prefaulted
+    int reserveFlags = alignment > pageSize ? (flags & ~_X_POSIX_MAP_POPULATE) : flags;
+
+    void *base = mmap(NULL, reserveSize, PROT_READ | PROT_WRITE, reserveFlags, -1, 0);
+    _posix_count(&_posix_alloc_state.mmapCalls);
+    if (base == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    if (alignment <= pageSize)
+    {
+        return base;
+    }
+
+    uPtr baseAddr = (uPtr)base;
+    uPtr alignedAddr = (uPtr)_allocator_align_up(baseAddr, alignment);
+
+    if (alignedAddr > baseAddr)
+    {
+        munmap(base, alignedAddr - baseAddr);
+    }
+
+    if (baseAddr + reserveSize > alignedAddr + size)
+    {
+        munmap((void *)(alignedAddr + size), baseAddr + reserveSize - (alignedAddr + size));
+    }
+
+    // Prefault the kept range by hand, writing zeroes to fresh pages is a no-op
+    if (flags & _X_POSIX_MAP_POPULATE)
+    {
+        for (u64 offset = 0; offset < size; offset += pageSize)
+        {
+            ((volatile u8 *)alignedAddr)[offset] = 0;
+        }
+    }
+
+    return (void *)alignedAddr;
+}
+
+// `mappingSize` must be a multiple of _X_POSIX_HUGE_PAGE_SIZE
+static void *_posix_map_huge(u64 mappingSize)
+{
+    void *base = _posix_map(mappingSize, _X_POSIX_HUGE_PAGE_SIZE);
+    if (base == NULL)
+    {
+        return NULL;
+    }
+
+#ifdef MADV_HUGEPAGE
+    madvise(base, mappingSize, MADV_HUGEPAGE);
+#endif
+
+    _posix_count(&_posix_alloc_state.hugePageAllocs);
+    return base;
+}
+
 static void *_posix_alloc(Allocator *a, u64 size)
 {
     (void)a;
 
-    if (size == 0)
+    if (size == 0 || size > ((u64)-1) - sizeof(_posix_alloc_header_t) - _posix_get_page_size())
     {
         return NULL;
     }
@@ -88,9 +377,24 @@ static void *_posix_alloc(Allocator *a, u64 size)
     u64 pageSize = _posix_get_page_size();
     u64 totalSize = sizeof(_posix_alloc_header_t) + size;
     u64 mappingSize = _posix_align_up(totalSize, pageSize);
+    u64 hugeThreshold = _posix_alloc_state.config.hugePageThreshold;
 
-    void *base = mmap(NULL, mappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-    if (base == MAP_FAILED)
+    void *base = NULL;
+    if (hugeThreshold != 0 && mappingSize >= hugeThreshold && size <= ((u64)-1) - 2 * _X_POSIX_HUGE_PAGE_SIZE)
+    {
+        mappingSize = _posix_align_up(mappingSize, _X_POSIX_HUGE_PAGE_SIZE);
+        base = _posix_map_huge(mappingSize);
+    }
+    else
+    {
+        base = _posix_cache_take(mappingSize);
+        if (base == NULL)
+        {
+            base = _posix_map(mappingSize, pageSize);
+        }
+    }
+
+    if (base == NULL)
     {
         return NULL;
     }
@@ -114,7 +418,7 @@ static void *_posix_realloc(Allocator *a, void *block, u64 newSize)
     if (newSize == 0)
     {
         _posix_alloc_header_t *header = _posix_header_from_block(block);
-        munmap((void *)header, header->mapping_size);
+        _posix_release_mapping(_posix_mapping_base(header), header->mapping_size);
         return NULL;
     }
 
@@ -122,22 +426,34 @@ static void *_posix_realloc(Allocator *a, void *block, u64 newSize)
     u64 pageSize = _posix_get_page_size();
     u64 totalSize = sizeof(_posix_alloc_header_t) + newSize;
     u64 newMappingSize = _posix_align_up(totalSize, pageSize);
+    u64 hugeThreshold = _posix_alloc_state.config.hugePageThreshold;
+    Bool huge = hugeThreshold != 0 && newMappingSize >= hugeThreshold && newSize <= ((u64)-1) - 2 * _X_POSIX_HUGE_PAGE_SIZE;
+    Bool atBase = _posix_mapping_base(oldHeader) == (void *)oldHeader;
+
+    if (huge)
+    {
+        newMappingSize = _posix_align_up(newMappingSize, _X_POSIX_HUGE_PAGE_SIZE);
+    }
 
-#ifdef _linux__
-    if (newMappingSize == oldHeader->mapping_size)
+    if (newMappingSize == oldHeader->mapping_size && atBase)
     {
         oldHeader->request_size = newSize;
         return block;
     }
 
-    void *base = (void *)oldHeader;
-    void *remapped = mremap(base, oldHeader->mapping_size, newMappingSize, MREMAP_MAYMOVE);
-    if (remapped != MAP_FAILED)
+    // mremap may move the mapping to any page boundary, so huge page mappings
+    // take the copy path to stay 2MiB aligned. MREMAP_MAYMOVE needs _GNU_SOURCE.
+#if defined(__linux__) && defined(MREMAP_MAYMOVE)
+    if (!huge && atBase)
     {
-        _posix_alloc_header_t *newHeader = (_posix_alloc_header_t *)remapped;
-        newHeader->request_size = newSize;
-        newHeader->mapping_size = newMappingSize;
-        return (void *)(newHeader + 1);
+        void *remapped = mremap((void *)oldHeader, oldHeader->mapping_size, newMappingSize, MREMAP_MAYMOVE);
+        if (remapped != MAP_FAILED)
+        {
+            _posix_alloc_header_t *newHeader = (_posix_alloc_header_t *)remapped;
+            newHeader->request_size = newSize;
+            newHeader->mapping_size = newMappingSize;
+            return (void *)(newHeader + 1);
+        }
     }
 #endif
 
@@ -153,7 +469,7 @@ static void *_posix_realloc(Allocator *a, void *block, u64 newSize)
         _posix_copy_memory(newBlock, block, copySize);
     }
 
-    munmap((void *)oldHeader, oldHeader->mapping_size);
+    _posix_release_mapping(_posix_mapping_base(oldHeader), oldHeader->mapping_size);
 
     return newBlock;
 }
@@ -168,7 +484,65 @@ static void _posix_free(Allocator *a, void *block)
     }
 
     _posix_alloc_header_t *header = _posix_header_from_block(block);
-    munmap((void *)header, header->mapping_size);
+    _posix_release_mapping(_posix_mapping_base(header), header->mapping_size);
+}
+
+static void *_posix_alloc_aligned(Allocator *a, u64 size, u64 alignment)
+{
+    if (size == 0 || !_allocator_is_pow2(alignment))
+    {
+        return NULL;
+    }
+
+    if (alignment <= sizeof(_posix_alloc_header_t))
+    {
+        return _posix_alloc(a, size);
+    }
+
+    u64 pageSize = _posix_get_page_size();
+    if (size > ((u64)-1) - alignment - sizeof(_posix_alloc_header_t) - pageSize)
+    {
+        return NULL;
+    }
+
+    // Map enough to slide the block up to the alignment, then unmap the slack
+    u64 reserveSize = _posix_align_up(sizeof(_posix_alloc_header_t) + size + alignment, pageSize);
+
+    void *base = _posix_map(reserveSize, pageSize);
+    if (base == NULL)
+    {
+        return NULL;
+    }
+
+    uPtr baseAddr = (uPtr)base;
+    uPtr blockAddr = (uPtr)_allocator_align_up(baseAddr + sizeof(_posix_alloc_header_t), alignment);
+    uPtr mapStart = (blockAddr - sizeof(_posix_alloc_header_t)) & ~(uPtr)(pageSize - 1);
+    uPtr mapEnd = (uPtr)_posix_align_up(blockAddr + size, pageSize);
+
+    if (mapStart > baseAddr)
+    {
+        munmap(base, mapStart - baseAddr);
+    }
+
+    if (baseAddr + reserveSize > mapEnd)
+    {
+        munmap((void *)mapEnd, baseAddr + reserveSize - mapEnd);
+    }
+
+    _posix_alloc_header_t *header = _posix_header_from_block((void *)blockAddr);
+    header->request_size = size;
+    header->mapping_size = mapEnd - mapStart;
+
+    return (void *)blockAddr;
+}
+
+static u64 _posix_usable_size(Allocator *a, void *block)
+{
+    (void)a;
+
+    _posix_alloc_header_t *header = _posix_header_from_block(block);
+    uPtr mappingEnd = (uPtr)_posix_mapping_base(header) + header->mapping_size;
+    return (u64)(mappingEnd - (uPtr)block);
 }
 
 static Allocator _posix_allocator = {
@@ -176,4 +550,105 @@ static Allocator _posix_allocator = {
     .alloc = &_posix_alloc,
     .realloc = &_posix_realloc,
     .free = &_posix_free,
+    .alloc_aligned = &_posix_alloc_aligned,
+    .free_aligned = &_posix_free,
+    .usable_size = &_posix_usable_size,
+    .free_sized = NULL,
 };
+
+/**
+ * @brief Sets the limits of the page-run cache of `_posix_allocator`.
+ *
+ * Freed mappings of up to 64 pages are cached and reused by later allocations
+ * of the same page count. Once the cache holds `maxCachedBytes`, freed mappings
+ * are unmapped instead. Once more than `highWaterBytes` of cached memory is
+ * still resident, the physical pages of cached mappings are released with
+ * `madvise(MADV_DONTNEED)`, keeping the address space for reuse.
+ *
+ * Passing 0 as `maxCachedBytes` disables the cache.
+ *
+ * @param maxCachedBytes
+ * @param highWaterBytes
+ */
+static inline void posix_allocator_set_cache_limits(u64 maxCachedBytes, u64 highWaterBytes)
+{
+    _posix_lock();
+    _posix_alloc_state.maxCachedBytes = maxCachedBytes;
+    _posix_alloc_state.highWaterBytes = highWaterBytes;
+    if (_posix_alloc_state.residentCachedBytes > highWaterBytes)
+    {
+        _posix_cache_trim_locked();
+    }
+    _posix_unlock();
+}
+
+/**
+ * @brief Unmaps every mapping held in the page-run cache of `_posix_allocator`.
+ */
+static inline void posix_allocator_release_cache(void)
+{
+    _posix_lock();
+
+    for (u32 i = 0; i < _X_POSIX_CACHE_BIN_COUNT; ++i)
+    {
+        _posix_cached_run_t *run = _posix_alloc_state.bins[i];
+        while (run)
+        {
+            _posix_cached_run_t *next = run->next;
+            munmap((void *)run, run->mapping_size);
+            run = next;
+        }
+        _posix_alloc_state.bins[i] = NULL;
+    }
+
+    _posix_alloc_state.cachedBytes = 0;
+    _posix_alloc_state.residentCachedBytes = 0;
+
+    _posix_unlock();
+}
+
+/**
+ * @brief Changes how `_posix_allocator` maps new memory.
+ *
+ * ```c
+ * posix_allocator_configure((PosixAllocatorConfig){
+ *     .hugePageThreshold = 4 * 1024 * 1024, // THP for mappings of 4MiB and more
+ *     .populate = true,                     // no first-touch page faults
+ *     .noReserve = false,
+ * });
+ * ```
+ *
+ * Only affects mappings made after the call. Flags unsupported by the system
+ * are ignored.
+ *
+ * @param config
+ */
+static inline void posix_allocator_configure(PosixAllocatorConfig config)
+{
+    _posix_lock();
+    _posix_alloc_state.config = config;
+    _posix_unlock();
+}
+
+/**
+ * @brief Returns counters of the paths taken by `_posix_allocator`.
+ *
+ * @return PosixAllocatorStats
+ */
+static inline PosixAllocatorStats posix_allocator_stats(void)
+{
+    _posix_lock();
+    PosixAllocatorStats stats = {
+        .cacheHits = _posix_alloc_state.cacheHits,
+        .cacheMisses = _posix_alloc_state.cacheMisses,
+        .mmapCalls = __atomic_load_n(&_posix_alloc_state.mmapCalls, __ATOMIC_RELAXED),
+        .hugePageAllocs = __atomic_load_n(&_posix_alloc_state.hugePageAllocs, __ATOMIC_RELAXED),
+        .populatedAllocs = __atomic_load_n(&_posix_alloc_state.populatedAllocs, __ATOMIC_RELAXED),
+        .noReserveAllocs = __atomic_load_n(&_posix_alloc_state.noReserveAllocs, __ATOMIC_RELAXED),
+        .trimCount = _posix_alloc_state.trimCount,
+        .cachedBytes = _posix_alloc_state.cachedBytes,
+        .residentCachedBytes = _posix_alloc_state.residentCachedBytes,
+    };
+    _posix_unlock();
+    return stats;
+}
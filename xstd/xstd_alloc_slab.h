@@ -0,0 +1,398 @@
+#pragma once
+
+#include "xstd_core.h"
+#include "xstd_result.h"
+#include "xstd_alloc.h"
+#include "xstd_mem.h"
+
+#define _X_SLAB_PAGE_SIZE 4096u
+#define _X_SLAB_CLASS_GRANULARITY 16u
+#define _X_SLAB_CLASS_COUNT 16u
+#define _X_SLAB_MAX_SMALL_SIZE (_X_SLAB_CLASS_GRANULARITY * _X_SLAB_CLASS_COUNT)
+#define _X_SLAB_LARGE_CLASS 0xFFFFFFFFu
+#define _X_SLAB_ALIGNED_CLASS 0xFFFFFFFEu
+
+// Placed right before every block returned by the slab allocator
+typedef struct _slab_object_header
+{
+    u32 classIdx;    // size class of the block, _X_SLAB_LARGE_CLASS or _X_SLAB_ALIGNED_CLASS if forwarded to parent
+    u32 alignOffset; // for _X_SLAB_ALIGNED_CLASS, distance from the parent's block
+    u64 size;        // usable size of the block
+} _SlabObjectHeader;
+
+// Placed at the start of every page taken from the parent allocator
+typedef struct _slab_page_header
+{
+    struct _slab_page_header *next;
+    u64 _reserved;
+} _SlabPageHeader;
+
+typedef struct _slab_free_node
+{
+    struct _slab_free_node *next;
+} _SlabFreeNode;
+
+typedef struct _slab_class
+{
+    _SlabFreeNode *freeList; // freed slots of this class, reused first
+    i8 *bumpPtr;             // next never-used slot in the current page
+    i8 *bumpEnd;             // end of the current page
+    u64 slotSize;            // header + usable size
+} _SlabClass;
+
+// SlabAllocator State
+typedef struct _slab_allocator_state
+{
+    Allocator *parentAllocator;
+    _SlabClass classes[_X_SLAB_CLASS_COUNT];
+    _SlabPageHeader *pages; // every page owned by the allocator
+    u64 pageCount;
+    u64 largeAllocCount;    // allocations currently forwarded to the parent
+} SlabAllocatorState;
+
+#define _X_SLAB_OBJECT_HEADER_SIZE ((u64)sizeof(_SlabObjectHeader))
+
+static inline u32 _slab_class_index(u64 size)
+{
+    return (u32)((size + _X_SLAB_CLASS_GRANULARITY - 1) / _X_SLAB_CLASS_GRANULARITY) - 1u;
+}
+
+static inline _SlabObjectHeader *_slab_header_from_block(void *block)
+{
+    return ((_SlabObjectHeader *)block) - 1;
+}
+
+static inline Bool _slab_class_refill(SlabAllocatorState *state, _SlabClass *cls)
+{
+    Allocator *parent = state->parentAllocator;
+    _SlabPageHeader *page = (_SlabPageHeader *)parent->alloc(parent, _X_SLAB_PAGE_SIZE);
+    if (!page)
+        return false;
+
+    page->next = state->pages;
+    state->pages = page;
+    state->pageCount += 1;
+
+    cls->bumpPtr = (i8 *)page + sizeof(_SlabPageHeader);
+    cls->bumpEnd = (i8 *)page + _X_SLAB_PAGE_SIZE;
+    return true;
+}
+
+static void *_slab_alloc_large(SlabAllocatorState *state, u64 size)
+{
+    if (size > ((u64)-1) - _X_SLAB_OBJECT_HEADER_SIZE)
+        return NULL;
+
+    Allocator *parent = state->parentAllocator;
+    _SlabObjectHeader *header = (_SlabObjectHeader *)parent->alloc(parent, size + _X_SLAB_OBJECT_HEADER_SIZE);
+    if (!header)
+        return NULL;
+
+    header->classIdx = _X_SLAB_LARGE_CLASS;
+    header->size = size;
+    state->largeAllocCount += 1;
+    return header + 1;
+}
+
+static void *_slab_alloc(Allocator *a, u64 size)
+{
+    if (!a || !a->_internalState || size == 0)
+        return NULL;
+
+    SlabAllocatorState *state = (SlabAllocatorState *)a->_internalState;
+
+    if (size > _X_SLAB_MAX_SMALL_SIZE)
+        return _slab_alloc_large(state, size);
+
+    u32 classIdx = _slab_class_index(size);
+    _SlabClass *cls = &state->classes[classIdx];
+    _SlabObjectHeader *header;
+
+    if (cls->freeList)
+    {
+        header = _slab_header_from_block(cls->freeList);
+        cls->freeList = cls->freeList->next;
+        return header + 1;
+    }
+
+    if ((u64)(cls->bumpEnd - cls->bumpPtr) < cls->slotSize)
+    {
+        if (!_slab_class_refill(state, cls))
+            return NULL;
+    }
+
+    header = (_SlabObjectHeader *)cls->bumpPtr;
+    cls->bumpPtr += cls->slotSize;
+
+    header->classIdx = classIdx;
+    header->size = cls->slotSize - _X_SLAB_OBJECT_HEADER_SIZE;
+    return header + 1;
+}
+
+static void _slab_free(Allocator *a, void *block)
+{
+    if (!a || !a->_internalState || !block)
+        return;
+
+    SlabAllocatorState *state = (SlabAllocatorState *)a->_internalState;
+    _SlabObjectHeader *header = _slab_header_from_block(block);
+
+    if (header->classIdx == _X_SLAB_LARGE_CLASS)
+    {
+        Allocator *parent = state->parentAllocator;
+        parent->free(parent, header);
+        state->largeAllocCount -= 1;
+        return;
+    }
+
+    if (header->classIdx == _X_SLAB_ALIGNED_CLASS)
+    {
+        Allocator *parent = state->parentAllocator;
+        allocator_free_aligned(parent, (i8 *)block - header->alignOffset);
+        state->largeAllocCount -= 1;
+        return;
+    }
+
+    _SlabClass *cls = &state->classes[header->classIdx];
+    _SlabFreeNode *node = (_SlabFreeNode *)block;
+    node->next = cls->freeList;
+    cls->freeList = node;
+}
+
+static void *_slab_alloc_aligned(Allocator *a, u64 size, u64 alignment)
+{
+    if (!a || !a->_internalState || size == 0 || !_allocator_is_pow2(alignment))
+        return NULL;
+
+    // Every slot is 16 bytes aligned
+    if (alignment <= _X_SLAB_CLASS_GRANULARITY)
+        return _slab_alloc(a, size);
+
+    SlabAllocatorState *state = (SlabAllocatorState *)a->_internalState;
+    Allocator *parent = state->parentAllocator;
+
+    if (alignment > 0x80000000u || size > ((u64)-1) - alignment)
+        return NULL;
+
+    // Whole alignment unit in front of the block holds its header
+    i8 *raw = (i8 *)allocator_alloc_aligned(parent, size + alignment, alignment);
+    if (!raw)
+        return NULL;
+
+    i8 *block = raw + alignment;
+    _SlabObjectHeader *header = _slab_header_from_block(block);
+    header->classIdx = _X_SLAB_ALIGNED_CLASS;
+    header->alignOffset = (u32)alignment;
+    header->size = size;
+
+    state->largeAllocCount += 1;
+    return block;
+}
+
+static void *_slab_realloc(Allocator *a, void *block, u64 newSize)
+{
+    if (!a || !a->_internalState)
+        return NULL;
+
+    if (!block)
+        return _slab_alloc(a, newSize);
+
+    if (newSize == 0)
+    {
+        _slab_free(a, block);
+        return NULL;
+    }
+
+    SlabAllocatorState *state = (SlabAllocatorState *)a->_internalState;
+    _SlabObjectHeader *header = _slab_header_from_block(block);
+
+    if (header->classIdx == _X_SLAB_LARGE_CLASS && newSize > _X_SLAB_MAX_SMALL_SIZE)
+    {
+        if (newSize > ((u64)-1) - _X_SLAB_OBJECT_HEADER_SIZE)
+            return NULL;
+
+        Allocator *parent = state->parentAllocator;
+        _SlabObjectHeader *newHeader = (_SlabObjectHeader *)parent->realloc(parent, header, newSize + _X_SLAB_OBJECT_HEADER_SIZE);
+        if (!newHeader)
+            return NULL;
+
+        newHeader->size = newSize;
+        return newHeader + 1;
+    }
+
+    if (newSize <= header->size && header->classIdx != _X_SLAB_LARGE_CLASS)
+        return block;
+
+    void *newBlock = _slab_alloc(a, newSize);
+    if (!newBlock)
+        return NULL;
+
+    mem_copy(newBlock, block, header->size < newSize ? header->size : newSize);
+    _slab_free(a, block);
+    return newBlock;
+}
+
+static void _slab_free_batch(Allocator *a, void **blocks, u64 count)
+{
+    for (u64 i = 0; i < count; ++i)
+        _slab_free(a, blocks[i]);
+}
+
+// Resolves the size class once for the whole group
+static Bool _slab_alloc_batch(Allocator *a, u64 size, u64 count, void **outPtrs)
+{
+    if (!a || !a->_internalState || size == 0)
+        return false;
+
+    SlabAllocatorState *state = (SlabAllocatorState *)a->_internalState;
+
+    if (size > _X_SLAB_MAX_SMALL_SIZE)
+    {
+        for (u64 i = 0; i < count; ++i)
+        {
+            outPtrs[i] = _slab_alloc_large(state, size);
+            if (!outPtrs[i])
+            {
+                _slab_free_batch(a, outPtrs, i);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    u32 classIdx = _slab_class_index(size);
+    _SlabClass *cls = &state->classes[classIdx];
+    u64 usableSize = cls->slotSize - _X_SLAB_OBJECT_HEADER_SIZE;
+
+    for (u64 i = 0; i < count; ++i)
+    {
+        if (cls->freeList)
+        {
+            outPtrs[i] = cls->freeList;
+            cls->freeList = cls->freeList->next;
+            continue;
+        }
+
+        if ((u64)(cls->bumpEnd - cls->bumpPtr) < cls->slotSize && !_slab_class_refill(state, cls))
+        {
+            _slab_free_batch(a, outPtrs, i);
+            return false;
+        }
+
+        _SlabObjectHeader *header = (_SlabObjectHeader *)cls->bumpPtr;
+        cls->bumpPtr += cls->slotSize;
+
+        header->classIdx = classIdx;
+        header->size = usableSize;
+        outPtrs[i] = header + 1;
+    }
+
+    return true;
+}
+
+static u64 _slab_usable_size(Allocator *a, void *block)
+{
+    (void)a;
+    return _slab_header_from_block(block)->size;
+}
+
+/**
+ * @brief Returns every page owned by the slab allocator to the parent allocator.
+ *
+ * Allocations larger than the biggest size class are forwarded to the parent
+ * allocator and must still be freed individually before this call.
+ *
+ * IMPORTANT: Invalidates all pointers to memory allocated from slab pages.
+ *
+ * @param slab
+ */
+static inline void slab_allocator_deinit(Allocator *slab)
+{
+    if (!slab || !slab->_internalState)
+        return;
+
+    SlabAllocatorState *state = (SlabAllocatorState *)slab->_internalState;
+    Allocator *parent = state->parentAllocator;
+    _SlabPageHeader *page = state->pages;
+
+    while (page)
+    {
+        _SlabPageHeader *next = page->next;
+        parent->free(parent, page);
+        page = next;
+    }
+
+    state->pages = NULL;
+    state->pageCount = 0;
+
+    for (u32 i = 0; i < _X_SLAB_CLASS_COUNT; ++i)
+    {
+        state->classes[i].freeList = NULL;
+        state->classes[i].bumpPtr = NULL;
+        state->classes[i].bumpEnd = NULL;
+    }
+}
+
+/**
+ * @brief Creates a slab allocator serving small allocations from per-size-class
+ * free lists, carved out of page-sized slabs taken from `parentAllocator`.
+ *
+ * Allocations up to 256 bytes are rounded up to a multiple of 16 and are
+ * allocated and freed in constant time. Bigger allocations are forwarded to
+ * `parentAllocator`.
+ *
+ * Well suited for containers allocating many small objects of the same size,
+ * like `HashMap` entries or `Json` nodes.
+ *
+ * ```c
+ * SlabAllocatorState state;
+ * ResAllocator slabRes = slab_allocator(&state, default_allocator());
+ * if (slabRes.isErr) // Error!
+ * Allocator slab = slabRes.value;
+ * ResHashMap mapRes = HashMapInitT(u64, &slab);
+ * // Do stuff with the map
+ * hashmap_deinit(&mapRes.value);
+ * slab_allocator_deinit(&slab);
+ * ```
+ *
+ * @param state must outlive the allocator
+ * @param parentAllocator allocator providing the pages, must outlive the allocator
+ * @return Allocator
+ * @exception ERR_INVALID_PARAMETER
+ */
+static inline result_type(Allocator) slab_allocator(SlabAllocatorState *state, Allocator *parentAllocator)
+{
+    if (!state || !parentAllocator)
+        return result_err(Allocator, X_ERR_EXT("alloc_slab", "slab_allocator", ERR_INVALID_PARAMETER, "null arg"));
+
+    *state = (SlabAllocatorState){
+        .parentAllocator = parentAllocator,
+        .pages = NULL,
+        .pageCount = 0,
+        .largeAllocCount = 0,
+    };
+
+    for (u32 i = 0; i < _X_SLAB_CLASS_COUNT; ++i)
+    {
+        state->classes[i] = (_SlabClass){
+            .freeList = NULL,
+            .bumpPtr = NULL,
+            .bumpEnd = NULL,
+            .slotSize = (u64)(i + 1u) * _X_SLAB_CLASS_GRANULARITY + _X_SLAB_OBJECT_HEADER_SIZE,
+        };
+    }
+
+    Allocator a = {
+        ._internalState = state,
+        .alloc = _slab_alloc,
+        .realloc = _slab_realloc,
+        .free = _slab_free,
+        .alloc_aligned = _slab_alloc_aligned,
+        .free_aligned = _slab_free,
+        .usable_size = _slab_usable_size,
+        .free_sized = NULL,
+        .alloc_batch = _slab_alloc_batch,
+        .free_batch = _slab_free_batch,
+    };
+    return result_ok(Allocator, a);
+}
@@ -6,6 +6,17 @@
 
 #include "stdlib.h"
 
+#if defined(__GLIBC__)
+    #include "malloc.h"
+#endif
+
+// C11 aligned_alloc is used when available, older standards over-allocate
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !_X_PLAT_WIN
+    #define _X_C_ALLOC_HAS_ALIGNED_ALLOC 1
+#else
+    #define _X_C_ALLOC_HAS_ALIGNED_ALLOC 0
+#endif
+
 static void *_c_alloc_malloc(Allocator *a, u64 size)
 {
     (void)a;
@@ -24,9 +35,81 @@ static void _c_alloc_free(Allocator *a, void *block)
     free(block);
 }
 
+static void *_c_alloc_aligned(Allocator *a, u64 size, u64 alignment)
+{
+#if _X_C_ALLOC_HAS_ALIGNED_ALLOC
+    (void)a;
+    if (size == 0 || !_allocator_is_pow2(alignment))
+        return NULL;
+
+    if (alignment < sizeof(void *))
+        alignment = sizeof(void *);
+
+    if (size > ((u64)-1) - alignment)
+        return NULL;
+
+    // aligned_alloc requires size to be a multiple of alignment
+    return aligned_alloc(alignment, _allocator_align_up(size, alignment));
+#else
+    return _allocator_alloc_aligned_fallback(a, size, alignment);
+#endif
+}
+
+static void _c_alloc_free_aligned(Allocator *a, void *block)
+{
+#if _X_C_ALLOC_HAS_ALIGNED_ALLOC
+    (void)a;
+    free(block);
+#else
+    _allocator_free_aligned_fallback(a, block);
+#endif
+}
+
+// Calls malloc and free directly, sparing one indirect call per block
+static Bool _c_alloc_batch(Allocator *a, u64 size, u64 count, void **outPtrs)
+{
+    (void)a;
+    for (u64 i = 0; i < count; ++i)
+    {
+        outPtrs[i] = malloc(size);
+        if (!outPtrs[i])
+        {
+            while (i > 0)
+                free(outPtrs[--i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void _c_free_batch(Allocator *a, void **blocks, u64 count)
+{
+    (void)a;
+    for (u64 i = 0; i < count; ++i)
+        free(blocks[i]);
+}
+
+#if defined(__GLIBC__)
+static u64 _c_alloc_usable_size(Allocator *a, void *block)
+{
+    (void)a;
+    return (u64)malloc_usable_size(block);
+}
+#endif
+
 static Allocator _c_allocator = {
     ._internalState = NULL,
     .alloc = &_c_alloc_malloc,
     .realloc = &_c_alloc_realloc,
     .free = &_c_alloc_free,
+    .alloc_aligned = &_c_alloc_aligned,
+    .free_aligned = &_c_alloc_free_aligned,
+#if defined(__GLIBC__)
+    .usable_size = &_c_alloc_usable_size,
+#else
+    .usable_size = NULL,
+#endif
+    .free_sized = NULL,
+    .alloc_batch = &_c_alloc_batch,
+    .free_batch = &_c_free_batch,
 };
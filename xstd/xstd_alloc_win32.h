@@ -31,9 +31,31 @@ static void _win32_free(Allocator *a, void *block)
     HeapFree(_win32_alloc_state.procHeapHandle, 0, block);
 }
 
+// HeapAlloc only guarantees 16 bytes alignment, over-allocate for more
+static void *_win32_alloc_aligned(Allocator *a, u64 size, u64 alignment)
+{
+    return _allocator_alloc_aligned_fallback(a, size, alignment);
+}
+
+static void _win32_free_aligned(Allocator *a, void *block)
+{
+    _allocator_free_aligned_fallback(a, block);
+}
+
+static u64 _win32_usable_size(Allocator *a, void *block)
+{
+    (void)a;
+    _w32_size_t size = HeapSize(_win32_alloc_state.procHeapHandle, 0, block);
+    return size == (_w32_size_t)-1 ? 0 : (u64)size;
+}
+
 static Allocator _win32_allocator = {
     ._internalState = &_win32_alloc_state,
     .alloc = &_win32_malloc,
     .realloc = &_win32_realloc,
     .free = &_win32_free,
+    .alloc_aligned = &_win32_alloc_aligned,
+    .free_aligned = &_win32_free_aligned,
+    .usable_size = &_win32_usable_size,
+    .free_sized = NULL,
 };
@@ -0,0 +1,218 @@
+#pragma once
+
+// Non-cryptographic 64-bit hashes for hash tables and checksums
+
+#include "xstd_core.h"
+#include "xstd_mem.h"
+#include "xstd_time.h"
+
+/**
+ * @brief Selects the function used by `hash_bytes()`.
+ *
+ * `HASH_ALGO_WY` is fast and seeded, use it for in-memory tables.
+ * `HASH_ALGO_FNV1A` ignores the seed and gives the same value on every
+ * platform and run, use it when hashes are persisted.
+ */
+typedef u8 HashAlgo;
+
+enum HashAlgoEnum
+{
+    HASH_ALGO_WY,
+    HASH_ALGO_FNV1A,
+};
+
+/**
+ * @brief FNV-1a 64-bit, one byte per step. Stable across platforms and runs.
+ *
+ * @param data
+ * @param len
+ * @return u64
+ */
+static inline u64 hash_fnv1a64(const void *data, u64 len)
+{
+    const u8 *bytes = (const u8 *)data;
+
+    u64 hash = 0xcbf29ce484222325ULL;
+    for (u64 i = 0; i < len; ++i)
+        hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+
+    return hash;
+}
+
+// 64x64 -> 128 bit multiply, low half in *a and high half in *b
+static inline void _hash_mum(u64 *a, u64 *b)
+{
+    #if defined(__SIZEOF_INT128__)
+    __extension__ typedef unsigned __int128 _HashU128;
+    _HashU128 r = (_HashU128)*a * *b;
+    *a = (u64)r;
+    *b = (u64)(r >> 64);
+    #else
+    u64 ha = *a >> 32, hb = *b >> 32, la = (u32)*a, lb = (u32)*b;
+    u64 rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    u64 t = rl + (rm0 << 32);
+    u64 carry = t < rl;
+    u64 lo = t + (rm1 << 32);
+    carry += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+    #endif
+}
+
+static inline u64 _hash_mix(u64 a, u64 b)
+{
+    _hash_mum(&a, &b);
+    return a ^ b;
+}
+
+static inline u64 _hash_read64(const u8 *p)
+{
+    u64 v;
+    mem_copy(&v, p, sizeof(v));
+    #if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+    #endif
+    return v;
+}
+
+static inline u64 _hash_read32(const u8 *p)
+{
+    u32 v;
+    mem_copy(&v, p, sizeof(v));
+    #if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+    #endif
+    return v;
+}
+
+static const u64 _x_hash_secret[4] = {
+    0x2d358dccaa6c78a5ULL,
+    0x8bb84b93962eacc9ULL,
+    0x4b33a62ed433d4a3ULL,
+    0x4d5a2da51de1aa47ULL,
+};
+
+/**
+ * @brief Seeded 64-bit hash (wyhash, final version 4), reads 16 to 48 bytes
+ * per step. Values depend on the seed, do not persist them.
+ *
+ * ```c
+ * u64 seed = hash_random_seed();
+ * u64 h = hash_wy("key", 3, seed);
+ * ```
+ *
+ * @param data
+ * @param len
+ * @param seed
+ * @return u64
+ */
+static inline u64 hash_wy(const void *data, u64 len, u64 seed)
+{
+    const u8 *p = (const u8 *)data;
+    const u64 *secret = _x_hash_secret;
+    u64 a, b;
+
+    seed ^= _hash_mix(seed ^ secret[0], secret[1]);
+
+    if (len <= 16)
+    {
+        if (len >= 4)
+        {
+            a = (_hash_read32(p) << 32) | _hash_read32(p + ((len >> 3) << 2));
+            b = (_hash_read32(p + len - 4) << 32) | _hash_read32(p + len - 4 - ((len >> 3) << 2));
+        }
+        else if (len > 0)
+        {
+            a = ((u64)p[0] << 16) | ((u64)p[len >> 1] << 8) | p[len - 1];
+            b = 0;
+        }
+        else
+        {
+            a = b = 0;
+        }
+    }
+    else
+    {
+        u64 i = len;
+        if (i >= 48)
+        {
+            u64 see1 = seed, see2 = seed;
+            do
+            {
+                seed = _hash_mix(_hash_read64(p) ^ secret[1], _hash_read64(p + 8) ^ seed);
+                see1 = _hash_mix(_hash_read64(p + 16) ^ secret[2], _hash_read64(p + 24) ^ see1);
+                see2 = _hash_mix(_hash_read64(p + 32) ^ secret[3], _hash_read64(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i >= 48);
+            seed ^= see1 ^ see2;
+        }
+
+        while (i > 16)
+        {
+            seed = _hash_mix(_hash_read64(p) ^ secret[1], _hash_read64(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+
+        a = _hash_read64(p + i - 16);
+        b = _hash_read64(p + i - 8);
+    }
+
+    a ^= secret[1];
+    b ^= seed;
+    _hash_mum(&a, &b);
+    return _hash_mix(a ^ secret[0] ^ len, b ^ secret[1]);
+}
+
+/**
+ * @brief Seeded hash of a single 64-bit integer, one 128-bit multiply. Every
+ * input bit reaches every output bit, so sequential IDs and aligned pointers
+ * spread over the whole range.
+ *
+ * @param value
+ * @param seed
+ * @return u64
+ */
+static inline u64 hash_u64(u64 value, u64 seed)
+{
+    return _hash_mix(value ^ _x_hash_secret[0], seed ^ _x_hash_secret[1]);
+}
+
+/**
+ * @brief Hashes `len` bytes with the selected algorithm. `seed` is ignored by
+ * `HASH_ALGO_FNV1A`.
+ *
+ * @param algo
+ * @param data may be NULL when `len` is 0
+ * @param len
+ * @param seed
+ * @return u64
+ */
+static inline u64 hash_bytes(HashAlgo algo, const void *data, u64 len, u64 seed)
+{
+    if (algo == HASH_ALGO_FNV1A)
+        return hash_fnv1a64(data, len);
+
+    return hash_wy(data, len, seed);
+}
+
+/**
+ * @brief Returns a seed that differs between calls and between runs, built
+ * from the clock, a call counter and stack/code addresses (ASLR).
+ *
+ * Not suitable for cryptography, only meant to keep hash tables fed with
+ * untrusted keys from being flooded with precomputed collisions.
+ *
+ * @return u64
+ */
+static inline u64 hash_random_seed(void)
+{
+    static u64 counter = 0;
+    u64 local = __atomic_fetch_add(&counter, 1u, __ATOMIC_RELAXED);
+
+    u64 seed = time_unix_ms();
+    seed = _hash_mix(seed ^ _x_hash_secret[0], (u64)(uPtr)&local ^ _x_hash_secret[1]);
+    seed = _hash_mix(seed ^ local, (u64)(uPtr)&hash_random_seed ^ _x_hash_secret[2]);
+    return seed;
+}
@@ -7,36 +7,15 @@
 #include "xstd_result.h"
 #include "xstd_error.h"
 #include "xstd_mem.h"
+#include "xstd_hash.h"
 
-#if _X_ARCH_64BIT
-static inline u64 _hashmap_fnv1a64(const void *key, u64 len)
-{
-    const u8 *data = (const u8 *)key;
-
-    u64 hash = 0xcbf29ce484222325ULL;
-    for (u64 i = 0; i < len; ++i)
-        hash = (hash ^ data[i]) * 0x100000001b3ULL;
-
-    return hash;
-}
-#else
-static inline u32 _hashmap_fnv1a32(const void *key, u32 len)
-{
-    const u8 *data = (const u8 *)key;
-
-    u32 hash = 0x811C9DC5U;
-    for (u32 i = 0; i < len; ++i)
-        hash = (hash ^ data[i]) * 0x01000193U;
-
-    return hash;
-}
-#endif
 
+// Entries are a single allocation: the header, the value padded to 8 bytes, then the key bytes
 typedef struct _hashmap_entry
 {
     u64 _hash;
-    Buffer _key;
-    void *_value;
+    u64 _keySize;
+    u64 _orderIdx;
     struct _hashmap_entry *_next;
 } _HashMapEntry;
 
@@ -44,66 +23,141 @@ typedef struct _hashmap
 {
     _HashMapEntry **_buckets;
     u64 _bucketCount;
+    u32 _bucketShift;
     u64 _size;
     u64 _valueSize;
+    u64 _seed;
+    HashAlgo _hashAlgo;
+    // Incremental rehash: buckets below `_migrateIdx` were moved to `_buckets`,
+    // which is only initialized for those, see `_hashmap_ready_buckets()`
+    Bool _incrementalRehash;
+    _HashMapEntry **_oldBuckets;
+    u64 _oldBucketCount;
+    u32 _oldBucketShift;
+    u64 _migrateIdx;
+    // Insertion-ordered mode: entries by insertion order, removed ones leave NULL holes
+    Bool _insertionOrdered;
+    _HashMapEntry **_order;
+    u64 _orderCount;
+    u64 _orderCapacity;
+    u64 _orderHoles;
     Allocator _allocator;
 } HashMap;
 
+/**
+ * @brief Cursor over the entries of a HashMap, see `hashmap_iter_next()`.
+ */
+typedef struct _hashmap_iter
+{
+    u64 _pos;
+    _HashMapEntry *_entry;
+} HashMapIter;
+
 result_define(HashMap, HashMap);
 
 #define _X_HASHMAP_INITIAL_SIZE 32
 #define _X_HASHMAP_LOAD_FACTOR_NUM 3
 #define _X_HASHMAP_LOAD_FACTOR_DEN 4
+// Old buckets moved per set/get/remove during an incremental rehash. The table
+// doubles, so 2 already finish before the next growth; 4 leaves headroom
+#define _X_HASHMAP_REHASH_STEP 4
+
+static inline u32 _hashmap_bucket_shift(u64 bucketCount)
+{
+    return 64u - (u32)__builtin_ctzll(bucketCount);
+}
 
 /**
- * @brief Creates a HashMap allowing storing of key-value pairs, with constant time fetching by using hashing.
+ * @brief Creates a HashMap hashing keys with the given algorithm and seed.
  *
- * Prefer `HashMapInitT` for a type safe alternative.
+ * Use `HASH_ALGO_FNV1A` when the iteration order or the hashes must not change
+ * between runs, `hashmap_init()` picks a fast hash with a random seed.
  *
  * ```c
- * ResultHashMap mapRes = hashmap_init(&c_alloc, sizeof(u64), 16);
- * if (mapRes.error.code) // Error!
+ * ResHashMap mapRes = hashmap_init_hashed(&c_alloc, sizeof(u64), 16, HASH_ALGO_FNV1A, 0);
+ * if (mapRes.isErr) // Error!
  * HashMap map = mapRes.value;
- * ConstStr key = "This is an example key";
- * u64 value = 52;
- * Error err = hashmap_set_str(&map, key, &value);
- * if (err.code) // Error!
- * u64 outVal;
- * err = hashmap_get_str(&map, key, &outVal);
- * if (err.code) // Error!
- * // outVal == 52
- * hashmap_deinit(&map);
  * ```
  * @param alloc
  * @param valueByteSize
- * @param initialAllocCount
- * @return ResultHashMap
+ * @param initialAllocCount bucket count, rounded up to a power of two
+ * @param algo
+ * @param seed ignored by `HASH_ALGO_FNV1A`
+ * @return ResHashMap
  */
-static inline result_type(HashMap) hashmap_init(Allocator *alloc, u64 valueByteSize, u64 initialAllocCount)
+static inline result_type(HashMap) hashmap_init_hashed(Allocator *alloc, u64 valueByteSize, u64 initialAllocCount, HashAlgo algo, u64 seed)
 {
-    if (!alloc || valueByteSize == 0)
-        return result_err(HashMap, X_ERR_EXT("hashmap", "hashmap_init", ERR_INVALID_PARAMETER, "null or invalid arg"));
+    if (!alloc || valueByteSize == 0 || (algo != HASH_ALGO_WY && algo != HASH_ALGO_FNV1A))
+        return result_err(HashMap, X_ERR_EXT("hashmap", "hashmap_init_hashed", ERR_INVALID_PARAMETER, "null or invalid arg"));
 
-    if (initialAllocCount < _X_HASHMAP_INITIAL_SIZE)
-        initialAllocCount = _X_HASHMAP_INITIAL_SIZE;
+    // Power of two so buckets are picked with a shift, see `_hashmap_bucket_idx()`
+    u64 bucketCount = _X_HASHMAP_INITIAL_SIZE;
+    while (bucketCount < initialAllocCount)
+        bucketCount *= 2;
+    initialAllocCount = bucketCount;
 
     HashMap map;
     map._buckets = (_HashMapEntry **)alloc->alloc(alloc, sizeof(_HashMapEntry *) * initialAllocCount);
 
     if (!map._buckets)
-        return result_err(HashMap, X_ERR_EXT("hashmap", "hashmap_init", ERR_OUT_OF_MEMORY, "alloc failure"));
+        return result_err(HashMap, X_ERR_EXT("hashmap", "hashmap_init_hashed", ERR_OUT_OF_MEMORY, "alloc failure"));
 
     for (u64 i = 0; i < initialAllocCount; ++i)
         map._buckets[i] = 0;
 
     map._bucketCount = initialAllocCount;
+    map._bucketShift = _hashmap_bucket_shift(initialAllocCount);
     map._size = 0;
     map._valueSize = valueByteSize;
+    map._seed = seed;
+    map._hashAlgo = algo;
+    map._incrementalRehash = false;
+    map._oldBuckets = NULL;
+    map._oldBucketCount = 0;
+    map._oldBucketShift = 0;
+    map._migrateIdx = 0;
+    map._insertionOrdered = false;
+    map._order = NULL;
+    map._orderCount = 0;
+    map._orderCapacity = 0;
+    map._orderHoles = 0;
     map._allocator = *alloc;
 
     return result_ok(HashMap, map);
 }
 
+/**
+ * @brief Creates a HashMap allowing storing of key-value pairs, with constant time fetching by using hashing.
+ *
+ * Keys are hashed with `hash_wy()` and a per-map random seed, so colliding
+ * keys can not be precomputed and iteration order differs between runs.
+ *
+ * Prefer `HashMapInitT` for a type safe alternative.
+ *
+ * ```c
+ * ResultHashMap mapRes = hashmap_init(&c_alloc, sizeof(u64), 16);
+ * if (mapRes.error.code) // Error!
+ * HashMap map = mapRes.value;
+ * ConstStr key = "This is an example key";
+ * u64 value = 52;
+ * Error err = hashmap_set_str(&map, key, &value);
+ * if (err.code) // Error!
+ * u64 outVal;
+ * err = hashmap_get_str(&map, key, &outVal);
+ * if (err.code) // Error!
+ * // outVal == 52
+ * hashmap_deinit(&map);
+ * ```
+ * @param alloc
+ * @param valueByteSize
+ * @param initialAllocCount
+ * @return ResultHashMap
+ */
+static inline result_type(HashMap) hashmap_init(Allocator *alloc, u64 valueByteSize, u64 initialAllocCount)
+{
+    return hashmap_init_hashed(alloc, valueByteSize, initialAllocCount, HASH_ALGO_WY, hash_random_seed());
+}
+
 /**
  * @brief Type safe variant of `hashmap_init`
  *
@@ -124,6 +178,40 @@ static inline result_type(HashMap) hashmap_init(Allocator *alloc, u64 valueByteS
  */
 #define HashMapInitT(T, allocPtr) hashmap_init((allocPtr), sizeof(T), _X_HASHMAP_INITIAL_SIZE)
 
+// New buckets in use. During an incremental rehash, old bucket `i` splits into
+// a range of new buckets that is only zeroed when `i` migrates, the ones past
+// that are uninitialized and their entries still sit in the old buckets
+static inline u64 _hashmap_ready_buckets(HashMap *map)
+{
+    if (!map->_oldBuckets)
+        return map->_bucketCount;
+
+    return map->_migrateIdx << (map->_oldBucketShift - map->_bucketShift);
+}
+
+static inline u64 _hashmap_entry_size(HashMap *map, u64 keySize)
+{
+    return sizeof(_HashMapEntry) + ((map->_valueSize + 7u) & ~(u64)7u) + keySize;
+}
+
+static inline void *_hashmap_entry_value(_HashMapEntry *entry)
+{
+    return (i8 *)entry + sizeof(_HashMapEntry);
+}
+
+static inline Buffer _hashmap_entry_key(HashMap *map, _HashMapEntry *entry)
+{
+    return (Buffer){
+        .bytes = (i8 *)entry + sizeof(_HashMapEntry) + ((map->_valueSize + 7u) & ~(u64)7u),
+        .size = entry->_keySize,
+    };
+}
+
+static inline void _hashmap_entry_free(HashMap *map, _HashMapEntry *entry)
+{
+    allocator_free_sized(&map->_allocator, entry, _hashmap_entry_size(map, entry->_keySize));
+}
+
 /**
  * @brief Frees the memory allocated for the HashMap.
  *
@@ -137,7 +225,8 @@ static inline void hashmap_deinit(HashMap *map)
         return;
 
     Allocator *alloc = &map->_allocator;
-    for (u64 i = 0; i < map->_bucketCount; ++i)
+    u64 ready = _hashmap_ready_buckets(map);
+    for (u64 i = 0; i < ready; ++i)
     {
         _HashMapEntry *entry = map->_buckets[i];
 
@@ -145,17 +234,31 @@ static inline void hashmap_deinit(HashMap *map)
         {
             _HashMapEntry *next = entry->_next;
 
-            if (entry->_key.bytes)
-                alloc->free(alloc, entry->_key.bytes);
+            _hashmap_entry_free(map, entry);
+            entry = next;
+        }
+    }
+    allocator_free_sized(alloc, map->_buckets, sizeof(_HashMapEntry *) * map->_bucketCount);
+
+    if (map->_oldBuckets)
+    {
+        for (u64 i = map->_migrateIdx; i < map->_oldBucketCount; ++i)
+        {
+            _HashMapEntry *entry = map->_oldBuckets[i];
 
-            if (entry->_value)
-                alloc->free(alloc, entry->_value);
+            while (entry)
+            {
+                _HashMapEntry *next = entry->_next;
 
-            alloc->free(alloc, entry);
-            entry = next;
+                _hashmap_entry_free(map, entry);
+                entry = next;
+            }
         }
+        allocator_free_sized(alloc, map->_oldBuckets, sizeof(_HashMapEntry *) * map->_oldBucketCount);
     }
-    alloc->free(alloc, map->_buckets);
+
+    if (map->_order)
+        allocator_free_sized(alloc, map->_order, sizeof(_HashMapEntry *) * map->_orderCapacity);
     *map = (HashMap){0};
 }
 
@@ -183,108 +286,190 @@ static inline Bool _hashmap_key_equals(Buffer a, Buffer b)
     return true;
 }
 
-static inline u64 _hashmap_bucket_idx(HashMap *map, u64 hash)
+static inline u64 _hashmap_hash(HashMap *map, Buffer key)
 {
-    return hash % map->_bucketCount;
+    return hash_bytes(map->_hashAlgo, key.bytes, key.size, map->_seed);
 }
 
-static inline Bool _hashmap_is_invalid_idx(HashMap *map, u64 idx)
+// Fibonacci hashing: one multiply folds every hash bit into the top ones, which
+// pick the bucket. FNV keys differing only in their last bytes would otherwise
+// pile up in a few buckets
+static inline u64 _hashmap_bucket_of(u64 hash, u32 bucketShift)
 {
-    if (!map->_bucketCount)
-        return true;
+    return (hash * 0x9E3779B97F4A7C15ULL) >> bucketShift;
+}
 
-    if (idx > map->_bucketCount - 1)
-        return true;
+static inline u64 _hashmap_bucket_idx(HashMap *map, u64 hash)
+{
+    return _hashmap_bucket_of(hash, map->_bucketShift);
+}
 
-    return false;
+// Bucket holding the chain of `hash`: the old one until it has migrated, the new one after
+static inline _HashMapEntry **_hashmap_bucket_link(HashMap *map, u64 hash)
+{
+    if (map->_oldBuckets)
+    {
+        u64 oldIdx = _hashmap_bucket_of(hash, map->_oldBucketShift);
+        if (oldIdx >= map->_migrateIdx)
+            return &map->_oldBuckets[oldIdx];
+    }
+
+    return &map->_buckets[_hashmap_bucket_idx(map, hash)];
 }
 
-static inline Error _hashmap_set(HashMap *map, Buffer key, const void *value, u64 hash)
+// Link pointing at the entry holding `key`, NULL when absent
+static inline _HashMapEntry **_hashmap_find_link(HashMap *map, Buffer key, u64 hash)
 {
-    Allocator *alloc = &map->_allocator;
+    _HashMapEntry **link = _hashmap_bucket_link(map, hash);
 
-    u64 idx = _hashmap_bucket_idx(map, hash);
-    if (_hashmap_is_invalid_idx(map, idx))
+    while (*link)
     {
-        return X_ERR_EXT("hashmap", "_hashmap_set", ERR_RANGE_ERROR, "inexistent entry");
-    }
+        _HashMapEntry *entry = *link;
+        if (entry->_hash == hash && _hashmap_key_equals(_hashmap_entry_key(map, entry), key))
+            return link;
 
-    _HashMapEntry *entry = map->_buckets[idx];
+        link = &entry->_next;
+    }
+    return NULL;
+}
 
-    while (entry)
+// Appends to the insertion order, squeezing out holes before growing the array
+static inline Bool _hashmap_order_push(HashMap *map, _HashMapEntry *entry)
+{
+    if (map->_orderCount == map->_orderCapacity)
     {
-        if (entry->_hash == hash && _hashmap_key_equals(entry->_key, key))
+        if (map->_orderHoles * 2 > map->_orderCount)
         {
-            if (map->_valueSize == 0)
-                return X_ERR_OK;
-
-            if (!entry->_value)
+            u64 count = 0;
+            for (u64 i = 0; i < map->_orderCount; ++i)
             {
-                entry->_value = alloc->alloc(alloc, map->_valueSize);
-                if (!entry->_value)
-                    return X_ERR_EXT("hashmap", "_hashmap_set", ERR_OUT_OF_MEMORY, "alloc failure");
-            }
+                _HashMapEntry *e = map->_order[i];
+                if (!e)
+                    continue;
 
-            _hashmap_memcpy(map, value, entry->_value);
-            return X_ERR_OK;
+                e->_orderIdx = count;
+                map->_order[count++] = e;
+            }
+            map->_orderCount = count;
+            map->_orderHoles = 0;
+        }
+        else
+        {
+            Allocator *alloc = &map->_allocator;
+            u64 newCapacity = map->_orderCapacity ? map->_orderCapacity * 2 : _X_HASHMAP_INITIAL_SIZE;
+            u64 newBytes = sizeof(_HashMapEntry *) * newCapacity;
+            _HashMapEntry **order = (_HashMapEntry **)(map->_order ? alloc->realloc(alloc, map->_order, newBytes) : alloc->alloc(alloc, newBytes));
+            if (!order)
+                return false;
+
+            map->_order = order;
+            map->_orderCapacity = newCapacity;
         }
-        entry = entry->_next;
     }
 
-    _HashMapEntry *newEntry = (_HashMapEntry *)alloc->alloc(alloc, sizeof(_HashMapEntry));
+    entry->_orderIdx = map->_orderCount;
+    map->_order[map->_orderCount++] = entry;
+    return true;
+}
+
+static inline void _hashmap_order_remove(HashMap *map, _HashMapEntry *entry)
+{
+    map->_order[entry->_orderIdx] = NULL;
+
+    if (entry->_orderIdx + 1 == map->_orderCount)
+    {
+        map->_orderCount -= 1;
+        return;
+    }
+    map->_orderHoles += 1;
+}
+
+static inline Error _hashmap_set(HashMap *map, Buffer key, const void *value, u64 hash)
+{
+    Allocator *alloc = &map->_allocator;
+
+    _HashMapEntry **link = _hashmap_find_link(map, key, hash);
+    if (link)
+    {
+        _hashmap_memcpy(map, value, _hashmap_entry_value(*link));
+        return X_ERR_OK;
+    }
+
+    // Header, value and key share one block
+    _HashMapEntry *newEntry = (_HashMapEntry *)alloc->alloc(alloc, _hashmap_entry_size(map, key.size));
 
     if (!newEntry)
         return X_ERR_EXT("hashmap", "_hashmap_set", ERR_OUT_OF_MEMORY, "alloc failure");
 
     newEntry->_hash = hash;
-    u64 keyAllocSize = key.size ? key.size : 1;
-    newEntry->_key = (Buffer){
-        .bytes = (i8 *)alloc->alloc(alloc, keyAllocSize),
-        .size = key.size,
-    };
+    newEntry->_keySize = key.size;
+
+    if (key.size)
+        mem_copy(_hashmap_entry_key(map, newEntry).bytes, key.bytes, key.size);
+
+    _hashmap_memcpy(map, value, _hashmap_entry_value(newEntry));
 
-    if (!newEntry->_key.bytes)
+    if (map->_insertionOrdered && !_hashmap_order_push(map, newEntry))
     {
-        alloc->free(alloc, newEntry);
+        _hashmap_entry_free(map, newEntry);
         return X_ERR_EXT("hashmap", "_hashmap_set", ERR_OUT_OF_MEMORY, "alloc failure");
     }
 
-    if (key.size)
-    {
-        mem_copy(newEntry->_key.bytes, key.bytes, key.size);
-    }
-    else
-    {
-        newEntry->_key.bytes[0] = 0;
-    }
+    // Keys of a bucket that has not migrated yet join the old chain and move with it
+    _HashMapEntry **bucket = _hashmap_bucket_link(map, hash);
+    newEntry->_next = *bucket;
+    *bucket = newEntry;
+    map->_size += 1;
+    return X_ERR_OK;
+}
 
-    if (map->_valueSize == 0)
+static inline void _hashmap_move_chain(_HashMapEntry *entry, _HashMapEntry **buckets, u32 bucketShift)
+{
+    while (entry)
     {
-        newEntry->_value = NULL;
+        _HashMapEntry *next = entry->_next;
+        u64 idx = _hashmap_bucket_of(entry->_hash, bucketShift);
+        entry->_next = buckets[idx];
+        buckets[idx] = entry;
+        entry = next;
     }
-    else
+}
+
+// Moves up to `bucketCount` old buckets into the new table, frees the old one when done
+static inline void _hashmap_rehash_step(HashMap *map, u64 bucketCount)
+{
+    if (!map->_oldBuckets)
+        return;
+
+    // Old bucket `i` splits into new buckets [i << split, (i + 1) << split), zeroed right before the move
+    u32 split = map->_oldBucketShift - map->_bucketShift;
+    u64 end = map->_oldBucketCount - map->_migrateIdx > bucketCount ? map->_migrateIdx + bucketCount : map->_oldBucketCount;
+    for (; map->_migrateIdx < end; ++map->_migrateIdx)
     {
-        newEntry->_value = alloc->alloc(alloc, map->_valueSize);
-        if (!newEntry->_value)
-        {
-            alloc->free(alloc, newEntry->_key.bytes);
-            alloc->free(alloc, newEntry);
-            return X_ERR_EXT("hashmap", "_hashmap_set", ERR_OUT_OF_MEMORY, "alloc failure");
-        }
+        _HashMapEntry **range = map->_buckets + (map->_migrateIdx << split);
+        for (u64 i = 0; i < ((u64)1 << split); ++i)
+            range[i] = NULL;
 
-        _hashmap_memcpy(map, value, newEntry->_value);
+        _hashmap_move_chain(map->_oldBuckets[map->_migrateIdx], map->_buckets, map->_bucketShift);
+        map->_oldBuckets[map->_migrateIdx] = NULL;
     }
 
-    newEntry->_next = map->_buckets[idx];
-    map->_buckets[idx] = newEntry;
-    map->_size += 1;
-    return X_ERR_OK;
+    if (map->_migrateIdx == map->_oldBucketCount)
+    {
+        allocator_free_sized(&map->_allocator, map->_oldBuckets, sizeof(_HashMapEntry *) * map->_oldBucketCount);
+        map->_oldBuckets = NULL;
+        map->_oldBucketCount = 0;
+        map->_migrateIdx = 0;
+    }
 }
 
 static inline Error _hashmap_rehash(HashMap *map, u64 newBucketCount)
 {
-    if (newBucketCount == 0)
-        return X_ERR_EXT("hashmap", "_hashmap_rehash", ERR_INVALID_PARAMETER, "new bucket count is 0");
+    if (newBucketCount == 0 || (newBucketCount & (newBucketCount - 1)))
+        return X_ERR_EXT("hashmap", "_hashmap_rehash", ERR_INVALID_PARAMETER, "new bucket count is not a power of two");
+
+    // A previous incremental rehash must be over before the table changes again
+    _hashmap_rehash_step(map, map->_oldBucketCount);
 
     Allocator *alloc = &map->_allocator;
     _HashMapEntry **newBuckets = (_HashMapEntry **)alloc->alloc(alloc, sizeof(_HashMapEntry *) * newBucketCount);
@@ -292,25 +477,102 @@ static inline Error _hashmap_rehash(HashMap *map, u64 newBucketCount)
     if (!newBuckets)
         return X_ERR_EXT("hashmap", "_hashmap_rehash", ERR_OUT_OF_MEMORY, "alloc failure");
 
-    for (u64 i = 0; i < newBucketCount; ++i)
-        newBuckets[i] = 0;
+    u32 newShift = _hashmap_bucket_shift(newBucketCount);
 
-    // Move all entries
-    for (u64 i = 0; i < map->_bucketCount; ++i)
+    if (map->_incrementalRehash && newBucketCount > map->_bucketCount)
     {
-        _HashMapEntry *entry = map->_buckets[i];
-        while (entry)
-        {
-            _HashMapEntry *next = entry->_next;
-            u64 idx = entry->_hash % newBucketCount;
-            entry->_next = newBuckets[idx];
-            newBuckets[idx] = entry;
-            entry = next;
-        }
+        // Entries move a few buckets at a time and the new array is zeroed
+        // along with them, see `_hashmap_rehash_step()`
+        map->_oldBuckets = map->_buckets;
+        map->_oldBucketCount = map->_bucketCount;
+        map->_oldBucketShift = map->_bucketShift;
+        map->_migrateIdx = 0;
+    }
+    else
+    {
+        for (u64 i = 0; i < newBucketCount; ++i)
+            newBuckets[i] = 0;
+
+        // Move all entries
+        for (u64 i = 0; i < map->_bucketCount; ++i)
+            _hashmap_move_chain(map->_buckets[i], newBuckets, newShift);
+
+        allocator_free_sized(alloc, map->_buckets, sizeof(_HashMapEntry *) * map->_bucketCount);
     }
-    alloc->free(alloc, map->_buckets);
+
     map->_buckets = newBuckets;
     map->_bucketCount = newBucketCount;
+    map->_bucketShift = newShift;
+    return X_ERR_OK;
+}
+
+/**
+ * @brief Enables or disables incremental rehashing.
+ *
+ * When enabled, growing the map only allocates the larger bucket array. Old
+ * and new arrays then coexist, and each following set, get or remove moves a
+ * few old buckets and zeroes their part of the new array, so no single insert
+ * pays for moving every entry nor for clearing the whole array.
+ * Disabling finishes a pending rehash right away.
+ *
+ * ```c
+ * HashMap map = HashMapInitT(u64, &c_alloc).value;
+ * hashmap_set_incremental_rehash(&map, true);
+ * ```
+ *
+ * @param map
+ * @param enabled
+ */
+static inline void hashmap_set_incremental_rehash(HashMap *map, Bool enabled)
+{
+    if (!map || !map->_buckets)
+        return;
+
+    map->_incrementalRehash = enabled;
+    if (!enabled)
+        _hashmap_rehash_step(map, map->_oldBucketCount);
+}
+
+/**
+ * @brief Enables or disables insertion-ordered mode.
+ *
+ * When enabled, entries are also kept in a dense array in insertion order:
+ * `hashmap_for_each()` and `hashmap_iter_next()` walk that array instead of
+ * every bucket and visit keys in the order they were first set. Costs one
+ * pointer per entry, removals leave holes that are squeezed out on later
+ * inserts.
+ *
+ * Can only be enabled while the map is empty.
+ *
+ * ```c
+ * HashMap map = HashMapInitT(u64, &c_alloc).value;
+ * Error err = hashmap_set_insertion_ordered(&map, true);
+ * ```
+ *
+ * @param map
+ * @param enabled
+ * @return Error
+ * @exception ERR_INVALID_PARAMETER
+ */
+static inline Error hashmap_set_insertion_ordered(HashMap *map, Bool enabled)
+{
+    if (!map || !map->_buckets)
+        return X_ERR_EXT("hashmap", "hashmap_set_insertion_ordered", ERR_INVALID_PARAMETER, "null or invalid arg");
+
+    if (enabled == map->_insertionOrdered)
+        return X_ERR_OK;
+
+    if (enabled && map->_size > 0)
+        return X_ERR_EXT("hashmap", "hashmap_set_insertion_ordered", ERR_INVALID_PARAMETER, "map not empty");
+
+    if (map->_order)
+        allocator_free_sized(&map->_allocator, map->_order, sizeof(_HashMapEntry *) * map->_orderCapacity);
+
+    map->_insertionOrdered = enabled;
+    map->_order = NULL;
+    map->_orderCount = 0;
+    map->_orderCapacity = 0;
+    map->_orderHoles = 0;
     return X_ERR_OK;
 }
 
@@ -333,21 +595,15 @@ static inline Error hashmap_set(HashMap *map, Buffer key, const void *value)
     if (map->_valueSize > 0 && !value)
         return X_ERR_EXT("hashmap", "hashmap_set", ERR_INVALID_PARAMETER, "null value buffer");
 
+    _hashmap_rehash_step(map, _X_HASHMAP_REHASH_STEP);
+
     if ((map->_size + 1) * _X_HASHMAP_LOAD_FACTOR_DEN > map->_bucketCount * _X_HASHMAP_LOAD_FACTOR_NUM)
     {
         Error err = _hashmap_rehash(map, map->_bucketCount * 2);
         if (err.code != ERR_OK)
             return err;
     }
-    static const i8 _x_hashmap_empty_key = 0;
-    const i8 *hashKeyBytes = key.bytes ? key.bytes : &_x_hashmap_empty_key;
-    return _hashmap_set(map, key, value,
-        #if _X_ARCH_64BIT
-        _hashmap_fnv1a64(hashKeyBytes, key.size)
-        #else
-        _hashmap_fnv1a32(hashKeyBytes, key.size)
-        #endif
-    );
+    return _hashmap_set(map, key, value, _hashmap_hash(map, key));
 }
 
 #define HashMapSetBuffT(T, mapPtr, keyBuff, valPtr) \
@@ -399,36 +655,16 @@ static inline Error hashmap_get(HashMap *map, Buffer key, void *outValue)
     if (key.size > 0 && !key.bytes)
         return X_ERR_EXT("hashmap", "hashmap_get", ERR_INVALID_PARAMETER, "null key buffer");
 
-    static const i8 _x_hashmap_empty_key = 0;
-    const i8 *hashKeyBytes = key.bytes ? key.bytes : &_x_hashmap_empty_key;
+    _hashmap_rehash_step(map, _X_HASHMAP_REHASH_STEP);
 
-    #if _X_ARCH_64BIT
-    u64 hash = _hashmap_fnv1a64(hashKeyBytes, key.size);
-    #else
-    u64 hash = _hashmap_fnv1a32(hashKeyBytes, key.size);
-    #endif
-
-    u64 idx = _hashmap_bucket_idx(map, hash);
-
-    if (_hashmap_is_invalid_idx(map, idx))
-    {
+    _HashMapEntry **link = _hashmap_find_link(map, key, _hashmap_hash(map, key));
+    if (!link)
         return X_ERR_EXT("hashmap", "hashmap_get", ERR_RANGE_ERROR, "inexistent key");
-    }
 
-    _HashMapEntry *entry = map->_buckets[idx];
-    while (entry)
-    {
-        if (entry->_hash == hash && _hashmap_key_equals(entry->_key, key))
-        {
-            if (outValue && entry->_value)
-            {
-                _hashmap_memcpy(map, entry->_value, outValue);
-            }
-            return X_ERR_OK;
-        }
-        entry = entry->_next;
-    }
-    return X_ERR_EXT("hashmap", "hashmap_get", ERR_RANGE_ERROR, "inexistent key");
+    if (outValue)
+        _hashmap_memcpy(map, _hashmap_entry_value(*link), outValue);
+
+    return X_ERR_OK;
 }
 
 #define HashMapGetBuffT(T, mapPtr, keyBuff, outPtr) \
@@ -487,43 +723,19 @@ static inline Error hashmap_remove(HashMap *map, Buffer key)
     if (!map || !map->_buckets || !key.bytes)
         return X_ERR_EXT("hashmap", "hashmap_remove", ERR_INVALID_PARAMETER, "null or invalid arg");
 
-    #if _X_ARCH_64BIT
-    u64 hash = _hashmap_fnv1a64(key.bytes, key.size);
-    #else
-    u64 hash = _hashmap_fnv1a32(key.bytes, key.size);
-    #endif
+    _hashmap_rehash_step(map, _X_HASHMAP_REHASH_STEP);
 
-    u64 idx = _hashmap_bucket_idx(map, hash);
-
-    if (_hashmap_is_invalid_idx(map, idx))
-    {
+    _HashMapEntry **link = _hashmap_find_link(map, key, _hashmap_hash(map, key));
+    if (!link)
         return X_ERR_EXT("hashmap", "hashmap_remove", ERR_RANGE_ERROR, "inexistent key");
-    }
-
-    _HashMapEntry **prev = &map->_buckets[idx];
-    _HashMapEntry *entry = map->_buckets[idx];
 
-    while (entry)
-    {
-        if (entry->_hash == hash && _hashmap_key_equals(entry->_key, key))
-        {
-            *prev = entry->_next;
-            Allocator *alloc = &map->_allocator;
-
-            if (entry->_key.bytes)
-                alloc->free(alloc, entry->_key.bytes);
-
-            if (entry->_value)
-                alloc->free(alloc, entry->_value);
-
-            alloc->free(alloc, entry);
-            map->_size -= 1;
-            return X_ERR_OK;
-        }
-        prev = &entry->_next;
-        entry = entry->_next;
-    }
-    return X_ERR_EXT("hashmap", "hashmap_remove", ERR_RANGE_ERROR, "inexistent key");
+    _HashMapEntry *entry = *link;
+    *link = entry->_next;
+    if (map->_insertionOrdered)
+        _hashmap_order_remove(map, entry);
+    _hashmap_entry_free(map, entry);
+    map->_size -= 1;
+    return X_ERR_OK;
 }
 
 /**
@@ -542,6 +754,8 @@ static inline Error hashmap_remove_str(HashMap *map, ConstStr key)
 /**
  * @brief Calls a function for each key-value pairs in the map.
  *
+ * Insertion-ordered maps are visited in insertion order.
+ *
  * @param map
  * @param func
  * @param userArg
@@ -551,15 +765,121 @@ static inline void hashmap_for_each(HashMap *map, void (*func)(Buffer key, void
     if (!map || !map->_buckets || !func)
         return;
 
-    for (u64 i = 0; i < map->_bucketCount; ++i)
+    if (map->_insertionOrdered)
+    {
+        for (u64 i = 0; i < map->_orderCount; ++i)
+        {
+            _HashMapEntry *entry = map->_order[i];
+            if (entry)
+                func(_hashmap_entry_key(map, entry), _hashmap_entry_value(entry), userArg);
+        }
+        return;
+    }
+
+    u64 ready = _hashmap_ready_buckets(map);
+    for (u64 i = 0; i < ready; ++i)
     {
         _HashMapEntry *entry = map->_buckets[i];
         while (entry)
         {
-            func(entry->_key, entry->_value, userArg);
+            func(_hashmap_entry_key(map, entry), _hashmap_entry_value(entry), userArg);
             entry = entry->_next;
         }
     }
+
+    // Not yet migrated part of an incremental rehash
+    for (u64 i = map->_migrateIdx; map->_oldBuckets && i < map->_oldBucketCount; ++i)
+    {
+        _HashMapEntry *entry = map->_oldBuckets[i];
+        while (entry)
+        {
+            func(_hashmap_entry_key(map, entry), _hashmap_entry_value(entry), userArg);
+            entry = entry->_next;
+        }
+    }
+}
+
+/**
+ * @brief Returns a cursor positioned before the first entry of the map.
+ *
+ * @param map
+ * @return HashMapIter
+ */
+static inline HashMapIter hashmap_iter(HashMap *map)
+{
+    (void)map;
+    return (HashMapIter){0};
+}
+
+/**
+ * @brief Advances the cursor and outputs the next key-value pair. Iteration
+ * can stop at any point, the cursor holds no resources.
+ *
+ * The map must not be modified while iterating, `hashmap_get()` included when
+ * incremental rehashing is enabled. The exception: insertion-ordered maps
+ * allow removing the entry just returned.
+ *
+ * ```c
+ * HashMapIter it = hashmap_iter(&map);
+ * Buffer key;
+ * void *value;
+ * while (hashmap_iter_next(&map, &it, &key, &value))
+ * {
+ *     if (*(u64 *)value == 52)
+ *         break;
+ * }
+ * ```
+ *
+ * @param map
+ * @param it
+ * @param outKey may be NULL, points into the map
+ * @param outValue may be NULL, points into the map
+ * @return true while an entry was output, false once the map is exhausted
+ */
+static inline Bool hashmap_iter_next(HashMap *map, HashMapIter *it, Buffer *outKey, void **outValue)
+{
+    if (!map || !map->_buckets || !it)
+        return false;
+
+    _HashMapEntry *entry = NULL;
+
+    if (map->_insertionOrdered)
+    {
+        while (!entry && it->_pos < map->_orderCount)
+            entry = map->_order[it->_pos++];
+    }
+    else
+    {
+        // Positions past the new buckets walk the old ones of a pending rehash
+        u64 bucketCount = map->_bucketCount;
+        u64 total = bucketCount + (map->_oldBuckets ? map->_oldBucketCount : 0);
+        u64 ready = _hashmap_ready_buckets(map);
+
+        entry = it->_entry;
+        while (!entry && it->_pos < total)
+        {
+            // Uninitialized new buckets, their entries are still in the old ones
+            if (it->_pos >= ready && it->_pos < bucketCount)
+                it->_pos = bucketCount;
+
+            entry = it->_pos < bucketCount ? map->_buckets[it->_pos] : map->_oldBuckets[it->_pos - bucketCount];
+            it->_pos += 1;
+        }
+
+        if (entry)
+            it->_entry = entry->_next;
+    }
+
+    if (!entry)
+        return false;
+
+    if (outKey)
+        *outKey = _hashmap_entry_key(map, entry);
+
+    if (outValue)
+        *outValue = _hashmap_entry_value(entry);
+
+    return true;
 }
 
 /**
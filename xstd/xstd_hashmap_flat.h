@@ -0,0 +1,694 @@
+#pragma once
+
+// Open-addressing hash map, slots live in one flat array next to a byte array
+// of control tags that is probed a whole group at a time
+
+#include "xstd_core.h"
+#include "xstd_alloc.h"
+#include "xstd_buffer.h"
+#include "xstd_string.h"
+#include "xstd_result.h"
+#include "xstd_error.h"
+#include "xstd_mem.h"
+#include "xstd_hash.h"
+#include "xstd_hashmap.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define _X_FLATMAP_SSE2 1
+    #include "emmintrin.h"
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && (!defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+    #define _X_FLATMAP_NEON 1
+    #include "arm_neon.h"
+#endif
+
+// Control tags: EMPTY, or the low 7 hash bits of the slot's key. Deletion
+// shifts entries back instead of leaving tombstones, so a set high bit always
+// means EMPTY
+#define _X_FLATMAP_EMPTY ((u8)0x80)
+#define _X_FLATMAP_MIN_CAPACITY 16u
+#define _X_FLATMAP_LOAD_FACTOR_NUM 3
+#define _X_FLATMAP_LOAD_FACTOR_DEN 4
+
+// One bit per selected slot of a group, `_flatmap_mask_lowest()` maps it back to an offset
+typedef u64 _FlatMapMask;
+
+#if defined(_X_FLATMAP_SSE2)
+    #define _X_FLATMAP_GROUP_WIDTH 16u
+    #define _X_FLATMAP_MASK_SHIFT 0u
+    #define _X_FLATMAP_MASK_ALL 0xFFFFull
+#elif defined(_X_FLATMAP_NEON)
+    #define _X_FLATMAP_GROUP_WIDTH 16u
+    #define _X_FLATMAP_MASK_SHIFT 2u
+    #define _X_FLATMAP_MASK_ALL 0x8888888888888888ull
+#else
+    #define _X_FLATMAP_GROUP_WIDTH 8u
+    #define _X_FLATMAP_MASK_SHIFT 3u
+    #define _X_FLATMAP_MASK_ALL 0x8080808080808080ull
+#endif
+
+#if !defined(_X_FLATMAP_SSE2) && !defined(_X_FLATMAP_NEON)
+static inline u64 _flatmap_load_word(const u8 *ctrl)
+{
+    u64 word;
+    mem_copy(&word, ctrl, sizeof(word));
+    #if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+    #endif
+    return word;
+}
+#endif
+
+static inline _FlatMapMask _flatmap_group_match(const u8 *ctrl, u8 tag)
+{
+    #if defined(_X_FLATMAP_SSE2)
+    __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+    return (u64)(u32)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)tag)));
+    #elif defined(_X_FLATMAP_NEON)
+    uint8x16_t eq = vceqq_u8(vld1q_u8(ctrl), vdupq_n_u8(tag));
+    uint8x8_t nibbles = vshrn_n_u16(vreinterpretq_u16_u8(eq), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(nibbles), 0) & _X_FLATMAP_MASK_ALL;
+    #else
+    // May report false positives next to a real match, callers compare the tag again
+    u64 x = _flatmap_load_word(ctrl) ^ (0x0101010101010101ull * tag);
+    return (x - 0x0101010101010101ull) & ~x & _X_FLATMAP_MASK_ALL;
+    #endif
+}
+
+static inline _FlatMapMask _flatmap_group_empty(const u8 *ctrl)
+{
+    #if defined(_X_FLATMAP_SSE2)
+    return (u64)(u32)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ctrl));
+    #elif defined(_X_FLATMAP_NEON)
+    uint8x16_t high = vtstq_u8(vld1q_u8(ctrl), vdupq_n_u8(_X_FLATMAP_EMPTY));
+    uint8x8_t nibbles = vshrn_n_u16(vreinterpretq_u16_u8(high), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(nibbles), 0) & _X_FLATMAP_MASK_ALL;
+    #else
+    return _flatmap_load_word(ctrl) & _X_FLATMAP_MASK_ALL;
+    #endif
+}
+
+static inline u64 _flatmap_mask_lowest(_FlatMapMask mask)
+{
+    return (u64)__builtin_ctzll(mask) >> _X_FLATMAP_MASK_SHIFT;
+}
+
+/*
+ * Table shared by `FlatHashMap` and `U64HashMap`: a control byte per slot
+ * followed by the slot array. Slots are opaque here, each map passes its slot
+ * size, how to hash the key of a stored slot and how to compare it to a key.
+ */
+typedef struct _flat_table
+{
+    u8 *_ctrl;
+    i8 *_slots;
+    u64 _capacity;
+    u64 _size;
+    u64 _slotSize;
+} _FlatTable;
+
+// Hash of the key stored in `slot`, finds its home slot when entries move
+typedef u64 (*_FlatTableSlotHashFn)(const void *slot, const void *ctx);
+
+// Whether `slot` holds `key`, only called for slots whose tag matches `hash`
+typedef Bool (*_FlatTableKeyEqFn)(const void *slot, const void *key, u64 hash, const void *ctx);
+
+static inline u8 _flat_table_tag(u64 hash)
+{
+    return (u8)(hash & 0x7Fu);
+}
+
+static inline u64 _flat_table_home(_FlatTable *table, u64 hash)
+{
+    return (hash >> 7) & (table->_capacity - 1);
+}
+
+static inline void *_flat_table_slot(_FlatTable *table, u64 idx)
+{
+    return table->_slots + idx * table->_slotSize;
+}
+
+// Control bytes are followed by a copy of the first group, so a group starting
+// near the end can be loaded in one go
+static inline u64 _flat_table_ctrl_bytes(u64 capacity)
+{
+    return (capacity + _X_FLATMAP_GROUP_WIDTH + 15u) & ~(u64)15u;
+}
+
+static inline u64 _flat_table_alloc_bytes(u64 slotSize, u64 capacity)
+{
+    return _flat_table_ctrl_bytes(capacity) + capacity * slotSize;
+}
+
+static inline void _flat_table_set_ctrl(_FlatTable *table, u64 idx, u8 tag)
+{
+    table->_ctrl[idx] = tag;
+    if (idx < _X_FLATMAP_GROUP_WIDTH)
+        table->_ctrl[table->_capacity + idx] = tag;
+}
+
+// Capacity for `count` entries under the load factor, a power of two
+static inline u64 _flat_table_capacity_for(u64 count)
+{
+    u64 capacity = _X_FLATMAP_MIN_CAPACITY;
+    while (capacity * _X_FLATMAP_LOAD_FACTOR_NUM < count * _X_FLATMAP_LOAD_FACTOR_DEN)
+        capacity *= 2;
+
+    return capacity;
+}
+
+// Replaces the arrays with empty ones, the caller keeps the old block
+static inline Bool _flat_table_alloc(_FlatTable *table, Allocator *alloc, u64 capacity)
+{
+    u8 *block = (u8 *)alloc->alloc(alloc, _flat_table_alloc_bytes(table->_slotSize, capacity));
+    if (!block)
+        return false;
+
+    u64 ctrlBytes = _flat_table_ctrl_bytes(capacity);
+    for (u64 i = 0; i < ctrlBytes; ++i)
+        block[i] = _X_FLATMAP_EMPTY;
+
+    table->_ctrl = block;
+    table->_slots = (i8 *)block + ctrlBytes;
+    table->_capacity = capacity;
+    table->_size = 0;
+    return true;
+}
+
+static inline void _flat_table_free(_FlatTable *table, Allocator *alloc)
+{
+    allocator_free_sized(alloc, table->_ctrl, _flat_table_alloc_bytes(table->_slotSize, table->_capacity));
+    *table = (_FlatTable){0};
+}
+
+// Index of the first empty slot at or after the key's home slot
+static inline u64 _flat_table_find_empty(_FlatTable *table, u64 hash)
+{
+    u64 mask = table->_capacity - 1;
+    u64 pos = _flat_table_home(table, hash);
+
+    for (;;)
+    {
+        _FlatMapMask empty = _flatmap_group_empty(table->_ctrl + pos);
+        if (empty)
+            return (pos + _flatmap_mask_lowest(empty)) & mask;
+
+        pos = (pos + _X_FLATMAP_GROUP_WIDTH) & mask;
+    }
+}
+
+/*
+ * Linear probing one group at a time: a key always sits between its home slot
+ * and the next empty slot, so the search stops at the first group holding one.
+ */
+static inline void *_flat_table_find(_FlatTable *table, const void *key, u64 hash, _FlatTableKeyEqFn keyEq, const void *ctx, u64 *outIdx)
+{
+    u64 mask = table->_capacity - 1;
+    u64 pos = _flat_table_home(table, hash);
+    u8 tag = _flat_table_tag(hash);
+
+    for (;;)
+    {
+        const u8 *group = table->_ctrl + pos;
+
+        _FlatMapMask match = _flatmap_group_match(group, tag);
+        while (match)
+        {
+            u64 offset = _flatmap_mask_lowest(match);
+            match &= match - 1;
+
+            if (group[offset] != tag)
+                continue;
+
+            u64 idx = (pos + offset) & mask;
+            void *slot = _flat_table_slot(table, idx);
+            if (keyEq(slot, key, hash, ctx))
+            {
+                if (outIdx)
+                    *outIdx = idx;
+                return slot;
+            }
+        }
+
+        if (_flatmap_group_empty(group))
+            return NULL;
+
+        pos = (pos + _X_FLATMAP_GROUP_WIDTH) & mask;
+    }
+}
+
+// Moves every slot into a table of `newCapacity`, the table is untouched on failure
+static inline Bool _flat_table_grow(_FlatTable *table, Allocator *alloc, u64 newCapacity, _FlatTableSlotHashFn slotHash, const void *ctx)
+{
+    _FlatTable old = *table;
+
+    if (!_flat_table_alloc(table, alloc, newCapacity))
+        return false;
+
+    for (u64 i = 0; i < old._capacity; ++i)
+    {
+        if (old._ctrl[i] & _X_FLATMAP_EMPTY)
+            continue;
+
+        void *src = _flat_table_slot(&old, i);
+        u64 idx = _flat_table_find_empty(table, slotHash(src, ctx));
+        _flat_table_set_ctrl(table, idx, old._ctrl[i]);
+        mem_copy(_flat_table_slot(table, idx), src, table->_slotSize);
+    }
+
+    table->_size = old._size;
+    _flat_table_free(&old, alloc);
+    return true;
+}
+
+/*
+ * Claims the slot for a key that is not in the table yet, growing first when
+ * one more entry would exceed the load factor. The caller fills the slot.
+ * Returns NULL when growing fails.
+ */
+static inline void *_flat_table_insert(_FlatTable *table, Allocator *alloc, u64 hash, _FlatTableSlotHashFn slotHash, const void *ctx)
+{
+    if ((table->_size + 1) * _X_FLATMAP_LOAD_FACTOR_DEN > table->_capacity * _X_FLATMAP_LOAD_FACTOR_NUM)
+    {
+        if (!_flat_table_grow(table, alloc, table->_capacity * 2, slotHash, ctx))
+            return NULL;
+    }
+
+    u64 idx = _flat_table_find_empty(table, hash);
+    _flat_table_set_ctrl(table, idx, _flat_table_tag(hash));
+    table->_size += 1;
+    return _flat_table_slot(table, idx);
+}
+
+/*
+ * Empties slot `hole` and shifts entries of the same probe run back into it:
+ * an entry may fill the hole when the hole lies between its home and itself.
+ * Lookups stay as short as if the removed key had never been inserted.
+ */
+static inline void _flat_table_erase(_FlatTable *table, u64 hole, _FlatTableSlotHashFn slotHash, const void *ctx)
+{
+    u64 mask = table->_capacity - 1;
+    for (u64 idx = (hole + 1) & mask; !(table->_ctrl[idx] & _X_FLATMAP_EMPTY); idx = (idx + 1) & mask)
+    {
+        void *entry = _flat_table_slot(table, idx);
+        u64 home = _flat_table_home(table, slotHash(entry, ctx));
+
+        if (((idx - home) & mask) < ((idx - hole) & mask))
+            continue;
+
+        _flat_table_set_ctrl(table, hole, table->_ctrl[idx]);
+        mem_copy(_flat_table_slot(table, hole), entry, table->_slotSize);
+        hole = idx;
+    }
+
+    _flat_table_set_ctrl(table, hole, _X_FLATMAP_EMPTY);
+    table->_size -= 1;
+}
+
+// Keys up to this size are stored inside the slot, longer ones in their own allocation
+#define _X_FLATMAP_INLINE_KEY_SIZE 16u
+
+typedef struct _flat_hashmap_slot
+{
+    u64 _hash;
+    u64 _keySize;
+    union
+    {
+        i8 *ptr;                              // keys longer than _X_FLATMAP_INLINE_KEY_SIZE
+        i8 bytes[_X_FLATMAP_INLINE_KEY_SIZE]; // shorter keys, moved along with the slot
+    } _key;
+    // Value bytes follow
+} _FlatHashMapSlot;
+
+typedef struct _flat_hashmap
+{
+    _FlatTable _table;
+    u64 _valueSize;
+    u64 _seed;
+    Allocator _allocator;
+} FlatHashMap;
+
+result_define(FlatHashMap, FlatHashMap);
+
+static inline u64 _flat_hashmap_hash(FlatHashMap *map, Buffer key)
+{
+    return hash_wy(key.bytes, key.size, map->_seed);
+}
+
+static inline void *_flat_hashmap_slot_value(_FlatHashMapSlot *slot)
+{
+    return (i8 *)slot + sizeof(_FlatHashMapSlot);
+}
+
+// Only valid until the slot moves, inline keys move with it
+static inline Buffer _flat_hashmap_slot_key(const _FlatHashMapSlot *slot)
+{
+    i8 *bytes = slot->_keySize > _X_FLATMAP_INLINE_KEY_SIZE ? slot->_key.ptr : (i8 *)slot->_key.bytes;
+    return (Buffer){.bytes = bytes, .size = slot->_keySize};
+}
+
+static inline Bool _flat_hashmap_slot_store_key(FlatHashMap *map, _FlatHashMapSlot *slot, Buffer key)
+{
+    slot->_keySize = key.size;
+    if (key.size <= _X_FLATMAP_INLINE_KEY_SIZE)
+    {
+        if (key.size)
+            mem_copy(slot->_key.bytes, key.bytes, key.size);
+        return true;
+    }
+
+    Allocator *alloc = &map->_allocator;
+    slot->_key.ptr = (i8 *)alloc->alloc(alloc, key.size);
+    if (!slot->_key.ptr)
+        return false;
+
+    mem_copy(slot->_key.ptr, key.bytes, key.size);
+    return true;
+}
+
+static inline void _flat_hashmap_slot_free_key(FlatHashMap *map, _FlatHashMapSlot *slot)
+{
+    if (slot->_keySize > _X_FLATMAP_INLINE_KEY_SIZE)
+        allocator_free_sized(&map->_allocator, slot->_key.ptr, slot->_keySize);
+}
+
+// Slots keep their full hash, moving them never rehashes the key
+static inline u64 _flat_hashmap_slot_hash(const void *slot, const void *ctx)
+{
+    (void)ctx;
+    return ((const _FlatHashMapSlot *)slot)->_hash;
+}
+
+static inline Bool _flat_hashmap_key_eq(const void *slot, const void *key, u64 hash, const void *ctx)
+{
+    (void)ctx;
+    const _FlatHashMapSlot *s = (const _FlatHashMapSlot *)slot;
+    return s->_hash == hash && _hashmap_key_equals(_flat_hashmap_slot_key(s), *(const Buffer *)key);
+}
+
+static inline _FlatHashMapSlot *_flat_hashmap_find(FlatHashMap *map, Buffer key, u64 hash, u64 *outIdx)
+{
+    return (_FlatHashMapSlot *)_flat_table_find(&map->_table, &key, hash, _flat_hashmap_key_eq, map, outIdx);
+}
+
+/**
+ * @brief Creates an open-addressing HashMap. Entries are stored inline in a
+ * single flat slot array, lookups compare the 7-bit tags of a whole group of
+ * slots at once (16 with SSE2/NEON, 8 otherwise) before touching any key.
+ * Keys of up to 16 bytes live in the slot as well, longer keys are copied to
+ * their own allocation.
+ *
+ * Same API as `HashMap`. Removal shifts the following entries back, so the
+ * table never accumulates tombstones. Setting or removing a key may move other
+ * entries, do not keep pointers into the map across those calls.
+ *
+ * Prefer `FlatHashMapInitT` for a type safe alternative.
+ *
+ * ```c
+ * ResFlatHashMap mapRes = flat_hashmap_init(&c_alloc, sizeof(u64), 16);
+ * if (mapRes.isErr) // Error!
+ * FlatHashMap map = mapRes.value;
+ * u64 value = 52;
+ * Error err = flat_hashmap_set_str(&map, "key", &value);
+ * if (err.code != ERR_OK) // Error!
+ * u64 outVal;
+ * err = flat_hashmap_get_str(&map, "key", &outVal);
+ * // outVal == 52
+ * flat_hashmap_deinit(&map);
+ * ```
+ *
+ * @param alloc
+ * @param valueByteSize
+ * @param initialAllocCount number of entries to reserve room for
+ * @return ResFlatHashMap
+ * @exception ERR_INVALID_PARAMETER, ERR_OUT_OF_MEMORY
+ */
+static inline result_type(FlatHashMap) flat_hashmap_init(Allocator *alloc, u64 valueByteSize, u64 initialAllocCount)
+{
+    if (!alloc || valueByteSize == 0)
+        return result_err(FlatHashMap, X_ERR_EXT("hashmap_flat", "flat_hashmap_init", ERR_INVALID_PARAMETER, "null or invalid arg"));
+
+    FlatHashMap map = {0};
+    map._table._slotSize = (sizeof(_FlatHashMapSlot) + valueByteSize + 7u) & ~(u64)7u;
+    map._valueSize = valueByteSize;
+    map._seed = hash_random_seed();
+    map._allocator = *alloc;
+
+    if (!_flat_table_alloc(&map._table, &map._allocator, _flat_table_capacity_for(initialAllocCount)))
+        return result_err(FlatHashMap, X_ERR_EXT("hashmap_flat", "flat_hashmap_init", ERR_OUT_OF_MEMORY, "alloc failure"));
+
+    return result_ok(FlatHashMap, map);
+}
+
+/**
+ * @brief Type safe variant of `flat_hashmap_init`
+ *
+ * ```c
+ * ResFlatHashMap mapRes = FlatHashMapInitT(u64, &c_alloc);
+ * if (mapRes.isErr) // Error!
+ * FlatHashMap map = mapRes.value;
+ * ```
+ */
+#define FlatHashMapInitT(T, allocPtr) flat_hashmap_init((allocPtr), sizeof(T), _X_FLATMAP_MIN_CAPACITY)
+
+/**
+ * @brief Frees the memory allocated for the FlatHashMap.
+ *
+ * Invalidates the FlatHashMap, usage of it after call to this function is undefined behavior.
+ *
+ * @param map
+ */
+static inline void flat_hashmap_deinit(FlatHashMap *map)
+{
+    if (!map || !map->_table._ctrl)
+        return;
+
+    _FlatTable *table = &map->_table;
+    for (u64 i = 0; i < table->_capacity; ++i)
+    {
+        if (table->_ctrl[i] & _X_FLATMAP_EMPTY)
+            continue;
+
+        _flat_hashmap_slot_free_key(map, (_FlatHashMapSlot *)_flat_table_slot(table, i));
+    }
+
+    _flat_table_free(table, &map->_allocator);
+    *map = (FlatHashMap){0};
+}
+
+/**
+ * @brief Sets or overwrites value for provided `key` of type `Buffer`
+ *
+ * @param map
+ * @param key
+ * @param value
+ * @return Error
+ * @exception ERR_INVALID_PARAMETER, ERR_OUT_OF_MEMORY
+ */
+static inline Error flat_hashmap_set(FlatHashMap *map, Buffer key, const void *value)
+{
+    if (!map || !map->_table._ctrl)
+        return X_ERR_EXT("hashmap_flat", "flat_hashmap_set", ERR_INVALID_PARAMETER, "null or invalid arg");
+
+    if (key.size > 0 && !key.bytes)
+        return X_ERR_EXT("hashmap_flat", "flat_hashmap_set", ERR_INVALID_PARAMETER, "null key buffer");
+
+    if (!value)
+        return X_ERR_EXT("hashmap_flat", "flat_hashmap_set", ERR_INVALID_PARAMETER, "null value buffer");
+
+    u64 hash = _flat_hashmap_hash(map, key);
+
+    _FlatHashMapSlot *slot = _flat_hashmap_find(map, key, hash, NULL);
+    if (slot)
+    {
+        mem_copy(_flat_hashmap_slot_value(slot), value, map->_valueSize);
+        return X_ERR_OK;
+    }
+
+    // Copy the key before claiming a slot, the table has nothing to undo if that fails
+    _FlatHashMapSlot entry = {._hash = hash};
+    if (!_flat_hashmap_slot_store_key(map, &entry, key))
+        return X_ERR_EXT("hashmap_flat", "flat_hashmap_set", ERR_OUT_OF_MEMORY, "alloc failure");
+
+    slot = (_FlatHashMapSlot *)_flat_table_insert(&map->_table, &map->_allocator, hash, _flat_hashmap_slot_hash, map);
+    if (!slot)
+    {
+        _flat_hashmap_slot_free_key(map, &entry);
+        return X_ERR_EXT("hashmap_flat", "flat_hashmap_set", ERR_OUT_OF_MEMORY, "alloc failure");
+    }
+
+    mem_copy(slot, &entry, sizeof(entry));
+    mem_copy(_flat_hashmap_slot_value(slot), value, map->_valueSize);
+    return X_ERR_OK;
+}
+
+#define FlatHashMapSetBuffT(T, mapPtr, keyBuff, valPtr) \
+    { \
+        T *mapItemTypeCheck = (valPtr); \
+        (void)mapItemTypeCheck; \
+        flat_hashmap_set((mapPtr), (keyBuff), (valPtr)); \
+    }
+
+/**
+ * @brief Sets or overwrites value for provided `key` of type `String`
+ *
+ * @param map
+ * @param key
+ * @param value
+ * @return Error
+ */
+static inline Error flat_hashmap_set_str(FlatHashMap *map, ConstStr key, const void *value)
+{
+    if (!key)
+        return X_ERR_EXT("hashmap_flat", "flat_hashmap_set_str", ERR_INVALID_PARAMETER, "null key");
+
+    Buffer keyBuff = {.bytes = (i8 *)key, .size = string_size(key)};
+    return flat_hashmap_set(map, keyBuff, value);
+}
+
+#define FlatHashMapSetStrT(T, mapPtr, keyStr, valPtr) \
+    { \
+        T *mapItemTypeCheck = (valPtr); \
+        (void)mapItemTypeCheck; \
+        flat_hashmap_set_str((mapPtr), (keyStr), (valPtr)); \
+    }
+
+/**
+ * @brief Fetches a value from a provided `key` of type `Buffer`
+ *
+ * If the map does not contain a value for the provided key, will return the Error ERR_RANGE_ERROR
+ *
+ * @param map
+ * @param key
+ * @param outValue may be NULL to only test for the key
+ * @return Error
+ */
+static inline Error flat_hashmap_get(FlatHashMap *map, Buffer key, void *outValue)
+{
+    if (!map || !map->_table._ctrl)
+        return X_ERR_EXT("hashmap_flat", "flat_hashmap_get", ERR_INVALID_PARAMETER, "null or invalid arg");
+
+    if (key.size > 0 && !key.bytes)
+        return X_ERR_EXT("hashmap_flat", "flat_hashmap_get", ERR_INVALID_PARAMETER, "null key buffer");
+
+    _FlatHashMapSlot *slot = _flat_hashmap_find(map, key, _flat_hashmap_hash(map, key), NULL);
+    if (!slot)
+        return X_ERR_EXT("hashmap_flat", "flat_hashmap_get", ERR_RANGE_ERROR, "inexistent key");
+
+    if (outValue)
+        mem_copy(outValue, _flat_hashmap_slot_value(slot), map->_valueSize);
+
+    return X_ERR_OK;
+}
+
+#define FlatHashMapGetBuffT(T, mapPtr, keyBuff, outPtr) \
+    { \
+        T *mapItemTypeCheck = (outPtr); \
+        (void)mapItemTypeCheck; \
+        flat_hashmap_get((mapPtr), (keyBuff), (outPtr)); \
+    }
+
+/**
+ * @brief Fetches a value from a provided `key` of type `String`
+ *
+ * Prefer `FlatHashMapGetStrT` as a type safe alternative.
+ *
+ * @param map
+ * @param key
+ * @param outValue
+ * @return Error
+ */
+static inline Error flat_hashmap_get_str(FlatHashMap *map, ConstStr key, void *outValue)
+{
+    Buffer keyBuff = {.bytes = (i8 *)key, .size = string_size(key)};
+    return flat_hashmap_get(map, keyBuff, outValue);
+}
+
+#define FlatHashMapGetStrT(T, mapPtr, keyStr, outPtr) \
+    { \
+        T *mapItemTypeCheck = (outPtr); \
+        (void)mapItemTypeCheck; \
+        flat_hashmap_get_str((mapPtr), (keyStr), (outPtr)); \
+    }
+
+/**
+ * @brief Removes a value associated with the provided key of type `Buffer`
+ *
+ * Entries of the same probe run are shifted back into the freed slot, lookups
+ * stay as short as if the removed key had never been inserted.
+ *
+ * @param map
+ * @param key
+ * @return Error
+ */
+static inline Error flat_hashmap_remove(FlatHashMap *map, Buffer key)
+{
+    if (!map || !map->_table._ctrl)
+        return X_ERR_EXT("hashmap_flat", "flat_hashmap_remove", ERR_INVALID_PARAMETER, "null or invalid arg");
+
+    if (key.size > 0 && !key.bytes)
+        return X_ERR_EXT("hashmap_flat", "flat_hashmap_remove", ERR_INVALID_PARAMETER, "null key buffer");
+
+    u64 hole;
+    _FlatHashMapSlot *slot = _flat_hashmap_find(map, key, _flat_hashmap_hash(map, key), &hole);
+    if (!slot)
+        return X_ERR_EXT("hashmap_flat", "flat_hashmap_remove", ERR_RANGE_ERROR, "inexistent key");
+
+    _flat_hashmap_slot_free_key(map, slot);
+    _flat_table_erase(&map->_table, hole, _flat_hashmap_slot_hash, map);
+    return X_ERR_OK;
+}
+
+/**
+ * @brief Removes a value associated with the provided key of type `String`
+ *
+ * @param map
+ * @param key
+ * @return Error
+ */
+static inline Error flat_hashmap_remove_str(FlatHashMap *map, ConstStr key)
+{
+    Buffer keyBuff = {.bytes = (i8 *)key, .size = string_size(key)};
+    return flat_hashmap_remove(map, keyBuff);
+}
+
+/**
+ * @brief Calls a function for each key-value pairs in the map. `func` must not
+ * set or remove keys.
+ *
+ * @param map
+ * @param func
+ * @param userArg
+ */
+static inline void flat_hashmap_for_each(FlatHashMap *map, void (*func)(Buffer key, void *value, void *userArg), void *userArg)
+{
+    if (!map || !map->_table._ctrl || !func)
+        return;
+
+    // Capacity is a multiple of the group width, skip empty groups whole
+    _FlatTable *table = &map->_table;
+    for (u64 pos = 0; pos < table->_capacity; pos += _X_FLATMAP_GROUP_WIDTH)
+    {
+        _FlatMapMask full = ~_flatmap_group_empty(table->_ctrl + pos) & _X_FLATMAP_MASK_ALL;
+        while (full)
+        {
+            _FlatHashMapSlot *slot = (_FlatHashMapSlot *)_flat_table_slot(table, pos + _flatmap_mask_lowest(full));
+            full &= full - 1;
+
+            func(_flat_hashmap_slot_key(slot), _flat_hashmap_slot_value(slot), userArg);
+        }
+    }
+}
+
+/**
+ * @brief Returns the count of key-value pairs in the map.
+ *
+ * @param map
+ * @return u64
+ */
+static inline u64 flat_hashmap_size(FlatHashMap *map)
+{
+    if (!map)
+        return 0;
+
+    return map->_table._size;
+}
@@ -0,0 +1,306 @@
+#pragma once
+
+// Open-addressing hash map keyed by u64 IDs or pointers, keys live inline in
+// the slots. The table, probing, growth and removal are `FlatHashMap`'s
+// `_flat_table_*` helpers
+
+#include "xstd_core.h"
+#include "xstd_alloc.h"
+#include "xstd_result.h"
+#include "xstd_error.h"
+#include "xstd_mem.h"
+#include "xstd_hash.h"
+#include "xstd_hashmap_flat.h"
+
+typedef struct _u64_hashmap
+{
+    _FlatTable _table;
+    u64 _valueSize;
+    u64 _seed;
+    Allocator _allocator;
+} U64HashMap;
+
+result_define(U64HashMap, U64HashMap);
+
+// Slots are the key followed by the value, padded to 8 bytes
+static inline void *_u64_hashmap_slot_value(u64 *slot)
+{
+    return slot + 1;
+}
+
+// Slots only keep the key, moving one hashes it again
+static inline u64 _u64_hashmap_slot_hash(const void *slot, const void *ctx)
+{
+    return hash_u64(*(const u64 *)slot, ((const U64HashMap *)ctx)->_seed);
+}
+
+static inline Bool _u64_hashmap_key_eq(const void *slot, const void *key, u64 hash, const void *ctx)
+{
+    (void)hash;
+    (void)ctx;
+    return *(const u64 *)slot == *(const u64 *)key;
+}
+
+static inline u64 *_u64_hashmap_find(U64HashMap *map, u64 key, u64 hash, u64 *outIdx)
+{
+    return (u64 *)_flat_table_find(&map->_table, &key, hash, _u64_hashmap_key_eq, map, outIdx);
+}
+
+/**
+ * @brief Creates a HashMap keyed by u64 values, such as IDs or pointers.
+ *
+ * Keys are stored inline next to their value: no per-key allocation, hashing
+ * is a single integer mix and comparisons are integer compares. Same layout
+ * and probing as `FlatHashMap`, removal shifts entries back so setting or
+ * removing keys may move other values.
+ *
+ * Prefer `U64HashMapInitT` for a type safe alternative.
+ *
+ * ```c
+ * ResU64HashMap mapRes = u64_hashmap_init(&c_alloc, sizeof(Entity), 1024);
+ * if (mapRes.isErr) // Error!
+ * U64HashMap map = mapRes.value;
+ * Error err = u64_hashmap_set(&map, entity.id, &entity);
+ * if (err.code != ERR_OK) // Error!
+ * Entity out;
+ * err = u64_hashmap_get(&map, entity.id, &out);
+ * u64_hashmap_deinit(&map);
+ * ```
+ *
+ * @param alloc
+ * @param valueByteSize
+ * @param initialAllocCount number of entries to reserve room for
+ * @return ResU64HashMap
+ * @exception ERR_INVALID_PARAMETER, ERR_OUT_OF_MEMORY
+ */
+static inline result_type(U64HashMap) u64_hashmap_init(Allocator *alloc, u64 valueByteSize, u64 initialAllocCount)
+{
+    if (!alloc || valueByteSize == 0)
+        return result_err(U64HashMap, X_ERR_EXT("hashmap_u64", "u64_hashmap_init", ERR_INVALID_PARAMETER, "null or invalid arg"));
+
+    U64HashMap map = {0};
+    map._table._slotSize = sizeof(u64) + ((valueByteSize + 7u) & ~(u64)7u);
+    map._valueSize = valueByteSize;
+    map._seed = hash_random_seed();
+    map._allocator = *alloc;
+
+    if (!_flat_table_alloc(&map._table, &map._allocator, _flat_table_capacity_for(initialAllocCount)))
+        return result_err(U64HashMap, X_ERR_EXT("hashmap_u64", "u64_hashmap_init", ERR_OUT_OF_MEMORY, "alloc failure"));
+
+    return result_ok(U64HashMap, map);
+}
+
+/**
+ * @brief Type safe variant of `u64_hashmap_init`
+ *
+ * ```c
+ * ResU64HashMap mapRes = U64HashMapInitT(Entity, &c_alloc);
+ * if (mapRes.isErr) // Error!
+ * U64HashMap map = mapRes.value;
+ * ```
+ */
+#define U64HashMapInitT(T, allocPtr) u64_hashmap_init((allocPtr), sizeof(T), _X_FLATMAP_MIN_CAPACITY)
+
+/**
+ * @brief Frees the memory allocated for the U64HashMap.
+ *
+ * Invalidates the U64HashMap, usage of it after call to this function is undefined behavior.
+ *
+ * @param map
+ */
+static inline void u64_hashmap_deinit(U64HashMap *map)
+{
+    if (!map || !map->_table._ctrl)
+        return;
+
+    _flat_table_free(&map->_table, &map->_allocator);
+    *map = (U64HashMap){0};
+}
+
+/**
+ * @brief Sets or overwrites value for provided `key`
+ *
+ * @param map
+ * @param key
+ * @param value
+ * @return Error
+ * @exception ERR_INVALID_PARAMETER, ERR_OUT_OF_MEMORY
+ */
+static inline Error u64_hashmap_set(U64HashMap *map, u64 key, const void *value)
+{
+    if (!map || !map->_table._ctrl || !value)
+        return X_ERR_EXT("hashmap_u64", "u64_hashmap_set", ERR_INVALID_PARAMETER, "null or invalid arg");
+
+    u64 hash = hash_u64(key, map->_seed);
+
+    u64 *slot = _u64_hashmap_find(map, key, hash, NULL);
+    if (slot)
+    {
+        mem_copy(_u64_hashmap_slot_value(slot), value, map->_valueSize);
+        return X_ERR_OK;
+    }
+
+    slot = (u64 *)_flat_table_insert(&map->_table, &map->_allocator, hash, _u64_hashmap_slot_hash, map);
+    if (!slot)
+        return X_ERR_EXT("hashmap_u64", "u64_hashmap_set", ERR_OUT_OF_MEMORY, "alloc failure");
+
+    *slot = key;
+    mem_copy(_u64_hashmap_slot_value(slot), value, map->_valueSize);
+    return X_ERR_OK;
+}
+
+#define U64HashMapSetT(T, mapPtr, key, valPtr) \
+    { \
+        T *mapItemTypeCheck = (valPtr); \
+        (void)mapItemTypeCheck; \
+        u64_hashmap_set((mapPtr), (key), (valPtr)); \
+    }
+
+/**
+ * @brief Sets or overwrites value for provided pointer `key`. Only the address
+ * is used, the pointed memory is never read.
+ *
+ * @param map
+ * @param key
+ * @param value
+ * @return Error
+ */
+static inline Error u64_hashmap_set_ptr(U64HashMap *map, const void *key, const void *value)
+{
+    return u64_hashmap_set(map, (u64)(uPtr)key, value);
+}
+
+/**
+ * @brief Fetches a value from a provided `key`
+ *
+ * If the map does not contain a value for the provided key, will return the Error ERR_RANGE_ERROR
+ *
+ * @param map
+ * @param key
+ * @param outValue may be NULL to only test for the key
+ * @return Error
+ */
+static inline Error u64_hashmap_get(U64HashMap *map, u64 key, void *outValue)
+{
+    if (!map || !map->_table._ctrl)
+        return X_ERR_EXT("hashmap_u64", "u64_hashmap_get", ERR_INVALID_PARAMETER, "null or invalid arg");
+
+    u64 *slot = _u64_hashmap_find(map, key, hash_u64(key, map->_seed), NULL);
+    if (!slot)
+        return X_ERR_EXT("hashmap_u64", "u64_hashmap_get", ERR_RANGE_ERROR, "inexistent key");
+
+    if (outValue)
+        mem_copy(outValue, _u64_hashmap_slot_value(slot), map->_valueSize);
+
+    return X_ERR_OK;
+}
+
+#define U64HashMapGetT(T, mapPtr, key, outPtr) \
+    { \
+        T *mapItemTypeCheck = (outPtr); \
+        (void)mapItemTypeCheck; \
+        u64_hashmap_get((mapPtr), (key), (outPtr)); \
+    }
+
+/**
+ * @brief Fetches a value from a provided pointer `key`
+ *
+ * @param map
+ * @param key
+ * @param outValue
+ * @return Error
+ */
+static inline Error u64_hashmap_get_ptr(U64HashMap *map, const void *key, void *outValue)
+{
+    return u64_hashmap_get(map, (u64)(uPtr)key, outValue);
+}
+
+/**
+ * @brief Returns a pointer to the value stored for `key`, NULL when absent.
+ * Valid until the next set or remove.
+ *
+ * @param map
+ * @param key
+ * @return void*
+ */
+static inline void *u64_hashmap_getref(U64HashMap *map, u64 key)
+{
+    if (!map || !map->_table._ctrl)
+        return NULL;
+
+    u64 *slot = _u64_hashmap_find(map, key, hash_u64(key, map->_seed), NULL);
+    return slot ? _u64_hashmap_slot_value(slot) : NULL;
+}
+
+/**
+ * @brief Removes a value associated with the provided `key`
+ *
+ * @param map
+ * @param key
+ * @return Error
+ */
+static inline Error u64_hashmap_remove(U64HashMap *map, u64 key)
+{
+    if (!map || !map->_table._ctrl)
+        return X_ERR_EXT("hashmap_u64", "u64_hashmap_remove", ERR_INVALID_PARAMETER, "null or invalid arg");
+
+    u64 hole;
+    if (!_u64_hashmap_find(map, key, hash_u64(key, map->_seed), &hole))
+        return X_ERR_EXT("hashmap_u64", "u64_hashmap_remove", ERR_RANGE_ERROR, "inexistent key");
+
+    _flat_table_erase(&map->_table, hole, _u64_hashmap_slot_hash, map);
+    return X_ERR_OK;
+}
+
+/**
+ * @brief Removes a value associated with the provided pointer `key`
+ *
+ * @param map
+ * @param key
+ * @return Error
+ */
+static inline Error u64_hashmap_remove_ptr(U64HashMap *map, const void *key)
+{
+    return u64_hashmap_remove(map, (u64)(uPtr)key);
+}
+
+/**
+ * @brief Calls a function for each key-value pairs in the map. `func` must not
+ * set or remove keys.
+ *
+ * @param map
+ * @param func
+ * @param userArg
+ */
+static inline void u64_hashmap_for_each(U64HashMap *map, void (*func)(u64 key, void *value, void *userArg), void *userArg)
+{
+    if (!map || !map->_table._ctrl || !func)
+        return;
+
+    _FlatTable *table = &map->_table;
+    for (u64 pos = 0; pos < table->_capacity; pos += _X_FLATMAP_GROUP_WIDTH)
+    {
+        _FlatMapMask full = ~_flatmap_group_empty(table->_ctrl + pos) & _X_FLATMAP_MASK_ALL;
+        while (full)
+        {
+            u64 *slot = (u64 *)_flat_table_slot(table, pos + _flatmap_mask_lowest(full));
+            full &= full - 1;
+
+            func(*slot, _u64_hashmap_slot_value(slot), userArg);
+        }
+    }
+}
+
+/**
+ * @brief Returns the count of key-value pairs in the map.
+ *
+ * @param map
+ * @return u64
+ */
+static inline u64 u64_hashmap_size(U64HashMap *map)
+{
+    if (!map)
+        return 0;
+
+    return map->_table._size;
+}
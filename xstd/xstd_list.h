@@ -91,7 +91,7 @@ static inline void list_deinit(List *list)
     if (!list->_data)
         return;
 
-    list->_allocator.free(&list->_allocator, list->_data);
+    allocator_free_sized(&list->_allocator, list->_data, list->_allocCnt * list->_typeSize);
 }
 
 /**
@@ -121,6 +121,14 @@ static inline Error _list_expand(List *l)
     if (!l || !l->_data)
         return X_ERR_EXT("list", "_list_expand", ERR_INVALID_PARAMETER, "null list");
 
+    // Use slack left by the allocator before reallocating
+    u64 usableCnt = allocator_usable_size(&l->_allocator, l->_data, l->_allocCnt * l->_typeSize) / l->_typeSize;
+    if (usableCnt > l->_allocCnt)
+    {
+        l->_allocCnt = usableCnt;
+        return X_ERR_OK;
+    }
+
     if (l->_allocCnt >= ((u64)-1) / 2)
         return X_ERR_EXT("list", "_list_expand", ERR_WOULD_OVERFLOW, "capacity overflow");
 
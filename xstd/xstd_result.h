@@ -3,7 +3,8 @@
 #include "xstd_core.h"
 #include "xstd_error.h"
 
-typedef union {
+// Common leading fields of every result type, lets any `Res<Alias>*` be read as `Res*`
+typedef struct {
     Bool isErr;
     Error err;
 } Res;
@@ -0,0 +1,429 @@
+#pragma once
+
+#include "xstd_core.h"
+#include "xstd_alloc.h"
+#include "xstd_result.h"
+#include "xstd_mem.h"
+
+// Stable reference to an item of a `SlotMap`: slot index in the low 32 bits,
+// slot generation in the high 32 bits. 0 is never a valid handle.
+typedef u64 SlotHandle;
+
+#define SLOTMAP_NULL_HANDLE ((SlotHandle)0)
+
+typedef struct _slotmap_slot
+{
+    u32 index;      // position of the item in the dense array, or next free slot
+    u32 generation; // odd while the slot holds an item, bumped on every insertion and removal
+} _SlotMapSlot;
+
+typedef struct _slotmap
+{
+    void *_data;         // items, packed without holes
+    u32 *_denseToSlot;   // slot of each item of `_data`
+    _SlotMapSlot *_slots;
+    u64 _allocCnt;       // capacity of all three arrays
+    u64 _typeSize;
+    u64 _itemCnt;
+    u64 _slotCnt;        // slots ever handed out
+    u32 _freeHead;       // first free slot, _X_SLOTMAP_NO_SLOT if none
+    Allocator _allocator;
+} SlotMap;
+
+result_define(SlotMap, SlotMap);
+
+#define _X_SLOTMAP_INIT_SIZE 8
+#define _X_SLOTMAP_NO_SLOT 0xFFFFFFFFu
+
+static inline SlotHandle _slotmap_handle(u32 slot, u32 generation)
+{
+    return ((u64)generation << 32) | slot;
+}
+
+static inline void *_slotmap_i_to_ptr(SlotMap *map, u64 i)
+{
+    return ((i8 *)map->_data) + map->_typeSize * i;
+}
+
+// Returns the slot of a live handle, NULL if the handle is stale or invalid
+static inline _SlotMapSlot *_slotmap_slot(SlotMap *map, SlotHandle handle)
+{
+    u32 slot = (u32)handle;
+    u32 generation = (u32)(handle >> 32);
+
+    // Even generations belong to free slots
+    if (slot >= map->_slotCnt || !(generation & 1u))
+        return NULL;
+
+    _SlotMapSlot *s = &map->_slots[slot];
+    return s->generation == generation ? s : NULL;
+}
+
+/**
+ * @brief Create a slot map: a pool of items addressed by generational handles.
+ *
+ * Insertion and removal are O(1). Items are kept packed in a single array, so
+ * iterating over them is as fast as over a `List`. Unlike pointers into a
+ * `List`, handles stay valid while the map grows, and a handle to a removed
+ * item is detected instead of silently reading its replacement.
+ *
+ * ```c
+ * ResSlotMap res = slotmap_init(default_allocator(), sizeof(Entity), 64);
+ * if (res.isErr) // Error!
+ * SlotMap map = res.value;
+ * ```
+ * @param alloc
+ * @param itemByteSize Size of the type of the items
+ * @param initialAllocSize
+ * @return ResSlotMap
+ * @exception ERR_INVALID_PARAMETER, ERR_OUT_OF_MEMORY
+ */
+static inline result_type(SlotMap) slotmap_init(Allocator *alloc, u64 itemByteSize, u64 initialAllocSize)
+{
+    if (!alloc)
+        return result_err(SlotMap, X_ERR_EXT("slotmap", "slotmap_init", ERR_INVALID_PARAMETER, "null allocator"));
+
+    if (itemByteSize == 0)
+        return result_err(SlotMap, X_ERR_EXT("slotmap", "slotmap_init", ERR_INVALID_PARAMETER, "itemByteSize is zero"));
+
+    if (initialAllocSize < _X_SLOTMAP_INIT_SIZE)
+        initialAllocSize = _X_SLOTMAP_INIT_SIZE;
+
+    if (initialAllocSize > _X_SLOTMAP_NO_SLOT || initialAllocSize > ((u64)-1) / itemByteSize)
+        return result_err(SlotMap, X_ERR_EXT("slotmap", "slotmap_init", ERR_WOULD_OVERFLOW, "initialAllocSize too large"));
+
+    SlotMap map = {
+        ._data = NULL,
+        ._denseToSlot = NULL,
+        ._slots = NULL,
+        ._allocCnt = initialAllocSize,
+        ._typeSize = itemByteSize,
+        ._itemCnt = 0,
+        ._slotCnt = 0,
+        ._freeHead = _X_SLOTMAP_NO_SLOT,
+        ._allocator = *alloc,
+    };
+
+    map._data = alloc->alloc(alloc, initialAllocSize * itemByteSize);
+    map._denseToSlot = (u32 *)alloc->alloc(alloc, initialAllocSize * sizeof(u32));
+    map._slots = (_SlotMapSlot *)alloc->alloc(alloc, initialAllocSize * sizeof(_SlotMapSlot));
+
+    if (!map._data || !map._denseToSlot || !map._slots)
+    {
+        if (map._data)
+            alloc->free(alloc, map._data);
+        if (map._denseToSlot)
+            alloc->free(alloc, map._denseToSlot);
+        if (map._slots)
+            alloc->free(alloc, map._slots);
+        return result_err(SlotMap, X_ERR_EXT("slotmap", "slotmap_init", ERR_OUT_OF_MEMORY, "alloc failure"));
+    }
+
+    return result_ok(SlotMap, map);
+}
+
+/**
+ * @brief Create a slot map of items of type `T`.
+ *
+ * ```c
+ * ResSlotMap res = SlotMapInitT(Entity, default_allocator());
+ * ```
+ * @param T type of the items
+ * @param allocPtr
+ * @return ResSlotMap
+ */
+#define SlotMapInitT(T, allocPtr) slotmap_init((allocPtr), sizeof(T), 16)
+
+/**
+ * @brief Frees the memory allocated by the slot map.
+ *
+ * @param map
+ */
+static inline void slotmap_deinit(SlotMap *map)
+{
+    if (!map || !map->_data)
+        return;
+
+    Allocator *a = &map->_allocator;
+    allocator_free_sized(a, map->_data, map->_allocCnt * map->_typeSize);
+    allocator_free_sized(a, map->_denseToSlot, map->_allocCnt * sizeof(u32));
+    allocator_free_sized(a, map->_slots, map->_allocCnt * sizeof(_SlotMapSlot));
+
+    map->_data = NULL;
+    map->_denseToSlot = NULL;
+    map->_slots = NULL;
+    map->_itemCnt = 0;
+    map->_slotCnt = 0;
+}
+
+/**
+ * @brief Returns the amount of live items inside the slot map.
+ *
+ * @param map
+ * @return u64
+ */
+static inline u64 slotmap_size(SlotMap *map)
+{
+    if (!map)
+        return 0;
+
+    return map->_itemCnt;
+}
+
+static inline Error _slotmap_expand(SlotMap *map)
+{
+    if (map->_allocCnt >= _X_SLOTMAP_NO_SLOT / 2)
+        return X_ERR_EXT("slotmap", "_slotmap_expand", ERR_WOULD_OVERFLOW, "capacity overflow");
+
+    u64 newAllocCnt = map->_allocCnt * 2;
+    if (newAllocCnt > ((u64)-1) / map->_typeSize)
+        return X_ERR_EXT("slotmap", "_slotmap_expand", ERR_WOULD_OVERFLOW, "byte size overflow");
+
+    Allocator *a = &map->_allocator;
+
+    // Each array is committed as soon as it is grown, a later failure leaves
+    // some arrays larger than `_allocCnt`, which is harmless
+    void *data = a->realloc(a, map->_data, newAllocCnt * map->_typeSize);
+    if (!data)
+        return X_ERR_EXT("slotmap", "_slotmap_expand", ERR_OUT_OF_MEMORY, "realloc failure");
+    map->_data = data;
+
+    u32 *denseToSlot = (u32 *)a->realloc(a, map->_denseToSlot, newAllocCnt * sizeof(u32));
+    if (!denseToSlot)
+        return X_ERR_EXT("slotmap", "_slotmap_expand", ERR_OUT_OF_MEMORY, "realloc failure");
+    map->_denseToSlot = denseToSlot;
+
+    _SlotMapSlot *slots = (_SlotMapSlot *)a->realloc(a, map->_slots, newAllocCnt * sizeof(_SlotMapSlot));
+    if (!slots)
+        return X_ERR_EXT("slotmap", "_slotmap_expand", ERR_OUT_OF_MEMORY, "realloc failure");
+    map->_slots = slots;
+
+    map->_allocCnt = newAllocCnt;
+    return X_ERR_OK;
+}
+
+/**
+ * @brief Copies `item` into the slot map and writes its handle to `outHandle`.
+ *
+ * Handles of other items stay valid, pointers returned by `slotmap_getref()`
+ * and `slotmap_data()` may be invalidated.
+ *
+ * ```c
+ * SlotHandle h;
+ * Error err = slotmap_insert(&map, &entity, &h);
+ * if (err.code) // Error!
+ * ```
+ * @param map
+ * @param item Pointer to memory of size sizeof(ItemType)
+ * @param outHandle
+ * @return Error
+ * @exception ERR_INVALID_PARAMETER, ERR_OUT_OF_MEMORY, ERR_WOULD_OVERFLOW
+ */
+static inline Error slotmap_insert(SlotMap *map, const void *item, SlotHandle *outHandle)
+{
+    if (!map || !map->_data || !item || !outHandle)
+        return X_ERR_EXT("slotmap", "slotmap_insert", ERR_INVALID_PARAMETER, "null argument");
+
+    u32 slot = map->_freeHead;
+
+    if (slot == _X_SLOTMAP_NO_SLOT)
+    {
+        if (map->_slotCnt >= map->_allocCnt)
+        {
+            Error err = _slotmap_expand(map);
+            if (err.code != ERR_OK)
+                return err;
+        }
+
+        slot = (u32)map->_slotCnt++;
+        map->_slots[slot].generation = 1;
+    }
+    else
+    {
+        map->_freeHead = map->_slots[slot].index;
+        map->_slots[slot].generation += 1;
+    }
+
+    u64 dense = map->_itemCnt++;
+    mem_copy(_slotmap_i_to_ptr(map, dense), item, map->_typeSize);
+    map->_denseToSlot[dense] = slot;
+    map->_slots[slot].index = (u32)dense;
+
+    *outHandle = _slotmap_handle(slot, map->_slots[slot].generation);
+    return X_ERR_OK;
+}
+
+/**
+ * @brief Removes the item of `handle`, which becomes stale. The last item of
+ * the dense array is moved into the hole.
+ *
+ * @param map
+ * @param handle
+ * @return Error
+ * @exception ERR_INVALID_PARAMETER if the handle is stale
+ */
+static inline Error slotmap_remove(SlotMap *map, SlotHandle handle)
+{
+    if (!map || !map->_data)
+        return X_ERR_EXT("slotmap", "slotmap_remove", ERR_INVALID_PARAMETER, "null map");
+
+    _SlotMapSlot *s = _slotmap_slot(map, handle);
+    if (!s)
+        return X_ERR_EXT("slotmap", "slotmap_remove", ERR_INVALID_PARAMETER, "stale handle");
+
+    u64 dense = s->index;
+    u64 last = --map->_itemCnt;
+
+    if (dense != last)
+    {
+        mem_copy(_slotmap_i_to_ptr(map, dense), _slotmap_i_to_ptr(map, last), map->_typeSize);
+        u32 movedSlot = map->_denseToSlot[last];
+        map->_denseToSlot[dense] = movedSlot;
+        map->_slots[movedSlot].index = (u32)dense;
+    }
+
+    // Free slots have even generations, wrapping around to 0 keeps live
+    // generations odd so that no handle is ever 0
+    s->generation += 1;
+
+    u32 slot = (u32)handle;
+    s->index = map->_freeHead;
+    map->_freeHead = slot;
+    return X_ERR_OK;
+}
+
+/**
+ * @brief Returns true if `handle` refers to a live item.
+ *
+ * @param map
+ * @param handle
+ * @return Bool
+ */
+static inline Bool slotmap_contains(SlotMap *map, SlotHandle handle)
+{
+    if (!map || !map->_data)
+        return false;
+
+    return _slotmap_slot(map, handle) != NULL;
+}
+
+/**
+ * @brief Get pointer to the item of `handle`, NULL if the handle is stale.
+ * The pointer is invalidated by the next insertion or removal.
+ *
+ * @param map
+ * @param handle
+ * @return void*
+ */
+static inline void *slotmap_getref(SlotMap *map, SlotHandle handle)
+{
+    if (!map || !map->_data)
+        return NULL;
+
+    _SlotMapSlot *s = _slotmap_slot(map, handle);
+    return s ? _slotmap_i_to_ptr(map, s->index) : NULL;
+}
+
+/**
+ * @brief Writes the item of `handle` to `out`.
+ *
+ * @param map
+ * @param handle
+ * @param out Pointer to memory of size sizeof(ItemType)
+ * @return Error
+ * @exception ERR_INVALID_PARAMETER if the handle is stale
+ */
+static inline Error slotmap_get(SlotMap *map, SlotHandle handle, void *out)
+{
+    if (!map || !out)
+        return X_ERR_EXT("slotmap", "slotmap_get", ERR_INVALID_PARAMETER, "null argument");
+
+    void *ptr = slotmap_getref(map, handle);
+    if (!ptr)
+        return X_ERR_EXT("slotmap", "slotmap_get", ERR_INVALID_PARAMETER, "stale handle");
+
+    mem_copy(out, ptr, map->_typeSize);
+    return X_ERR_OK;
+}
+
+/**
+ * @brief Type checked version of `slotmap_get()`
+ *
+ * @param T type of the items
+ * @param mapPtr
+ * @param handle
+ * @param outPtr
+ */
+#define SlotMapGetT(T, mapPtr, handle, outPtr) \
+    {                                          \
+        T *slotMapItemTypeCheck = (outPtr);    \
+        (void)slotMapItemTypeCheck;            \
+        slotmap_get((mapPtr), (handle), (outPtr)); \
+    }
+
+/**
+ * @brief Returns the packed array of live items, `slotmap_size()` long, in no
+ * particular order. Invalidated by the next insertion or removal.
+ *
+ * ```c
+ * Entity *entities = (Entity *)slotmap_data(&map);
+ * for (u64 i = 0; i < slotmap_size(&map); ++i)
+ *     update(&entities[i]);
+ * ```
+ * @param map
+ * @return void*
+ */
+static inline void *slotmap_data(SlotMap *map)
+{
+    if (!map)
+        return NULL;
+
+    return map->_data;
+}
+
+/**
+ * @brief Returns the handle of the item at position `i` of `slotmap_data()`.
+ *
+ * @param map
+ * @param i
+ * @return SlotHandle SLOTMAP_NULL_HANDLE if `i` is out of range
+ */
+static inline SlotHandle slotmap_handle_at(SlotMap *map, u64 i)
+{
+    if (!map || i >= map->_itemCnt)
+        return SLOTMAP_NULL_HANDLE;
+
+    u32 slot = map->_denseToSlot[i];
+    return _slotmap_handle(slot, map->_slots[slot].generation);
+}
+
+/**
+ * @brief Calls `func` for each live item, with its handle.
+ * `func` must not insert into or remove from the map.
+ *
+ * @param map
+ * @param func
+ * @param userArg
+ */
+static inline void slotmap_for_each(SlotMap *map, void (*func)(void *itemPtr, SlotHandle handle, void *userArg), void *userArg)
+{
+    if (!map || !func)
+        return;
+
+    for (u64 i = 0; i < map->_itemCnt; ++i)
+        func(_slotmap_i_to_ptr(map, i), slotmap_handle_at(map, i), userArg);
+}
+
+/**
+ * @brief Removes every item, all handles become stale. Keeps the allocated memory.
+ *
+ * @param map
+ */
+static inline void slotmap_clear(SlotMap *map)
+{
+    if (!map || !map->_data)
+        return;
+
+    while (map->_itemCnt > 0)
+        (void)slotmap_remove(map, slotmap_handle_at(map, map->_itemCnt - 1));
+}
@@ -54,6 +54,13 @@ typedef _w32_filetime* _w32_lpfiletime;
 
 #define _WIN_32_INVALID_HANDLE_VALUE ((_w32_handle)(long long)-1)
 
+#define _WIN_32_MEM_COMMIT   0x00001000
+#define _WIN_32_MEM_RESERVE  0x00002000
+#define _WIN_32_MEM_RELEASE  0x00008000
+#define _WIN_32_MEM_RESET    0x00080000
+#define _WIN_32_PAGE_NOACCESS  0x01
+#define _WIN_32_PAGE_READWRITE 0x04
+
 // windows API dll imports
 // better than importing the entire windows.h lib
 // at least for the sake of global scope pollution
@@ -62,6 +69,9 @@ __declspec(dllimport) _w32_handle  __stdcall GetProcessHeap(void);
 __declspec(dllimport) _w32_lpvoid  __stdcall HeapAlloc(_w32_handle, _w32_dword, _w32_size_t);
 __declspec(dllimport) _w32_lpvoid  __stdcall HeapReAlloc(_w32_handle, _w32_dword, _w32_lpvoid, _w32_size_t);
 __declspec(dllimport) _w32_bool    __stdcall HeapFree(_w32_handle, _w32_dword, _w32_lpvoid);
+__declspec(dllimport) _w32_size_t  __stdcall HeapSize(_w32_handle, _w32_dword, const void*);
+__declspec(dllimport) _w32_lpvoid  __stdcall VirtualAlloc(_w32_lpvoid, _w32_size_t, _w32_dword, _w32_dword);
+__declspec(dllimport) _w32_bool    __stdcall VirtualFree(_w32_lpvoid, _w32_size_t, _w32_dword);
 
 __declspec(dllimport) _w32_handle  __stdcall GetStdHandle(_w32_dword);
 __declspec(dllimport) _w32_bool    __stdcall FlushFileBuffers(_w32_handle);
@@ -169,7 +169,15 @@ static Error _growbuffwriter_resize(Writer *writer, u64 newSize)
         return X_ERR_EXT("writer", "growbuffwriter_resize",
             ERR_INVALID_PARAMETER, "invalid state or size");
 
-    i8 *newBlock = (i8*)state->allocator.realloc(&state->allocator, state->buff.bytes, newSize);
+    // Use slack left by the allocator before reallocating
+    u64 usableSize = allocator_usable_size(&state->allocator, state->buff.bytes, state->buff.size);
+    i8 *newBlock = state->buff.bytes;
+
+    if (newSize > state->buff.size && usableSize >= newSize)
+        newSize = usableSize;
+    else
+        newBlock = (i8*)state->allocator.realloc(&state->allocator, state->buff.bytes, newSize);
+
     if (!newBlock)
         return X_ERR_EXT("writer", "growbuffwriter_resize",
             ERR_OUT_OF_MEMORY, "alloc failure");
@@ -384,7 +392,18 @@ static Error _growstrwriter_resize(Writer *writer, u64 newSize)
     if (!state || newSize == 0)
         return X_ERR_EXT("writer", "growstrwriter_resize", ERR_INVALID_PARAMETER, "invalid state or size");
 
-    char *newBlock = (char*)state->allocator.realloc(&state->allocator, state->str, newSize);
+    // Use slack left by the allocator before reallocating, strSize is 32 bits
+    u64 usableSize = allocator_usable_size(&state->allocator, state->str, state->strSize);
+    if (usableSize > (u64)EnumMaxVal.U32)
+        usableSize = (u64)EnumMaxVal.U32;
+
+    char *newBlock = state->str;
+
+    if (newSize > state->strSize && usableSize >= newSize)
+        newSize = usableSize;
+    else
+        newBlock = (char*)state->allocator.realloc(&state->allocator, state->str, newSize);
+
     if (!newBlock)
         return X_ERR_EXT("writer", "growstrwriter_resize", ERR_OUT_OF_MEMORY, "alloc failure");
 